@@ -0,0 +1,56 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_AESHardware_h_)
+#define _AESHardware_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \brief AES-128 CTR mode using the AES instructions of the host processor.
+ *
+ * Two backends are supported: AES-NI on x86 and the ARMv8 Cryptography Extension
+ * on AArch64. Which one to use is decided at runtime from the features reported by
+ * the processor, so a single binary runs everywhere and falls back to the software
+ * implementation in RijndaelCTR on processors without AES instructions.
+ *
+ * Eight counter blocks are encrypted at a time. The AES instructions of both
+ * architectures are pipelined, so independent blocks in flight hide the latency of
+ * each round, which a block-at-a-time implementation cannot.
+ */
+class AESHardware
+{
+public:
+    //! \brief Returns true if the processor supports one of the backends.
+    static bool isAvailable();
+
+    //! \brief Returns the name of the backend in use, or NULL if none is available.
+    static const char *getName();
+
+    //! \brief Encrypts or decrypts whole blocks in CTR mode.
+    //!
+    //! The 128-bit big-endian \a counter is encrypted to form the key stream of each
+    //! block, and is then incremented by \a counterStep. On return \a counter holds
+    //! the value for the block following the last one processed.
+    //!
+    //! Must only be called if isAvailable() returns true.
+    //!
+    //! \param key         The 16-byte AES-128 key.
+    //! \param counter     The 16-byte counter block, updated on return.
+    //! \param counterStep Amount the counter is incremented by after each block.
+    //! \param data        Input data, \a blocks * 16 bytes.
+    //! \param blocks      Number of 16-byte blocks to process.
+    //! \param dest        Output buffer, may be the same as \a data.
+    static void processCtr(const uint8_t *key,
+                           uint8_t *counter,
+                           unsigned counterStep,
+                           const uint8_t *data,
+                           size_t blocks,
+                           uint8_t *dest);
+};
+
+#endif // _AESHardware_h_
@@ -9,12 +9,14 @@
 #define _Bootloader_h_
 
 #include "Command.h"
+#include "CommandTimeouts.h"
 #include "Packetizer.h"
 #include "Peripheral.h"
 #include "Logging.h"
 
 #include <string.h>
 #include <time.h>
+#include <chrono>
 
 //! @addtogroup blfwk
 //! @{
@@ -41,14 +43,19 @@ public:
 
     //! @brief Inject a command into the bootloader.
     //!
+    //! Every packet read of the command must complete within the command timeout. Unless
+    //! adaptive timeouts are disabled, the packet timeout of a command that erases,
+    //! programs or configures a memory is extended by the time it is expected to take,
+    //! also for such commands sent by \a cmd itself.
+    //!
     //! @param cmd The command to send
-    void inject(Command &cmd)
-    {
-        clock_t start = clock();
-        cmd.sendTo(*m_hostPacketizer);
-        clock_t finish = clock();
-        Log::debug("  - took %2.3f seconds\n", (double)(finish - start) / CLOCKS_PER_SEC);
-    }
+    void inject(Command &cmd);
+
+    //! @brief Set the time in milliseconds that each injected command may take, or 0 for no limit.
+    void setCommandTimeout(uint32_t timeoutMs) { m_commandTimeoutMs = timeoutMs; }
+
+    //! @brief Enable or disable the extension of the packet timeout of memory commands.
+    void setAdaptiveTimeouts(bool isEnabled) { m_isAdaptiveTimeoutEnabled = isEnabled; }
 
     //! @brief Flush state.
     void flush();
@@ -94,6 +101,11 @@ public:
     //! \brief Send a ping if applicable.
     void ping(int retries, unsigned int delay, int comSpeed, int* actualComSpeed);
 
+    //! \brief Send a ping at each of the UART speeds in turn until the target answers.
+    //!
+    //! \exception  std::runtime_error  Thrown if the target answers at none of the speeds.
+    void ping(int retries, unsigned int delay, const std::vector<int> &comSpeeds, int *actualComSpeed);
+
     //! @name Accessors.
     //@{
 
@@ -102,8 +114,11 @@ public:
     //@}
 
 protected:
-    Packetizer *m_hostPacketizer; //!< Packet interface to send commands on.
-    FileLogger *m_logger;         //!< Singleton logger instance.
+    Packetizer *m_hostPacketizer;      //!< Packet interface to send commands on.
+    FileLogger *m_logger;              //!< Singleton logger instance.
+    uint32_t m_commandTimeoutMs;       //!< Time each injected command may take, or 0 for no limit.
+    bool m_isAdaptiveTimeoutEnabled;   //!< Whether memory commands get a packet timeout of their own.
+    CommandTimeouts m_commandTimeouts; //!< Estimates the packet timeout of memory commands.
 };
 
 } // namespace blfwk
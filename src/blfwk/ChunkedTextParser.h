@@ -0,0 +1,87 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_ChunkedTextParser_h_)
+#define _ChunkedTextParser_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+namespace blfwk
+{
+/*!
+ * \brief Helpers for parsing line-oriented text image files in parallel.
+ *
+ * S-record and Intel Hex files consist of independent lines, so a memory image
+ * of such a file can be split into chunks that begin and end on line boundaries
+ * and parsed concurrently. Each chunk produces a list of DataRun objects, which
+ * are then added to the executable image in file order.
+ */
+class ChunkedTextParser
+{
+public:
+    //! \brief A range of the file that starts at the beginning of a line and ends at the end of a line.
+    struct Chunk
+    {
+        const char *m_begin; //!< First character of the chunk.
+        const char *m_end;   //!< One past the last character of the chunk.
+    };
+
+    //! \brief Contiguous data collected from consecutive records.
+    struct DataRun
+    {
+        uint32_t m_address;          //!< Address of the first byte.
+        std::vector<uint8_t> m_data; //!< Data bytes.
+    };
+
+    typedef std::vector<Chunk> chunk_vector_t;
+    typedef std::vector<DataRun> run_vector_t;
+
+    enum
+    {
+        //! Files are not split into chunks smaller than this, so small files are parsed
+        //! on the calling thread. Currently 1MB.
+        kMinChunkSize = 1024 * 1024
+    };
+
+    //! \brief Splits \a size bytes at \a data into newline-aligned chunks, one per worker thread.
+    static chunk_vector_t split(const uint8_t *data, size_t size);
+
+    //! \brief Runs \a work for every chunk index, using one thread per chunk.
+    static void run(size_t count, const std::function<void(size_t)> &work);
+
+    //! \brief Calls \a handler for every non-empty line of \a chunk.
+    //!
+    //! Either CR, LF, or CRLF line endings are supported. The line passed to the
+    //! handler does not include the line ending. Text after the last line ending is
+    //! ignored, as StSRecordFile and StIntelHexFile do. Iteration stops early if the
+    //! handler returns false.
+    template <typename F>
+    static void forEachLine(const Chunk &chunk, F handler)
+    {
+        const char *line = chunk.m_begin;
+        for (const char *p = chunk.m_begin; p != chunk.m_end; ++p)
+        {
+            if (*p == '\r' || *p == '\n')
+            {
+                if (p != line && !handler(line, static_cast<unsigned>(p - line)))
+                {
+                    return;
+                }
+                line = p + 1;
+            }
+        }
+    }
+
+    //! \brief Appends \a length bytes at \a address to \a runs, extending the last run if contiguous.
+    static void appendData(run_vector_t &runs, uint32_t address, const uint8_t *data, unsigned length);
+};
+
+}; // namespace blfwk
+
+#endif // _ChunkedTextParser_h_
@@ -12,12 +12,23 @@
 #include <assert.h>
 
 #include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "BusPal.h"
 #include "DataSource.h"
 #include "Packetizer.h"
 #include "Progress.h"
 #include "SourceFile.h"
+#include "ELFSourceFile.h"
+#include "ImageCache.h"
+#include "InputStream.h"
+#include "StreamingDataSource.h"
 #include "format_string.h"
 #include "host_types.h"
 #include "memory/memory.h"
@@ -320,9 +331,33 @@ struct StatusMessageTableEntry
 //! in the src/include/bootloader_common.h file.
 extern StatusMessageTableEntry g_statusCodes[];
 
+//! @name Memory operations.
+//@{
+//! @brief Memory operations whose duration depends on the device.
+enum _memory_operations
+{
+    kMemoryOperation_Erase = 0,     //!< Erase a range of a memory.
+    kMemoryOperation_EraseAll = 1,  //!< Erase a whole memory.
+    kMemoryOperation_Write = 2,     //!< Program a range of a memory.
+    kMemoryOperation_Configure = 3, //!< Configure a memory.
+    kMemoryOperation_Count = 4
+};
+
+//! @brief Memory operation performed by a command.
+struct memory_operation_t
+{
+    uint32_t operation; //!< One of the _memory_operations.
+    uint32_t memoryId;  //!< Memory the operation applies to.
+    uint32_t address;   //!< Start of the range, for erase and write.
+    uint32_t byteCount; //!< Length of the range, for erase and write. 0 if not known yet.
+};
+//@}
+
 //! @name Commands
 //@{
 
+class CommandTimeouts;
+
 /*!
  * @brief Represents a bootloader command.
  *
@@ -361,10 +396,11 @@ protected:
     //!
     //! @param argv Argument vector
     Command(const string_vector_t *argv)
-        : m_argv(*argv)
+        : m_progress()
+        , m_argv(*argv)
         , m_responseValues()
         , m_responseDetails()
-        , m_progress()
+        , m_commandTimeouts(NULL)
     {
     }
 
@@ -372,10 +408,11 @@ protected:
     //!
     //! @param name Name of the command
     Command(const char *const name)
-        : m_argv(1, name)
+        : m_progress()
+        , m_argv(1, name)
         , m_responseValues()
         , m_responseDetails()
-        , m_progress()
+        , m_commandTimeouts(NULL)
     {
     }
 
@@ -414,6 +451,14 @@ public:
     //! @brief initial the process callback.
     void registerProgress(Progress *progress) { m_progress = progress; }
 
+    //! @brief Set the timeouts that the commands this command sends itself are sent with, or NULL.
+    void setCommandTimeouts(CommandTimeouts *timeouts) { m_commandTimeouts = timeouts; }
+
+    //! @brief Get the memory operation performed by the command.
+    //!
+    //! @return False if the command does not erase, program or configure a memory.
+    virtual bool getMemoryOperation(memory_operation_t &) const { return false; }
+
 protected:
     //! @brief Check generic response packet.
     //!
@@ -421,13 +466,20 @@ protected:
     //! @param commandTag Expected command tag in packet
     virtual bool processResponse(const generic_response_packet_t *packet, uint8_t commandTag);
 
+    //! @brief Send a command that is part of this command.
+    //!
+    //! The command is sent with the command timeouts, if set, so that its packet timeout
+    //! is extended like that of an injected command.
+    void sendSubCommand(Packetizer &packetizer, Command &cmd);
+
 public:
     Progress *m_progress; //!< Variable for progress control.
 
 protected:
-    string_vector_t m_argv;           //!< Vector of argument strings.
-    uint32_vector_t m_responseValues; //!< Vector of response values.
-    string m_responseDetails;         //!< Descriptive response.
+    string_vector_t m_argv;             //!< Vector of argument strings.
+    uint32_vector_t m_responseValues;   //!< Vector of response values.
+    string m_responseDetails;           //!< Descriptive response.
+    CommandTimeouts *m_commandTimeouts; //!< Timeouts of the commands sent by this command, or NULL.
 };
 
 /*!
@@ -698,6 +750,51 @@ public:
         long m_fileSize;        //!< Size in bytes of data file.
     };
 
+    /*!
+     * @brief Provide data from an input stream for data phase.
+     *
+     * Used for the standard input, pipes and compressed files, which cannot be
+     * seeked to find their size. If no byte count is declared, the whole input is
+     * read into memory first to find its size.
+     */
+    class StreamDataProducer : public DataProducer
+    {
+    public:
+        //! @brief Default constructor.
+        StreamDataProducer()
+            : m_stream()
+            , m_data()
+            , m_dataSize(0)
+            , m_byteIndex(0)
+        {
+        }
+
+        //! @brief Destructor.
+        virtual ~StreamDataProducer() {}
+
+        //! @brief Initialize with a file path, or "-" for the standard input.
+        bool init(std::string filePath, uint32_t count);
+
+        //! \name DataProducer
+        //@{
+        //! @brief Query if more data is available.
+        virtual bool hasMoreData() const { return (m_byteIndex < m_dataSize); }
+        //! @brief Query the total size of the data.
+        virtual uint32_t getDataSize() const { return m_dataSize; }
+        //! @brief Get the next data chunk.
+        //!
+        //! Before calling getData(), call moreData() to determine if
+        //! data is available.
+        virtual uint32_t getData(uint8_t *data, uint32_t size);
+        //@}
+
+    protected:
+        smart_ptr<InputStream> m_stream; //!< Input stream, or NULL once the data is in #m_data.
+        uchar_vector_t m_data;           //!< Whole input, if no byte count was declared.
+        uint32_t m_dataSize;             //!< Size in bytes of the data.
+        uint32_t m_byteIndex;            //!< Current byte index.
+    };
+
     /*!
      * @brief Provide data from hex string for data phase.
      */
@@ -792,6 +889,12 @@ public:
 
         //! @brief Finalize processing.
         virtual void finalize() = 0;
+
+        //! @brief Query if processData() may run on a helper thread.
+        //!
+        //! Consumers that share their output with the progress display must
+        //! process data on the thread that receives it.
+        virtual bool canProcessInBackground() const { return false; }
     };
 
     /*!
@@ -823,6 +926,9 @@ public:
         //! @brief Finalize processing.
         virtual void finalize() {}
 
+        //! @brief File writes do not interfere with the progress display.
+        virtual bool canProcessInBackground() const { return true; }
+
     protected:
         std::string m_filePath; //!< Data file path.
         FILE *m_filePointer;    //!< Data file pointer.
@@ -886,6 +992,106 @@ public:
         uint8_t m_dataCacheCount;           //!< Count in bytes of the cached data.
     };
 
+protected:
+    /*!
+     * @brief Gets and frames the next data packet while the current one is written.
+     *
+     * With a helper thread, the producer read and the framing of packet N+1, including its
+     * crc, overlap with writing packet N and waiting for its ACK. Packet N+1 is only written
+     * once packet N is acknowledged, and packet N stays intact for re-transmission on NAK.
+     */
+    class PacketPipeline
+    {
+    public:
+        //! @brief Constructor. Starts the helper thread if @a isThreaded is true.
+        PacketPipeline(Packetizer &device, DataProducer &producer, uint32_t packetSize, bool isThreaded);
+
+        //! @brief Destructor. Stops the helper thread.
+        ~PacketPipeline();
+
+        //! @brief Start preparing the packet that follows @a offset bytes of data.
+        //!
+        //! Without a helper thread the packet is prepared before returning.
+        void prepare(uint32_t offset);
+
+        //! @brief Wait for the packet started by prepare().
+        //!
+        //! A byte count of 0 means there is no more data. Rethrows any exception thrown
+        //! while preparing the packet.
+        PreparedPacket &wait();
+
+    protected:
+        //! @brief Get and frame the next packet into #m_packets[#m_next].
+        void prepareNext();
+
+        //! @brief Helper thread function.
+        void run();
+
+    protected:
+        Packetizer &m_device;                     //!< Packetizer that frames the packets.
+        DataProducer &m_producer;                 //!< Provides the packet data.
+        uint32_t m_packetSize;                    //!< Maximum packet payload size.
+        PreparedPacket m_packets[2];              //!< Packet being written and packet being prepared.
+        uint8_t m_buffers[2][kMaxHostPacketSize]; //!< Payload of each of #m_packets.
+        unsigned m_next;                          //!< Index of the packet prepared next.
+        uint32_t m_offset;                        //!< Data offset of the packet prepared next.
+        std::thread m_thread;                     //!< Helper thread, if any.
+        std::mutex m_mutex;                       //!< Protects the members below.
+        std::condition_variable m_condition;      //!< Signalled when the state below changes.
+        bool m_isRequested;                       //!< Whether a packet should be prepared.
+        bool m_isStopped;                         //!< Whether the helper thread should exit.
+        std::exception_ptr m_error;               //!< Exception thrown while preparing.
+    };
+
+    /*!
+     * @brief Hands received data to the consumer on a helper thread.
+     *
+     * The data of each packet is copied into a bounded queue, so the next packet is
+     * acknowledged and received while the consumer still writes or formats the
+     * previous one.
+     */
+    class ConsumerQueue
+    {
+    public:
+        //! @brief Maximum number of packets waiting for the consumer.
+        static const unsigned kMaxQueuedPackets = 64;
+
+        //! @brief Constructor. Starts the helper thread if @a isThreaded is true.
+        ConsumerQueue(DataConsumer &consumer, bool isThreaded);
+
+        //! @brief Destructor. Processes any queued data and stops the helper thread.
+        ~ConsumerQueue();
+
+        //! @brief Queue @a size bytes at @a data for the consumer.
+        //!
+        //! Without a helper thread the data is processed before returning. Rethrows
+        //! any exception thrown by the consumer.
+        void push(const uint8_t *data, uint32_t size);
+
+        //! @brief Wait until all queued data has been processed.
+        //!
+        //! Rethrows any exception thrown by the consumer.
+        void flush();
+
+    protected:
+        //! @brief Helper thread function.
+        void run();
+
+        //! @brief Rethrow and clear #m_error, if set. Must be called with #m_mutex locked.
+        void rethrowError();
+
+    protected:
+        DataConsumer &m_consumer;                     //!< Consumer of the received data.
+        std::thread m_thread;                         //!< Helper thread, if any.
+        std::mutex m_mutex;                           //!< Protects the members below.
+        std::condition_variable m_condition;          //!< Signalled when the state below changes.
+        std::deque<std::vector<uint8_t> > m_queue;    //!< Data waiting for the consumer.
+        std::vector<std::vector<uint8_t> > m_buffers; //!< Processed buffers kept for reuse.
+        bool m_isProcessing;                          //!< Whether the helper thread is in processData().
+        bool m_isStopped;                             //!< Whether the helper thread should exit.
+        std::exception_ptr m_error;                   //!< Exception thrown by the consumer.
+    };
+
 public:
     //! @brief Constructor that takes a DataProducer.
     DataPacket(DataProducer *dataProducer, uint32_t packetSize = kDefaultMaxPacketSize)
@@ -1079,6 +1285,16 @@ public:
     //! @brief Send command to packetizer.
     virtual void sendTo(Packetizer &packetizer);
 
+    //! @brief Get the memory operation performed by the command.
+    virtual bool getMemoryOperation(memory_operation_t &operation) const
+    {
+        operation.operation = kMemoryOperation_Erase;
+        operation.memoryId = m_memoryId;
+        operation.address = m_startAddress;
+        operation.byteCount = m_byteCount;
+        return true;
+    }
+
 protected:
     //! @brief Check response packet.
     virtual bool processResponse(const uint8_t *packet)
@@ -1120,6 +1336,16 @@ public:
     //! @brief Send command to packetizer.
     virtual void sendTo(Packetizer &packetizer);
 
+    //! @brief Get the memory operation performed by the command.
+    virtual bool getMemoryOperation(memory_operation_t &operation) const
+    {
+        operation.operation = kMemoryOperation_EraseAll;
+        operation.memoryId = m_memoryId;
+        operation.address = 0;
+        operation.byteCount = 0;
+        return true;
+    }
+
 protected:
     //! @brief Check response packet.
     virtual bool processResponse(const uint8_t *packet)
@@ -1284,6 +1510,7 @@ public:
         , m_count(0)
         , m_data()
         , m_memoryId(kMemoryInternal)
+        , m_bytesWritten(0)
     {
     }
 
@@ -1295,6 +1522,7 @@ public:
         , m_count(0)
         , m_data()
         , m_memoryId(memoryId)
+        , m_bytesWritten(0)
     {
         m_startAddress = segment->getBaseAddress();
         m_argv.push_back(format_string("0x%08x", m_startAddress));
@@ -1311,6 +1539,7 @@ public:
         , m_count(0)
         , m_data(data)
         , m_memoryId(memoryId)
+        , m_bytesWritten(0)
     {
         m_argv.push_back(format_string("0x%08x", m_startAddress));
         m_argv.push_back(m_fileOrData);
@@ -1323,6 +1552,16 @@ public:
     //! @brief Send command to packetizer.
     virtual void sendTo(Packetizer &packetizer);
 
+    //! @brief Get the memory operation performed by the command.
+    virtual bool getMemoryOperation(memory_operation_t &operation) const
+    {
+        operation.operation = kMemoryOperation_Write;
+        operation.memoryId = m_memoryId;
+        operation.address = m_startAddress;
+        operation.byteCount = m_bytesWritten;
+        return true;
+    }
+
 protected:
     //! @brief Check response packet.
     virtual bool processResponse(const uint8_t *packet)
@@ -1338,6 +1577,7 @@ protected:
     uint32_t m_count;                      //!< Number of bytes to write.
     uchar_vector_t m_data;                 //!< The data to write to the device.
     uint32_t m_memoryId;                   //!< Memory device ID
+    uint32_t m_bytesWritten;               //!< Number of bytes written by the last sendTo().
 };
 
 /*!
@@ -1381,17 +1621,27 @@ protected:
 class ReceiveSbFile : public Command
 {
 public:
+    //! @brief Whether to poll the target for an abort packet while sending the file.
+    enum abort_mode_t
+    {
+        kAbortModeAuto,    //!< Poll only if the SB file may make the target abort.
+        kAbortModeEnabled, //!< Always poll.
+        kAbortModeDisabled //!< Never poll.
+    };
+
     //! @brief Constructor that takes an argument vector.
     ReceiveSbFile(const string_vector_t *argv)
         : Command(argv)
         , m_dataFile()
+        , m_abortMode(kAbortModeAuto)
     {
     }
 
     //! @brief Constructor that takes a filename argument.
-    ReceiveSbFile(const char *const filename)
+    ReceiveSbFile(const char *const filename, abort_mode_t abortMode = kAbortModeAuto)
         : Command(kCommand_ReceiveSbFile.name)
         , m_dataFile(filename)
+        , m_abortMode(abortMode)
     {
     }
 
@@ -1401,6 +1651,20 @@ public:
     //! @brief Send command to packetizer.
     virtual void sendTo(Packetizer &packetizer);
 
+    //! @brief Get the memory operation performed by the command.
+    //!
+    //! The SB file decides what is erased and programmed, so each data packet is given
+    //! the time to program a page of the internal flash. No rate is learned from the
+    //! command, since the amount of work is not known.
+    virtual bool getMemoryOperation(memory_operation_t &operation) const
+    {
+        operation.operation = kMemoryOperation_Write;
+        operation.memoryId = kMemoryInternal;
+        operation.address = 0;
+        operation.byteCount = 0;
+        return true;
+    }
+
 protected:
     //! @brief Check response packet.
     virtual bool processResponse(const uint8_t *packet)
@@ -1409,8 +1673,12 @@ protected:
                                         kCommandTag_ReceiveSbFile);
     }
 
+    //! @brief Decide whether to poll the target for an abort packet.
+    bool isAbortPollingNeeded() const;
+
 protected:
-    std::string m_dataFile; //!< SB file path.
+    std::string m_dataFile;   //!< SB file path.
+    abort_mode_t m_abortMode; //!< Whether to poll for an abort packet.
 };
 
 /*!
@@ -1824,6 +2092,16 @@ public:
     //! @brief Send command to packetizer.
     virtual void sendTo(Packetizer &packetizer);
 
+    //! @brief Get the memory operation performed by the command.
+    virtual bool getMemoryOperation(memory_operation_t &operation) const
+    {
+        operation.operation = kMemoryOperation_Configure;
+        operation.memoryId = m_memoryId;
+        operation.address = m_configBlockAddress;
+        operation.byteCount = 0;
+        return true;
+    }
+
 protected:
     //! @brief Check generic response packet.
     virtual bool processResponse(const uint8_t *packet)
@@ -1952,6 +2230,14 @@ protected:
 class FlashImage : public Command
 {
 public:
+    enum
+    {
+        //! Files at least this large are parsed while they are being written, if the file
+        //! format supports it and the image cache is not used, instead of being loaded
+        //! into memory first. Currently 16MB.
+        kMinStreamingFileSize = 16 * 1024 * 1024
+    };
+
     //! @brief Constructor that takes an argument vector.
     FlashImage(const string_vector_t *argv)
         : Command(argv)
@@ -1959,6 +2245,8 @@ public:
         , m_sourceFile(NULL)
         , m_doEraseOpt(false)
         , m_memoryId(kMemoryInternal)
+        , m_elfLoadMode(kLoadModeDefault)
+        , m_imageCacheDirectory()
     {
     }
 
@@ -1969,6 +2257,8 @@ public:
         , m_sourceFile(sourceFile)
         , m_doEraseOpt(doEraseOpt)
         , m_memoryId(memoryId)
+        , m_elfLoadMode(kLoadModeDefault)
+        , m_imageCacheDirectory()
     {
         m_argv.push_back(m_sourceFile->getPath());
         m_argv.push_back(doEraseOpt ? "erase" : "none");
@@ -1981,11 +2271,26 @@ public:
     //! @brief Send command to packetizer.
     virtual void sendTo(Packetizer &packetizer);
 
+    //! @brief Cache parsed images in the given directory. An empty string disables the cache.
+    void setImageCacheDirectory(const std::string &directory) { m_imageCacheDirectory = directory; }
+
+protected:
+    //! @brief Map of erased flash ranges, from start address to end address.
+    typedef std::map<uint64_t, uint64_t> erased_range_map_t;
+
+    //! @brief Write the data of a streaming data source, segment by segment.
+    void sendStreamingTo(Packetizer &device, StreamingDataSource *dataSource);
+
+    //! @brief Erase the sectors covering a range that have not been erased yet.
+    uint32_t eraseRange(Packetizer &device, uint32_t start, uint32_t length, erased_range_map_t &erased);
+
 protected:
-    std::string m_fileName;   //!< Image file name with full path.
-    SourceFile *m_sourceFile; //!< Sourcefile object containing the data and addresses.
-    bool m_doEraseOpt;        //!< Detemine if doing erase operation before writting image file to flash.
-    uint32_t m_memoryId;      //!< Memory device ID.
+    std::string m_fileName;            //!< Image file name with full path.
+    SourceFile *m_sourceFile;          //!< Sourcefile object containing the data and addresses.
+    bool m_doEraseOpt;                 //!< Detemine if doing erase operation before writting image file to flash.
+    uint32_t m_memoryId;               //!< Memory device ID.
+    elf_load_mode_t m_elfLoadMode;     //!< How segments are built from an ELF file.
+    std::string m_imageCacheDirectory; //!< Directory of the parsed image cache, or empty if not used.
 };
 
 /*!
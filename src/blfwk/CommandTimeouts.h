@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_CommandTimeouts_h_)
+#define _CommandTimeouts_h_
+
+#include <stdint.h>
+#include <map>
+#include <utility>
+#include "Command.h"
+#include "Packetizer.h"
+
+namespace blfwk
+{
+/*!
+ * \brief Estimates how long the device takes to carry out a command.
+ *
+ * Erasing, programming and configuring a memory can take far longer than a packet
+ * round trip, and how much longer depends on the device and on the range. Rather
+ * than raising the packet timeout of every command, the timeout of these commands
+ * alone is extended by the time they are expected to take.
+ *
+ * The estimate is based on the geometry the device reports for the memory, read
+ * once with get-property, and on a rate per operation and memory. The rate starts
+ * at a conservative default and is replaced by the rate measured on completed
+ * commands, so later commands of a session wait just long enough.
+ *
+ * Writes never read the geometry, so that writing RAM, or the first write of a
+ * session, costs no extra round trips. They use the geometry once an erase or a
+ * configure has read it. Memory ID 0 covers internal RAM as well as flash. Commands
+ * on memory ID 0 outside the reported flash range keep the timeout of other commands,
+ * and a write to memory ID 0 is only learned once the flash range is known.
+ */
+class CommandTimeouts
+{
+public:
+    //! \brief Margin applied to the expected duration of a command.
+    static const uint32_t kMargin = 2;
+
+    //! \brief Constructor.
+    CommandTimeouts()
+        : m_memories()
+        , m_rates()
+    {
+    }
+
+    //! \brief Returns the packet timeout for \a cmd, given the timeout \a baseTimeoutMs of other commands.
+    //!
+    //! The memory properties needed are read on \a packetizer the first time, except for a
+    //! write. For a write, the timeout applies to each data packet, so it covers programming
+    //! one page rather than the whole range.
+    uint32_t getPacketTimeout(Packetizer &packetizer, const Command &cmd, uint32_t baseTimeoutMs);
+
+    //! \brief Learns the rate of the operation of \a cmd, which succeeded after \a elapsedUs microseconds.
+    void learn(Packetizer &packetizer, const Command &cmd, uint64_t elapsedUs);
+
+    //! \brief Sends \a cmd on \a packetizer with the packet timeout from getPacketTimeout().
+    //!
+    //! The packet timeout is restored afterwards, and the rate is learned if the command
+    //! succeeded. The time taken to read the memory properties is not counted.
+    void send(Packetizer &packetizer, Command &cmd);
+
+protected:
+    //! \brief Geometry of a memory, as reported by the device. Fields are 0 when not reported.
+    struct memory_info_t
+    {
+        uint32_t startAddress;       //!< Start of the internal flash, unused for other memories.
+        uint64_t sizeInBytes;        //!< Size of the memory.
+        uint32_t sectorSize;         //!< Size of the erase unit.
+        uint32_t pageSize;           //!< Size of the program unit.
+        uint32_t byteWriteTimeoutMs; //!< Time the device allows for a program operation.
+    };
+
+    //! \brief Returns the geometry of memory \a memoryId, reading it from the device the first time.
+    const memory_info_t &getMemoryInfo(Packetizer &packetizer, uint32_t memoryId);
+
+    //! \brief Returns the geometry of memory \a memoryId if it has been read, or NULL.
+    const memory_info_t *findMemoryInfo(uint32_t memoryId) const;
+
+    //! \brief Returns true if \a operation applies to memory ID 0 outside the reported flash range.
+    bool isOutsideFlash(const memory_operation_t &operation) const;
+
+    //! \brief Reads property \a tag of memory \a memoryId, returning the response values without the status.
+    bool readProperty(Packetizer &packetizer, property_t tag, uint32_t memoryId, uint32_vector_t &values);
+
+    //! \brief Returns the amount of work of \a operation, in KiB or, for a configure, in commands.
+    //!
+    //! For a write, this is the work of one data packet.
+    double getWork(Packetizer &packetizer, const memory_operation_t &operation);
+
+    //! \brief Returns the rate of \a operation, in milliseconds per unit of work.
+    double getRate(const memory_operation_t &operation) const;
+
+protected:
+    typedef std::pair<uint32_t, uint32_t> rate_key_t; //!< Operation and memory ID.
+
+    std::map<uint32_t, memory_info_t> m_memories; //!< Geometry of each memory, by memory ID.
+    std::map<rate_key_t, double> m_rates;         //!< Measured rates in milliseconds per unit of work.
+};
+
+}; // namespace blfwk
+
+#endif // _CommandTimeouts_h_
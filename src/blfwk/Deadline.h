@@ -0,0 +1,96 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_Deadline_h_)
+#define _Deadline_h_
+
+#include <stdint.h>
+#include <chrono>
+
+namespace blfwk
+{
+/*!
+ * \brief Point in time by which an operation must complete.
+ *
+ * Deadlines are measured on the monotonic clock, so they are neither affected by
+ * changes of the wall clock nor stretched while the process is blocked the way CPU
+ * time is. A deadline is created once for an operation and handed down to every
+ * step of it, so the steps share one budget instead of each waiting its own timeout.
+ */
+class Deadline
+{
+public:
+    typedef std::chrono::steady_clock clock_t;
+
+    //! \brief Constructor. The deadline expires \a timeoutMs milliseconds from now.
+    explicit Deadline(uint32_t timeoutMs)
+        : m_time(clock_t::now() + std::chrono::milliseconds(timeoutMs))
+        , m_isNever(false)
+    {
+    }
+
+    //! \brief Returns a deadline that never expires.
+    static Deadline never() { return Deadline(); }
+
+    //! \brief Returns whichever of \a a and \a b expires first.
+    static Deadline earliest(const Deadline &a, const Deadline &b)
+    {
+        if (a.m_isNever)
+        {
+            return b;
+        }
+        if (b.m_isNever)
+        {
+            return a;
+        }
+        return (a.m_time < b.m_time) ? a : b;
+    }
+
+    //! \brief Returns true if the deadline never expires.
+    bool isNever() const { return m_isNever; }
+
+    //! \brief Returns true if the deadline has passed.
+    bool isExpired() const { return !m_isNever && (clock_t::now() >= m_time); }
+
+    //! \brief Returns the number of milliseconds left, rounded up.
+    //!
+    //! Returns 0 once the deadline has passed, and UINT32_MAX if it never expires.
+    uint32_t getRemainingMs() const
+    {
+        if (m_isNever)
+        {
+            return UINT32_MAX;
+        }
+        clock_t::duration remaining = m_time - clock_t::now();
+        if (remaining <= clock_t::duration::zero())
+        {
+            return 0;
+        }
+        int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(remaining + std::chrono::milliseconds(1) -
+                                                                           clock_t::duration(1))
+                         .count();
+        return (ms > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)ms;
+    }
+
+    //! \brief Returns the point in time of the deadline. Not meaningful if isNever() is true.
+    clock_t::time_point getTime() const { return m_time; }
+
+protected:
+    //! \brief Constructor for never().
+    Deadline()
+        : m_time()
+        , m_isNever(true)
+    {
+    }
+
+protected:
+    clock_t::time_point m_time; //!< When the deadline expires.
+    bool m_isNever;             //!< Whether the deadline never expires.
+};
+
+}; // namespace blfwk
+
+#endif // _Deadline_h_
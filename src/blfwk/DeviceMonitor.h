@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_DeviceMonitor_h_)
+#define _DeviceMonitor_h_
+
+#include <stdint.h>
+#include <functional>
+#include <set>
+#include <string>
+#include "Deadline.h"
+
+namespace blfwk
+{
+/*!
+ * \brief Waits for devices to appear and disappear as they are plugged and enumerated.
+ *
+ * A target re-enumerates after a reset, and a USB to UART bridge may come back as
+ * another device node. Rather than sleeping a fixed time, the monitor listens to the
+ * device events of the kernel and of udev, and checks whether the device is there
+ * each time one arrives, so a wait ends as soon as the device has been enumerated and
+ * udev has set up its node.
+ *
+ * Events are only received on Linux. On other platforms, and if the event socket
+ * cannot be opened, the monitor checks periodically instead.
+ */
+class DeviceMonitor
+{
+public:
+    //! \brief Interval of the periodic check, in milliseconds.
+    //!
+    //! Also used with events, in case one is missed.
+    static const uint32_t kCheckIntervalMs = 250;
+
+    //! \brief Constructor. Starts listening to device events.
+    DeviceMonitor();
+
+    //! \brief Destructor.
+    ~DeviceMonitor();
+
+    //! \brief Waits until \a isDone returns true or \a deadline expires.
+    //!
+    //! \a isDone is called at once, then after each batch of device events.
+    //!
+    //! \return The last result of \a isDone.
+    bool waitUntil(const std::function<bool()> &isDone, const Deadline &deadline);
+
+    //! \brief Returns true if the removal of the device node \a devicePath has been seen.
+    //!
+    //! Only removals received by waitUntil() since the monitor was created are known.
+    bool isRemoved(const std::string &devicePath) const;
+
+    //! \brief Finds the device node of the USB HID device with \a vid and \a pid.
+    //!
+    //! If \a serialNumber is not empty, only the device with that serial number matches.
+    //!
+    //! \return False if there is no such device, or on Linux if its node may not be opened yet.
+    static bool findUsbHid(uint16_t vid, uint16_t pid, const std::string &serialNumber, std::string &devicePath);
+
+    //! \brief Returns true if the device node \a devicePath exists and may be opened for reading and writing.
+    //!
+    //! Always true on Windows, where ports are not files, so waiting for a node to get ready does nothing there.
+    static bool isNodeReady(const std::string &devicePath);
+
+    //! \brief Returns the device node that \a path refers to, following symbolic links such as
+    //! those in /dev/serial/by-id.
+    static std::string resolveNode(const std::string &path);
+
+protected:
+    //! \brief Reads the pending events, noting the removed device nodes.
+    void readEvents();
+
+protected:
+    int m_socket;                    //!< Event socket, or -1 if not available.
+    std::set<std::string> m_removed; //!< Device nodes removed so far.
+};
+
+}; // namespace blfwk
+
+#endif // _DeviceMonitor_h_
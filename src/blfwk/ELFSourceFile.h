@@ -9,6 +9,7 @@
 
 #include "SourceFile.h"
 #include "StELFFile.h"
+#include "MappedFile.h"
 #include "smart_ptr.h"
 #include "DataSource.h"
 #include "DataTarget.h"
@@ -43,6 +44,22 @@ enum secinfo_clear_t
     kSecinfoCStartupClear
 };
 
+//! Ways of building data source segments from an ELF file.
+enum elf_load_mode_t
+{
+    //! Default value for the load mode.
+    kLoadModeDefault,
+
+    //! One segment per allocated #SHT_PROGBITS or #SHT_NOBITS section, located
+    //! at the section address.
+    kLoadSections,
+
+    //! One segment per #PT_LOAD program header, located at the physical (load)
+    //! address. The part of the segment not backed by file data becomes a fill
+    //! segment.
+    kLoadSegments
+};
+
 /*!
  * \brief Executable and Loading Format (ELF) source file.
  */
@@ -67,6 +84,14 @@ public:
     virtual void close();
     //@}
 
+    //! \name Load mode
+    //@{
+    //! \brief Selects how createDataSource() builds segments. Overrides the loadMode option.
+    inline void setLoadMode(elf_load_mode_t mode) { m_loadMode = mode; }
+    //! \brief Returns the selected load mode.
+    inline elf_load_mode_t getLoadMode() const { return m_loadMode; }
+    //@}
+
     //! \name Format capabilities
     //@{
     virtual bool supportsNamedSections() const { return true; }
@@ -78,6 +103,9 @@ public:
     //! \brief Creates a data source from the entire file.
     virtual DataSource *createDataSource();
 
+    //! \brief Creates a data source from the loadable segments of the file.
+    DataSource *createDataSourceFromSegments();
+
     //! \brief Creates a data source from one or more sections of the file.
     virtual DataSource *createDataSource(StringMatcher &matcher);
     //@}
@@ -123,9 +151,11 @@ public:
     //@}
 
 protected:
+    smart_ptr<MappedFile> m_mapping; //!< Memory mapping of the file, or NULL if it could not be mapped.
     smart_ptr<StELFFile> m_file;     //!< Parser for the ELF file.
     elf_toolset_t m_toolset;         //!< Toolset that produced the ELF file.
     secinfo_clear_t m_secinfoOption; //!< How to deal with the .secinfo section. Ignored if the toolset is not GHS.
+    elf_load_mode_t m_loadMode;      //!< How to build data source segments.
 
 protected:
     //! \brief Parses the toolset option value.
@@ -134,6 +164,9 @@ protected:
     //! \brief Reads the secinfoClear option.
     secinfo_clear_t readSecinfoClearOption();
 
+    //! \brief Reads the loadMode option.
+    elf_load_mode_t readLoadModeOption();
+
 protected:
     /*!
      * \brief A data source with ELF file sections as the contents.
@@ -149,6 +182,11 @@ protected:
      * It is used to represent sections whose type is #SHT_NOBITS. These sections have
      * no data, but simply allocate a region of memory to be filled with zeroes.
      * As such, the NoBitsSegment class is a subclass of DataSource::PatternSegment.
+     *
+     * Alternatively, segments can be created from #PT_LOAD program headers with the
+     * addProgramSegment() method. The file-backed part of a program segment is
+     * represented by a LoadSegment and the zero-initialized tail, if any, by a
+     * FillSegment.
      */
     class ELFDataSource : public DataSource
     {
@@ -193,6 +231,46 @@ protected:
             unsigned m_sectionIndex; //!< The index of the section this segment represents.
         };
 
+        /*!
+         * \brief Represents the file-backed part of one #PT_LOAD program segment.
+         */
+        class LoadSegment : public DataSource::Segment
+        {
+        public:
+            LoadSegment(ELFDataSource &source, StELFFile *elf, unsigned index);
+
+            virtual unsigned getData(unsigned offset, unsigned maxBytes, uint8_t *buffer);
+            virtual unsigned getLength();
+
+            virtual bool hasNaturalLocation() { return true; }
+            virtual uint32_t getBaseAddress();
+
+        protected:
+            StELFFile *m_elf;        //!< The format parser instance for this ELF file.
+            unsigned m_segmentIndex; //!< The index of the program header this segment represents.
+        };
+
+        /*!
+         * \brief Represents the zero-filled tail of one #PT_LOAD program segment.
+         *
+         * This is the part of the segment beyond #Elf32_Phdr::p_filesz, up to
+         * #Elf32_Phdr::p_memsz, which is usually the .bss section.
+         */
+        class FillSegment : public DataSource::PatternSegment
+        {
+        public:
+            FillSegment(ELFDataSource &source, StELFFile *elf, unsigned index);
+
+            virtual unsigned getLength();
+
+            virtual bool hasNaturalLocation() { return true; }
+            virtual uint32_t getBaseAddress();
+
+        protected:
+            StELFFile *m_elf;        //!< The format parser instance for this ELF file.
+            unsigned m_segmentIndex; //!< The index of the program header this segment represents.
+        };
+
     public:
         //! \brief Default constructor.
         ELFDataSource(StELFFile *elf)
@@ -210,6 +288,9 @@ protected:
         //! \brief Adds the ELF section at position \a sectionIndex to the data source.
         void addSection(unsigned sectionIndex);
 
+        //! \brief Adds the ELF program segment at position \a segmentIndex to the data source.
+        void addProgramSegment(unsigned segmentIndex);
+
         //! \brief Returns the number of segments in the source.
         virtual unsigned getSegmentCount() { return (unsigned)m_segments.size(); }
         //! \brief Returns the segment at position \a index.
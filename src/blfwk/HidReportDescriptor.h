@@ -0,0 +1,75 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_HidReportDescriptor_h_)
+#define _HidReportDescriptor_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+
+namespace blfwk
+{
+/*!
+ * \brief Sizes of the reports of a HID device, taken from its report descriptor.
+ *
+ * Full speed targets use 64 byte reports, while high speed ones may declare reports
+ * of up to 1024 bytes. Each report carries one packet behind a small header, so
+ * knowing the actual sizes lets the host use the largest reports the target takes
+ * and size its buffers to match, instead of assuming one size for every target.
+ */
+class HidReportDescriptor
+{
+public:
+    //! \brief Constructor. No report is described until parse() or read() succeeds.
+    HidReportDescriptor()
+        : m_inputBits()
+        , m_outputBits()
+    {
+    }
+
+    //! \brief Parses the report descriptor \a data of \a length bytes.
+    //!
+    //! \return False if the descriptor is malformed, in which case no report is described.
+    bool parse(const uint8_t *data, size_t length);
+
+    //! \brief Reads and parses the report descriptor of the hidraw node \a devicePath.
+    //!
+    //! \return False if it cannot be read, which is always the case on platforms other than Linux.
+    bool read(const std::string &devicePath);
+
+    //! \brief Returns the size of input report \a reportId in bytes, including the report ID,
+    //! or 0 if it is not described.
+    uint32_t getInputReportSize(uint8_t reportId) const { return getReportSize(m_inputBits, reportId); }
+
+    //! \brief Returns the size of output report \a reportId in bytes, including the report ID,
+    //! or 0 if it is not described.
+    uint32_t getOutputReportSize(uint8_t reportId) const { return getReportSize(m_outputBits, reportId); }
+
+    //! \brief Returns the size of the largest input report in bytes, or 0 if none is described.
+    uint32_t getMaxInputReportSize() const { return getMaxReportSize(m_inputBits); }
+
+    //! \brief Returns the size of the largest output report in bytes, or 0 if none is described.
+    uint32_t getMaxOutputReportSize() const { return getMaxReportSize(m_outputBits); }
+
+protected:
+    typedef std::map<uint8_t, uint32_t> report_bits_t; //!< Size in bits of each report, by report ID.
+
+    //! \brief Returns the size in bytes of report \a reportId of \a reports.
+    static uint32_t getReportSize(const report_bits_t &reports, uint8_t reportId);
+
+    //! \brief Returns the size in bytes of the largest report of \a reports.
+    static uint32_t getMaxReportSize(const report_bits_t &reports);
+
+protected:
+    report_bits_t m_inputBits;  //!< Sizes of the input reports.
+    report_bits_t m_outputBits; //!< Sizes of the output reports.
+};
+
+}; // namespace blfwk
+
+#endif // _HidReportDescriptor_h_
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_ImageCache_h_)
+#define _ImageCache_h_
+
+#include <string>
+#include <vector>
+#include "DataSource.h"
+#include "MappedFile.h"
+#include "smart_ptr.h"
+
+namespace blfwk
+{
+/*!
+ * \brief On-disk cache of parsed image files.
+ *
+ * Parsing a large ELF, S-record or Intel Hex file costs far more than reading
+ * it. The cache stores the segments produced by parsing a file, keyed by the
+ * SHA-256 digest of the file contents and of the options used to parse it. When
+ * the same file is used again, its segments are memory mapped straight from the
+ * cache file instead of being parsed.
+ *
+ * Each cache file holds a header, a table of segments and the segment data.
+ * Segments whose bytes all have the same value are stored as a fill byte, without
+ * any data. The cache directory must already exist. Cache files that are corrupt
+ * or were written by another version are ignored.
+ */
+class ImageCache
+{
+public:
+    //! \brief Constructor.
+    ImageCache(const std::string &directory)
+        : m_directory(directory)
+    {
+    }
+
+    //! \brief Returns the cache key for the file at \a path parsed with \a options.
+    std::string makeKey(const std::string &path, const std::string &options);
+
+    //! \brief Returns a data source for the cached image with \a key, or NULL.
+    DataSource *load(const std::string &key);
+
+    //! \brief Stores the segments of \a source in the cache under \a key.
+    void store(const std::string &key, DataSource &source);
+
+    //! \brief Returns the path of the cache file for \a key.
+    std::string getCachePath(const std::string &key) const;
+
+protected:
+    std::string m_directory; //!< Directory holding the cache files.
+};
+
+/*!
+ * \brief Data source whose segments are mapped from an image cache file.
+ */
+class CachedDataSource : public DataSource
+{
+public:
+    /*!
+     * \brief Segment of a cached image.
+     *
+     * The data of the segment points directly into the mapped cache file. Fill
+     * segments have no data, only a fill byte.
+     */
+    class CachedSegment : public DataSource::Segment
+    {
+    public:
+        CachedSegment(DataSource &source, uint32_t address, unsigned length, const uint8_t *data, uint8_t fill)
+            : DataSource::Segment(source)
+            , m_address(address)
+            , m_length(length)
+            , m_data(data)
+            , m_fill(fill)
+        {
+        }
+
+        virtual unsigned getData(unsigned offset, unsigned maxBytes, uint8_t *buffer);
+        virtual unsigned getLength() { return m_length; }
+        virtual bool hasNaturalLocation() { return true; }
+        virtual uint32_t getBaseAddress() { return m_address; }
+
+    protected:
+        uint32_t m_address;    //!< Address of the first byte.
+        unsigned m_length;     //!< Length in bytes.
+        const uint8_t *m_data; //!< Segment data in the mapping, or NULL for a fill segment.
+        uint8_t m_fill;        //!< Value of every byte of a fill segment.
+    };
+
+public:
+    //! \brief Constructor. Takes ownership of \a mapping.
+    CachedDataSource(MappedFile *mapping)
+        : DataSource()
+        , m_mapping(mapping)
+    {
+    }
+
+    //! \brief Destructor.
+    virtual ~CachedDataSource();
+
+    //! \brief Adds a segment.
+    void addSegment(uint32_t address, unsigned length, const uint8_t *data, uint8_t fill);
+
+    //! \name DataSource
+    //@{
+    virtual unsigned getSegmentCount() { return static_cast<unsigned>(m_segments.size()); }
+    virtual DataSource::Segment *getSegmentAt(unsigned index)
+    {
+        return index < m_segments.size() ? m_segments[index] : NULL;
+    }
+    //@}
+
+protected:
+    smart_ptr<MappedFile> m_mapping;         //!< Mapping of the cache file.
+    std::vector<CachedSegment *> m_segments; //!< Segments, owned by this object.
+};
+
+}; // namespace blfwk
+
+#endif // _ImageCache_h_
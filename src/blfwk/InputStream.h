@@ -0,0 +1,176 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_InputStream_h_)
+#define _InputStream_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ChunkedTextParser.h"
+
+namespace blfwk
+{
+/*!
+ * \brief Sequential, non-seekable source of bytes.
+ *
+ * Input streams read files that cannot be memory mapped or seeked, such as the
+ * standard input, pipes and compressed files. Use open() to create the right kind
+ * of stream for a path. Data can be looked at with peek() before it is read.
+ */
+class InputStream
+{
+public:
+    //! \brief Path that selects the standard input.
+    static const char *const kStdinPath;
+
+    //! \brief Opens \a path, decompressing it if it is gzip or zstd compressed.
+    static InputStream *open(const std::string &path);
+
+    //! \brief Returns true if \a path must be read through an input stream.
+    static bool isStreamingPath(const std::string &path);
+
+    //! \brief Destructor.
+    virtual ~InputStream() {}
+
+    //! \brief Reads up to \a size bytes into \a buffer.
+    //!
+    //! Blocks until at least one byte is available. Returns 0 only at the end of
+    //! the stream.
+    size_t read(uint8_t *buffer, size_t size);
+
+    //! \brief Copies up to \a size bytes into \a buffer without consuming them.
+    //!
+    //! Returns fewer than \a size bytes only if the stream ends first.
+    size_t peek(uint8_t *buffer, size_t size);
+
+    //! \brief Calls \a handler for every non-empty line of the rest of the stream.
+    //!
+    //! Lines are split as by ChunkedTextParser::forEachLine(). Iteration stops early
+    //! if the handler returns false.
+    template <typename F>
+    void forEachLine(F handler)
+    {
+        std::vector<char> buffer(kLineBufferSize);
+        size_t used = 0;
+        bool isStopped = false;
+        for (;;)
+        {
+            if (used == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+            size_t count = read(reinterpret_cast<uint8_t *>(&buffer[used]), buffer.size() - used);
+            used += count;
+
+            // Hand over every complete line and keep the partial last line for the next read.
+            size_t end = used;
+            if (count)
+            {
+                while (end && buffer[end - 1] != '\r' && buffer[end - 1] != '\n')
+                {
+                    --end;
+                }
+            }
+
+            ChunkedTextParser::Chunk chunk;
+            chunk.m_begin = &buffer[0];
+            chunk.m_end = chunk.m_begin + end;
+            ChunkedTextParser::forEachLine(chunk, [&](const char *line, unsigned length) -> bool {
+                isStopped = !handler(line, length);
+                return !isStopped;
+            });
+            if (isStopped || !count)
+            {
+                return;
+            }
+
+            std::copy(buffer.begin() + end, buffer.begin() + used, buffer.begin());
+            used -= end;
+        }
+    }
+
+protected:
+    //! \brief Size of the buffer used by forEachLine(), and the initial limit on line length.
+    static const size_t kLineBufferSize = 64 * 1024;
+
+    //! \brief Reads up to \a size bytes into \a buffer, returning 0 only at the end.
+    //!
+    //! Subclasses throw std::runtime_error if the data cannot be read.
+    virtual size_t readData(uint8_t *buffer, size_t size) = 0;
+
+protected:
+    std::vector<uint8_t> m_peeked; //!< Data returned by peek() and not yet read.
+};
+
+/*!
+ * \brief Input stream that reads another stream on a helper thread.
+ *
+ * The helper thread reads blocks of data ahead of the consumer into a bounded
+ * queue. When the inner stream decompresses its data, decompression overlaps with
+ * whatever the consumer does with the data, such as sending it to the device.
+ *
+ * The state used by the helper thread is shared with it, so that a thread blocked
+ * reading the inner stream can be left behind when the stream is destroyed.
+ */
+class PrefetchInputStream : public InputStream
+{
+public:
+    //! \brief Size of the blocks read by the helper thread.
+    static const size_t kDefaultBlockSize = 256 * 1024;
+
+    //! \brief Default number of blocks the helper thread may read ahead.
+    static const unsigned kDefaultQueueDepth = 8;
+
+    //! \brief Constructor. Takes ownership of \a input and starts the helper thread.
+    PrefetchInputStream(InputStream *input,
+                        size_t blockSize = kDefaultBlockSize,
+                        unsigned queueDepth = kDefaultQueueDepth);
+
+    //! \brief Destructor.
+    virtual ~PrefetchInputStream();
+
+protected:
+    //! \brief State shared by the stream and its helper thread.
+    struct SharedState
+    {
+        SharedState(InputStream *input, size_t blockSize, unsigned queueDepth);
+        ~SharedState();
+
+        InputStream *m_input;                      //!< Stream read by the helper thread.
+        size_t m_blockSize;                        //!< Size of the blocks read by the helper thread.
+        unsigned m_queueDepth;                     //!< Maximum number of queued blocks.
+        std::mutex m_mutex;                        //!< Protects the members below.
+        std::condition_variable m_condition;       //!< Signalled when the queue or state changes.
+        std::deque<std::vector<uint8_t> > m_queue; //!< Blocks read ahead.
+        bool m_isFinished;                         //!< Whether the helper thread has stopped.
+        bool m_isCancelled;                        //!< Whether the consumer wants no more data.
+        std::exception_ptr m_error;                //!< Exception thrown by the inner stream.
+    };
+
+    virtual size_t readData(uint8_t *buffer, size_t size);
+
+    //! \brief Helper thread function.
+    static void runReader(std::shared_ptr<SharedState> state);
+
+protected:
+    std::shared_ptr<SharedState> m_state; //!< State shared with the helper thread.
+    std::vector<uint8_t> m_block;         //!< Block being consumed.
+    size_t m_blockOffset;                 //!< Offset of the next unread byte of #m_block.
+    std::thread m_thread;                 //!< Helper thread.
+};
+
+}; // namespace blfwk
+
+#endif // _InputStream_h_
@@ -10,6 +10,7 @@
 #include "SourceFile.h"
 #include "StIntelHexFile.h"
 #include "StExecutableImage.h"
+#include "MappedFile.h"
 
 namespace blfwk
 {
@@ -51,6 +52,12 @@ public:
     //@{
     //! \brief Returns data source for the entire file.
     virtual DataSource *createDataSource();
+
+    //! \brief Returns a data source that parses the file while its data is consumed.
+    virtual StreamingDataSource *createStreamingDataSource();
+
+    //! \brief Returns a data source that parses Intel Hex records from \a input while its data is consumed.
+    static StreamingDataSource *createStreamingDataSource(InputStream *input);
     //@}
 
     //! \name Entry point
@@ -67,10 +74,17 @@ protected:
     StExecutableImage *m_image;             //!< Memory image of the Intel Hex file..
     bool m_hasEntryRecord;                  //!< Whether a type 03 or 05 record was found.
     StIntelHexFile::IntelHex m_entryRecord; //!< Record for the entry point.
+    uint32_t m_entryPointAddress;           //!< Entry point address from #m_entryRecord.
 
 protected:
     //! \brief Build memory image of the Intel Hex file.
     void buildMemoryImage();
+
+    //! \brief Build memory image by parsing a mapping of the file in parallel.
+    void buildMemoryImage(const MappedFile &mapping);
+
+    //! \brief Adds the data of the Intel Hex record in \a line to a streaming data source.
+    static bool addRecordData(StreamingDataSource &source, const char *line, unsigned length, uint32_t &baseAddress);
 };
 
 }; // namespace blfwk
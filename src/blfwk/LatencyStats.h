@@ -0,0 +1,50 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_LatencyStats_h_)
+#define _LatencyStats_h_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Logging.h"
+
+namespace blfwk
+{
+/*!
+ * \brief Collects latency samples and reports their distribution.
+ *
+ * Every sample is kept, so percentiles are exact. A sample takes four bytes, which
+ * is small next to the data moved for it.
+ */
+class LatencyStats
+{
+public:
+    //! \brief Constructor.
+    LatencyStats() {}
+
+    //! \brief Adds a sample of \a us microseconds.
+    void add(uint64_t us) { m_samples.push_back((us > UINT32_MAX) ? UINT32_MAX : (uint32_t)us); }
+
+    //! \brief Discards all samples.
+    void clear() { m_samples.clear(); }
+
+    //! \brief Returns the number of samples.
+    size_t getCount() const { return m_samples.size(); }
+
+    //! \brief Logs the distribution of the samples at \a level, headed by \a name.
+    //!
+    //! Prints the minimum, mean, median, 99th and 99.9th percentiles and maximum, followed
+    //! by a histogram with power of two buckets.
+    void log(Logger::log_level_t level, const std::string &name) const;
+
+protected:
+    std::vector<uint32_t> m_samples; //!< Samples in microseconds.
+};
+
+}; // namespace blfwk
+
+#endif // _LatencyStats_h_
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_MappedFile_h_)
+#define _MappedFile_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace blfwk
+{
+/*!
+ * \brief Read-only memory mapping of an entire file.
+ *
+ * The file contents are mapped into the address space of the process so that
+ * parsers can access any byte of the file in place, without seeking and without
+ * copying the data into heap buffers. Only the pages that are actually touched
+ * are read in by the operating system, so large portions of a file that are never
+ * looked at (such as ELF debug sections) cost neither I/O nor memory.
+ *
+ * The mapping stays valid for the life of the object.
+ */
+class MappedFile
+{
+public:
+    //! \brief Constructor. Maps the file at \a path.
+    MappedFile(const std::string &path);
+
+    //! \brief Destructor. Unmaps the file.
+    virtual ~MappedFile();
+
+    //! \brief Returns a pointer to the first byte of the mapped file.
+    inline const uint8_t *getData() const { return m_data; }
+    //! \brief Returns the size in bytes of the mapped file.
+    inline size_t getSize() const { return m_size; }
+    //! \brief Returns the path of the mapped file.
+    inline const std::string &getPath() const { return m_path; }
+    //! \brief Returns true if the range [\a offset, \a offset + \a length) is within the file.
+    inline bool contains(uint64_t offset, uint64_t length) const
+    {
+        return (offset <= m_size) && (length <= m_size - offset);
+    }
+
+protected:
+    std::string m_path;    //!< Path of the mapped file.
+    const uint8_t *m_data; //!< Base of the mapping, or NULL for an empty file.
+    size_t m_size;         //!< Size in bytes of the mapping.
+#if defined(WIN32)
+    void *m_fileHandle;    //!< Handle of the open file.
+    void *m_mappingHandle; //!< Handle of the file mapping object.
+#endif
+
+private:
+    //! \brief Copying is not allowed.
+    MappedFile(const MappedFile &other);
+    MappedFile &operator=(const MappedFile &other);
+};
+
+}; // namespace blfwk
+
+#endif // _MappedFile_h_
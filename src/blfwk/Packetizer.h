@@ -10,8 +10,11 @@
 
 #include "bootloader_common.h"
 #include "bootloader/bl_peripheral.h"
+#include "Deadline.h"
+#include "LatencyStats.h"
 
 #include <time.h>
+#include <vector>
 
 //! @addtogroup host_packetizers
 //! @{
@@ -30,6 +33,19 @@ enum _packetizer_status
     kStatus_NoCommandResponse = MAKE_STATUS(kStatusGroup_Packetizer, 3)
 };
 
+/*!
+ * @brief Packet framed ahead of writing it.
+ *
+ * Filled by Packetizer::preparePacket() and sent by Packetizer::writePreparedPacket().
+ */
+struct PreparedPacket
+{
+    const uint8_t *data;        //!< Packet payload. Must not change until the packet has been written.
+    uint32_t byteCount;         //!< Number of payload bytes.
+    packet_type_t packetType;   //!< Type of the packet.
+    std::vector<uint8_t> frame; //!< Framed packet, if the packetizer frames packets ahead.
+};
+
 /*!
  * @brief Interface class for packetization of commands and data.
  */
@@ -43,6 +59,7 @@ public:
         , m_options(0)
         , m_isAbortEnabled(false)
         , m_readCount(0)
+        , m_commandDeadline(Deadline::never())
     {
     }
 
@@ -54,6 +71,27 @@ public:
     //! @brief Write a packet.
     virtual status_t writePacket(const uint8_t *packet, uint32_t byteCount, packet_type_t packetType) = 0;
 
+    //! @brief Frame a packet so that it can be written later with writePreparedPacket().
+    //!
+    //! Only touches @a prepared, so it may run on another thread while a different
+    //! packet is written. The default implementation does no framing ahead.
+    virtual void preparePacket(PreparedPacket &prepared,
+                               const uint8_t *packet,
+                               uint32_t byteCount,
+                               packet_type_t packetType)
+    {
+        prepared.data = packet;
+        prepared.byteCount = byteCount;
+        prepared.packetType = packetType;
+        prepared.frame.clear();
+    }
+
+    //! @brief Write a packet framed by preparePacket().
+    virtual status_t writePreparedPacket(PreparedPacket &prepared)
+    {
+        return writePacket(prepared.data, prepared.byteCount, prepared.packetType);
+    }
+
     //! @brief Abort data phase.
     virtual void abortPacket() = 0;
 
@@ -89,6 +127,22 @@ public:
     void setAbortEnabled(bool isEnabled) { m_isAbortEnabled = isEnabled; }
     //! @biref Check if abort data phase is enabled.
     bool isAbortEnabled() { return m_isAbortEnabled; }
+    //! @brief Set the time in milliseconds that each packet read may take.
+    void setPacketTimeout(uint32_t timeoutMs) { m_packetTimeoutMs = timeoutMs; }
+    //! @brief Get the time in milliseconds that each packet read may take.
+    uint32_t getPacketTimeout() const { return m_packetTimeoutMs; }
+    //! @brief Set the deadline of the current command, which limits every packet read until it is reset.
+    void setCommandDeadline(const Deadline &deadline) { m_commandDeadline = deadline; }
+    //! @brief Get the deadline of the current command.
+    const Deadline &getCommandDeadline() const { return m_commandDeadline; }
+    //! @brief Get the deadline of a packet read starting now.
+    //!
+    //! A packet must be received within the packet timeout, and within the deadline of the command.
+    Deadline getPacketDeadline() const { return Deadline::earliest(Deadline(m_packetTimeoutMs), m_commandDeadline); }
+    //! @brief Get the latencies from the end of a write to the ACK or response that answers it.
+    const LatencyStats &getLatencyStats() const { return m_latencyStats; }
+    //! @brief Make the packet buffers resident, so that using them does not cause page faults.
+    virtual void prefaultBuffers() {}
 protected:
     Peripheral *m_peripheral;     //!< Peripheral to send/receive bytes on.
     standard_version_t m_version; //!< Framing protocol version.
@@ -96,6 +150,8 @@ protected:
     uint32_t m_packetTimeoutMs;
     bool m_isAbortEnabled; //!< True if allowing abort packet. Not used by all packetizers.
     uint32_t m_readCount;  //!< Optional control of number of bytes requested by readPacket().
+    Deadline m_commandDeadline; //!< Deadline of the current command.
+    LatencyStats m_latencyStats; //!< Latencies from the end of a write to its answer.
 };
 
 } // namespace blfwk
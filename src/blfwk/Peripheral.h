@@ -50,6 +50,7 @@ public:
         unsigned short usbHidPid;
         std::string usbHidSerialNumber;
         std::string usbPath;
+        uint32_t usbHidQueueDepth; //!< Output reports in flight with the usbfs backend, or 0 to use hidapi.
 #if defined(LINUX) && defined(__ARM__)
         unsigned char i2cAddress;
         unsigned char spiPolarity;
@@ -58,6 +59,7 @@ public:
 #endif // #if defined(LINUX) && defined(__ARM__)
         BusPal::BusPalConfigData busPalConfig;
         LpcUsbSio::LpcUsbSioConfigData lpcUsbSioConfig;
+        uint32_t comPortOptions;
     };
 
     virtual ~Peripheral(){};
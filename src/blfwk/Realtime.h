@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_Realtime_h_)
+#define _Realtime_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace blfwk
+{
+/*!
+ * \brief Real-time scheduling of the host tool.
+ *
+ * On a loaded host, preemption delays the handling of every ACK and response, which
+ * stretches transfers and can make the target time out. The real-time mode pins the
+ * I/O thread to one CPU and runs it with the SCHED_FIFO policy, so that it is not
+ * preempted by normal processes. The memory mapped when it is enabled and the packet
+ * buffers are locked, so that the I/O is not stalled by page faults.
+ *
+ * Threads created after enable() inherit the CPU and policy, so that the I/O threads
+ * the peripheral starts run in real-time mode too. Helper threads that do not do I/O,
+ * such as parsers and readers of the input file, call leave() when they start so that
+ * they do not compete with the I/O thread for its CPU.
+ */
+class Realtime
+{
+public:
+    //! \brief Default SCHED_FIFO priority.
+    static const int kDefaultPriority = 50;
+
+    //! \brief CPU value that keeps the current CPU affinity.
+    static const int kAnyCpu = -1;
+
+    //! \brief Size of the stack touched by enable() so that it is resident.
+    static const size_t kPrefaultStackSize = 256 * 1024;
+
+    //! \brief Switches the calling thread to real-time scheduling.
+    //!
+    //! Pins it to \a cpu unless it is #kAnyCpu, sets the SCHED_FIFO policy with
+    //! \a priority, pre-faults the stack and locks the memory mapped so far. Memory
+    //! mapped later, such as the input file, is not locked. Steps that fail, usually for
+    //! lack of privileges, are skipped with a warning.
+    //!
+    //! \return True if every step succeeded.
+    static bool enable(int cpu, int priority);
+
+    //! \brief Returns the calling thread to the scheduling it had before enable().
+    //!
+    //! Does nothing if enable() was not called.
+    static void leave();
+
+    //! \brief Touches every page of the \a size bytes at \a buffer so that they are resident.
+    //!
+    //! In real-time mode the pages are also locked.
+    static void prefault(void *buffer, size_t size);
+
+protected:
+    //! \brief Touches #kPrefaultStackSize bytes of the stack below the caller.
+    static void prefaultStack();
+};
+
+}; // namespace blfwk
+
+#endif // _Realtime_h_
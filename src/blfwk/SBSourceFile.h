@@ -30,6 +30,9 @@ public:
     //! \brief Identifies whether the stream contains an SB file.
     static bool isSBFile(std::istream &stream);
 
+    //! \brief Determines whether the target may end the transfer of an SB file early.
+    static bool canAbortTransfer(std::istream &stream);
+
     //! \name Data source creation
     //@{
     //! \brief Creates an unmapped data source from the entire file.
@@ -113,8 +116,51 @@ protected:
         uint8_t m_padding1[6];        //!< Padding to round up to next cipher block.
     };
 
+    //! \brief Structure for a boot command.
+    //!
+    //! Every boot command, including section tags, occupies exactly one cipher block.
+    //! The data of a load command follows it, padded to a whole number of cipher blocks.
+    struct boot_command_t
+    {
+        uint8_t m_checksum; //!< Simple checksum over the other command fields.
+        uint8_t m_tag;      //!< Tag telling which command this is.
+        uint16_t m_flags;   //!< Flags for this command.
+        uint32_t m_address; //!< Target address.
+        uint32_t m_count;   //!< Number of bytes on which to operate.
+        uint32_t m_data;    //!< Additional data used by certain commands.
+    };
+
 #pragma pack()
 
+    //! Boot command tags.
+    enum
+    {
+        ROM_NOP_CMD = 0x00,        //!< No operation.
+        ROM_TAG_CMD = 0x01,        //!< Section tag.
+        ROM_LOAD_CMD = 0x02,       //!< Load data.
+        ROM_FILL_CMD = 0x03,       //!< Fill memory with a pattern.
+        ROM_JUMP_CMD = 0x04,       //!< Jump to an address, never returns.
+        ROM_CALL_CMD = 0x05,       //!< Call a function.
+        ROM_MODE_CMD = 0x06,       //!< Change boot mode.
+        ROM_ERASE_CMD = 0x07,      //!< Erase flash.
+        ROM_RESET_CMD = 0x08,      //!< Reset the target.
+        ROM_MEM_ENABLE_CMD = 0x09, //!< Configure and enable a memory.
+        ROM_PROG_CMD = 0x0a,       //!< Program persistent bits.
+        ROM_FW_VER_CHK = 0x0b      //!< Check the firmware version.
+    };
+
+    //! Flag of a section tag command marking the last section.
+    static const uint16_t ROM_LAST_TAG = 0x0001;
+
+    //! Section flag of a section that contains boot commands.
+    static const uint32_t ROM_SECTION_BOOTABLE = 0x00000001;
+
+    //! Size in bytes of a cipher block, the unit of all offsets and lengths in an SB file.
+    static const unsigned kCipherBlockSize = sizeof(cipher_block_t);
+
+    //! \brief Reads the boot command at \a offset and checks its checksum.
+    static bool readBootCommand(std::istream &stream, uint64_t offset, boot_command_t &command);
+
 public:
     /*!
      * \brief Simple exception thrown to indicate an error in the input SB file format.
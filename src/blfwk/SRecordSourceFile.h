@@ -10,6 +10,8 @@
 #include "SourceFile.h"
 #include "StSRecordFile.h"
 #include "StExecutableImage.h"
+#include "MappedFile.h"
+#include <vector>
 
 namespace blfwk
 {
@@ -54,6 +56,12 @@ public:
     //@{
     //! \brief Returns data source for the entire file.
     virtual DataSource *createDataSource();
+
+    //! \brief Returns a data source that parses the file while its data is consumed.
+    virtual StreamingDataSource *createStreamingDataSource();
+
+    //! \brief Returns a data source that parses S-records from \a input while its data is consumed.
+    static StreamingDataSource *createStreamingDataSource(InputStream *input);
     //@}
 
     //! \name Entry point
@@ -66,14 +74,21 @@ public:
     //@}
 
 protected:
-    StSRecordFile *m_file;                //!< S-record parser instance.
-    StExecutableImage *m_image;           //!< Memory image of the S-record file.
-    bool m_hasEntryRecord;                //!< Whether an S7,8,9 record was found.
-    StSRecordFile::SRecord m_entryRecord; //!< Record for the entry point.
+    StSRecordFile *m_file;                  //!< S-record parser instance.
+    StExecutableImage *m_image;             //!< Memory image of the S-record file.
+    bool m_hasEntryRecord;                  //!< Whether an S7,8,9 record was found.
+    StSRecordFile::SRecord m_entryRecord;   //!< Record for the entry point.
+    std::vector<uint8_t> m_entryRecordData; //!< Data of #m_entryRecord when parsed from a mapped file.
 
 protected:
     //! \brief Build memory image of the S-record file.
     void buildMemoryImage();
+
+    //! \brief Build memory image by parsing a mapping of the file in parallel.
+    void buildMemoryImage(const MappedFile &mapping);
+
+    //! \brief Adds the data of the S-record in \a line to a streaming data source.
+    static bool addRecordData(StreamingDataSource &source, const char *line, unsigned length);
 };
 
 }; // namespace blfwk
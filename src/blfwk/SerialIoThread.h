@@ -0,0 +1,99 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_SerialIoThread_h_)
+#define _SerialIoThread_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SpscRing.h"
+
+namespace blfwk
+{
+/*!
+ * \brief Helper thread that moves data between a serial port and a pair of rings.
+ *
+ * The thread waits on the port and drains every byte as soon as it arrives into the
+ * receive ring, and sends whatever is queued in the transmit ring. read() only copies
+ * from the ring, so bytes that arrive while the caller is busy computing CRCs, writing
+ * files or logging are already in user space when it asks for them, and a read of one
+ * byte at a time does not cost a system call per byte. write() returns once the thread
+ * has handed the data to the port, as a direct write would.
+ *
+ * The rings are lock-free. The mutex and condition variable are only used to sleep
+ * when a ring is empty or full, and are only signalled when the other side sleeps.
+ *
+ * Only supported on POSIX systems.
+ */
+class SerialIoThread
+{
+public:
+    //! \brief Default size of each ring, in bytes.
+    static const size_t kDefaultRingSize = 64 * 1024;
+
+    //! \brief Constructor. Starts the thread on the open port \a fd.
+    //!
+    //! \exception std::runtime_error Thrown if the thread cannot be started.
+    explicit SerialIoThread(int fd, size_t ringSize = kDefaultRingSize);
+
+    //! \brief Destructor. Sends any queued data and stops the thread. Does not close the port.
+    ~SerialIoThread();
+
+    //! \brief Reads \a size bytes into \a buffer.
+    //!
+    //! Returns early if the bytes do not all arrive within \a timeoutMs milliseconds, measured on
+    //! the monotonic clock, or if the port fails.
+    //!
+    //! \return The number of bytes read.
+    uint32_t read(uint8_t *buffer, uint32_t size, uint32_t timeoutMs);
+
+    //! \brief Sends \a size bytes at \a buffer.
+    //!
+    //! Waits while the transmit ring is full, and until the thread has written all of the data to the port.
+    //!
+    //! \return False if the port has failed.
+    bool write(const uint8_t *buffer, uint32_t size);
+
+    //! \brief Discards all received data that has not been read yet.
+    void flushRX() { m_rxRing.clear(); }
+
+    //! \brief Returns true if reading from or writing to the port failed.
+    bool isFailed() const { return m_isFailed; }
+
+protected:
+    //! \brief Thread function.
+    void run();
+
+    //! \brief Makes the thread re-evaluate what to wait for.
+    void wake();
+
+    //! \brief Wakes the other side if it sleeps waiting for \a isWaiting.
+    void notify(std::atomic<bool> &isWaiting);
+
+protected:
+    int m_fd;                              //!< Serial port file descriptor.
+    int m_wakePipe[2];                     //!< Pipe written to by wake().
+    SpscRing m_rxRing;                     //!< Received data, written by the thread.
+    SpscRing m_txRing;                     //!< Data to send, read by the thread.
+    std::thread m_thread;                  //!< The helper thread.
+    std::atomic<bool> m_isStopped;         //!< Whether the thread should exit once the transmit ring is empty.
+    std::atomic<bool> m_isFailed;          //!< Whether the port has failed.
+    std::atomic<bool> m_isReaderWaiting;   //!< Whether read() sleeps waiting for data.
+    std::atomic<bool> m_isWriterWaiting;   //!< Whether write() sleeps waiting for space or for the data to be sent.
+    uint64_t m_queuedCount;                //!< Number of bytes queued by write().
+    std::atomic<uint64_t> m_sentCount;     //!< Number of bytes written to the port by the thread.
+    std::mutex m_mutex;                    //!< Used with #m_condition.
+    std::condition_variable m_condition;   //!< Signalled when data or space becomes available.
+};
+
+}; // namespace blfwk
+
+#endif // _SerialIoThread_h_
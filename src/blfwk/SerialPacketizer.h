@@ -12,6 +12,8 @@
 #include "UartPeripheral.h"
 #include "bootloader_common.h"
 #include "packet/serial_packet.h"
+#include <chrono>
+#include <vector>
 
 //! @addtogroup serial_packetizer
 //! @{
@@ -27,6 +29,21 @@ class Peripheral;
 class SerialPacketizer : public Packetizer
 {
 public:
+    //! @brief Constants for back-to-back write pacing.
+    enum _back_to_back_constants
+    {
+        kDefaultBackToBackDelayMs = 100, //!< Default maximum delay before a back-to-back write.
+        kBackToBackLearnSamples = 8,     //!< Number of probes needed before the learned gap is used.
+        kBackToBackMarginUs = 2000,      //!< Margin added to the gap after which the receiver answered a probe.
+        kBackToBackMaxBackoffMs = 8      //!< Longest time a probe waits for its answer.
+    };
+
+    //! @brief Constants for pinging.
+    enum _ping_constants
+    {
+        kDefaultPingResponseTimeoutMs = 500 //!< Default time to wait for the response to each ping.
+    };
+
     //! @brief Constructor.
     SerialPacketizer(Peripheral *peripheral, uint32_t packetTimeoutMs);
 
@@ -49,6 +66,15 @@ public:
     //! @param byteCount Number of bytes in packet.
     virtual status_t writePacket(const uint8_t *packet, uint32_t byteCount, packet_type_t packetType);
 
+    //! @brief Build the framing packet, including its crc, into @a prepared.
+    virtual void preparePacket(PreparedPacket &prepared,
+                               const uint8_t *packet,
+                               uint32_t byteCount,
+                               packet_type_t packetType);
+
+    //! @brief Write a packet framed by preparePacket().
+    virtual status_t writePreparedPacket(PreparedPacket &prepared);
+
     //! @brief Abort data phase.
     virtual void abortPacket();
 
@@ -66,10 +92,30 @@ public:
     virtual void setAborted(bool aborted) {}
     //! @brief Return the max packet size.
     virtual uint32_t getMaxPacketSize();
+    //! @brief Make the packet buffers resident.
+    virtual void prefaultBuffers();
 
     //! @brief Delay milliseconds.
     void host_delay(uint32_t milliseconds);
 
+    //! @brief Configure the delay before back-to-back writes.
+    //!
+    //! After the host sends an ACK, the receiver needs time to get back into its
+    //! packet read routine before the next packet can be sent. By default the
+    //! receiver is probed before command packets until it is ready, and the longest
+    //! time it needed is learned and used instead of probing once enough probes have
+    //! been made. Data packets cannot be preceded by probes, so their delay starts at
+    //! @a maxDelayMs and is halved after every data packet the receiver acknowledged.
+    //! A packet the receiver NAKs or does not answer after a shortened delay keeps
+    //! the delay from being shortened that far again. A NAKed packet is sent again
+    //! as usual, but a packet that is not answered is not, since the receiver may
+    //! have taken it and only the ACK been lost.
+    //!
+    //! @param maxDelayMs The longest time to wait. This is also the fixed delay used
+    //!     when adaptive pacing is disabled or not supported by the peripheral.
+    //! @param isAdaptive False to always wait @a maxDelayMs.
+    void setBackToBackDelay(uint32_t maxDelayMs, bool isAdaptive);
+
     //! @brief Send a ping packet and receive an ack.
     //!
     //! This is a method for host only side pinging of the target. The reponse from the
@@ -85,6 +131,24 @@ public:
     virtual status_t ping(
         int retries, unsigned int delay, ping_response_t *response, int comSpeed, int *actualComSpeed);
 
+    //! @brief Ping the target at each of @a comSpeeds in turn until it answers.
+    //!
+    //! Each speed gets @a retries retries. On success the port is left at the speed that
+    //! answered, which is returned in @a actualComSpeed. Several speeds are only supported
+    //! with UART peripherals.
+    status_t pingSpeeds(int retries,
+                        unsigned int delay,
+                        ping_response_t *response,
+                        const std::vector<int> &comSpeeds,
+                        int *actualComSpeed);
+
+    //! @brief Configure the timing of ping attempts.
+    //!
+    //! @param responseTimeoutMs Time to wait for the response to each ping.
+    //! @param maxRetryDelayMs Longest delay between attempts. The delay passed to ping() doubles
+    //!     after every attempt until it reaches this value. 0 keeps the delay fixed.
+    void setPingTiming(uint32_t responseTimeoutMs, uint32_t maxRetryDelayMs);
+
 protected:
     //! @brief Send ACK if needed.
     status_t send_deferred_ack();
@@ -112,28 +176,76 @@ protected:
     //! @brief Send a ping message back in response to a ping.
     status_t serial_send_ping_response();
 
+    //! @brief Send a deferred ACK and wait for the receiver before a packet is written.
+    status_t begin_packet_write(packet_type_t packetType);
+
+    //! @brief Write a framing packet and wait for its ACK.
+    //!
+    //! @a frame must stay valid until the call returns, as it is re-transmitted on NAK.
+    status_t send_framing_packet(const uint8_t *frame, uint32_t frameSize);
+
     //! @brief Wait for an ACK, handling NAKs as needed.
     status_t wait_for_ack_packet();
 
+    //! @brief Wait until the receiver is ready for a back-to-back write.
+    void wait_for_receiver_ready(packet_type_t packetType);
+
+    //! @brief Wait until @a gapUs microseconds have passed since the last sync packet.
+    void wait_since_sync(uint64_t gapUs);
+
+    //! @brief Send a ping and check whether the receiver answers within @a waitMs milliseconds.
+    bool probe_receiver(uint32_t waitMs);
+
+    //! @brief Adjust the back-to-back delays after the write of a paced packet, which succeeded if @a isAcked.
+    void update_back_to_back_delay(bool isAcked);
+
+    //! @brief Read the rest of a ping response whose header has already been read.
+    status_t skip_ping_response(const Deadline &deadline);
+
+    //! @brief Microseconds since the last sync packet was sent.
+    uint64_t get_time_since_sync_us() const;
+
     //! @brief Read from peripheral until entire data framing packet read.
-    status_t read_data_packet(framing_data_packet_t *packet, uint8_t *data, packet_type_t packetType);
+    //!
+    //! All parts of the packet are read within the one @a deadline.
+    status_t read_data_packet(framing_data_packet_t *packet,
+                              uint8_t *data,
+                              packet_type_t packetType,
+                              const Deadline &deadline);
+
+    //! @brief Read bytes from peripheral, returning kStatus_Timeout once @a deadline has passed.
+    status_t read_bytes(uint8_t *buffer, uint32_t byteCount, const Deadline &deadline);
 
     //! @brief Read from peripheral until start byte found.
-    status_t read_start_byte(framing_header_t *header);
+    status_t read_start_byte(framing_header_t *header, const Deadline &deadline);
 
     //! @brief Read from peripheral until packet header found.
-    status_t read_header(framing_header_t *header);
+    status_t read_header(framing_header_t *header, const Deadline &deadline);
 
     //! @brief Read from peripheral until packet length found.
-    status_t read_length(framing_data_packet_t *packet);
+    status_t read_length(framing_data_packet_t *packet, const Deadline &deadline);
 
     //! @brief Read from peripheral until crc16 is found.
-    status_t read_crc16(framing_data_packet_t *packet);
+    status_t read_crc16(framing_data_packet_t *packet, const Deadline &deadline);
 
     //! @brief Calculate crc over framing data packet.
     uint16_t calculate_framing_crc16(framing_data_packet_t *packet, const uint8_t *data);
 
     serial_data_t m_serialContext;
+    uint32_t m_backToBackDelayMs;                          //!< Longest delay before a back-to-back write.
+    bool m_isAdaptiveBackToBack;                           //!< Whether to probe the receiver before writing.
+    bool m_isPacedWrite;                                   //!< Whether the current write followed a shortened gap.
+    bool m_isDataAfterSync;                                //!< Whether the current write is a data packet after a sync.
+    bool m_isNakReceived;                                  //!< Whether the last wait for an ACK received a NAK.
+    uint32_t m_learnedGapUs;                               //!< Longest gap the receiver needed to accept a command.
+    uint32_t m_learnSampleCount;                           //!< Number of probes that contributed to #m_learnedGapUs.
+    uint32_t m_dataGapUs;                                  //!< Gap before a data packet that follows a sync.
+    uint32_t m_dataGapFloorUs;                             //!< Shortest gap the receiver accepted data packets after.
+    std::chrono::steady_clock::time_point m_lastSyncTime; //!< When the last sync packet was sent.
+    const uint8_t *m_lastFrame;                            //!< Framing packet re-transmitted on NAK.
+    uint32_t m_lastFrameSize;                              //!< Size of #m_lastFrame in bytes.
+    uint32_t m_pingResponseTimeoutMs;                      //!< Time to wait for the response to each ping.
+    uint32_t m_pingMaxRetryDelayMs;                        //!< Longest delay between ping attempts.
 };
 
 } // namespace blfwk
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_Sha256_h_)
+#define _Sha256_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace blfwk
+{
+/*!
+ * \brief SHA-256 message digest, as specified by FIPS 180-4.
+ *
+ * Data is passed to update() in any number of pieces, then finish() returns the
+ * digest. The object must not be updated after finish().
+ */
+class Sha256
+{
+public:
+    //! \brief Size of the digest in bytes.
+    static const size_t kDigestSize = 32;
+
+    //! \brief Constructor.
+    Sha256();
+
+    //! \brief Adds \a length bytes at \a data to the message.
+    void update(const void *data, size_t length);
+
+    //! \brief Completes the message and stores its digest in \a digest.
+    void finish(uint8_t *digest);
+
+    //! \brief Completes the message and returns its digest as lowercase hex digits.
+    std::string finishHex();
+
+protected:
+    //! \brief Processes one 64-byte block.
+    void processBlock(const uint8_t *block);
+
+    uint32_t m_state[8];  //!< Intermediate hash value.
+    uint64_t m_length;    //!< Message length in bytes.
+    uint8_t m_block[64];  //!< Partial block not processed yet.
+    size_t m_blockLength; //!< Number of bytes in m_block.
+};
+
+}; // namespace blfwk
+
+#endif // _Sha256_h_
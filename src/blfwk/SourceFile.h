@@ -18,6 +18,9 @@
 
 namespace blfwk
 {
+class InputStream;
+class StreamingDataSource;
+
 /*!
  * \brief Abstract base class for a source file containing executable code.
  *
@@ -36,6 +39,9 @@ public:
     // \brief Factory function that creates the correct subclass of SourceFile.
     static SourceFile *openFile(const std::string &path);
 
+    //! \brief Opens a stream of S-records or Intel Hex records that cannot be mapped or seeked.
+    static StreamingDataSource *openStream(const std::string &path);
+
     //! Set of supported executable image file formats.
     enum source_file_t
     {
@@ -65,7 +71,7 @@ public:
     //! \brief Returns the path to the file.
     inline const std::string &getPath() const { return m_path; }
     //! \brief Get the size in bytes of the file.
-    unsigned getSize() const { return m_size; }
+    uint64_t getSize() const { return m_size; }
     //! \name Opening and closing
     //@{
     //! \brief Opens the file.
@@ -97,6 +103,13 @@ public:
     virtual DataSource *createDataSource(StringMatcher &matcher) { return NULL; }
     //! \brief Creates a data source out of one section of the file.
     virtual DataSource *createDataSource(const std::string &section);
+
+    //! \brief Creates a data source that parses the file while its data is being consumed.
+    //!
+    //! The file does not have to be opened first. Returns NULL if the format does not
+    //! support streaming, or the file cannot be streamed. The caller owns the returned
+    //! object.
+    virtual StreamingDataSource *createStreamingDataSource() { return NULL; }
     //@}
 
     //! \name Entry point
@@ -130,7 +143,7 @@ protected:
     smart_ptr<std::ifstream> m_stream;  //!< File stream, or NULL if file is closed.
     smart_ptr<OptionContext> m_options; //!< Table of option values.
     source_file_t m_filetype;           //!< Image file type.
-    unsigned m_size;                    //!< The size in bytes of the file.
+    uint64_t m_size;                    //!< The size in bytes of the file.
 
     //! \brief Internal access to the input stream object.
     inline std::ifstream *getStream() { return m_stream; }
@@ -12,6 +12,7 @@
 #include "Peripheral.h"
 #include "blfwk/spi.h"
 #include "packet/command_packet.h"
+#include "packet/serial_packet.h"
 
 //! @addtogroup spi_peripheral
 //! @{
@@ -20,6 +21,10 @@ namespace blfwk
 {
 /*!
  * @brief Peripheral that talks to the target device over SPI port hardware.
+ *
+ * Every read is a bus transfer, and the packetizer reads the framing header one field
+ * at a time. Short reads therefore clock in a whole framing header and keep the bytes
+ * not asked for yet, so a header usually takes one transfer and the payload another.
  */
 class SpiPeripheral : public Peripheral
 {
@@ -36,6 +41,8 @@ public:
         kSpiPeripheral_DefaultClockPhase = 1,
         kSpiPeripheral_DefaultBitSequence = 1,
         kSpiPeripheral_DefaultBitsPerWord = 8,
+        // Reads shorter than this clock in this many bytes, and keep the surplus for the next reads.
+        kSpiPeripheral_ReadBurstBytes = sizeof(framing_data_packet_t),
     };
 
 public:
@@ -59,7 +66,8 @@ public:
 
     //! @brief Flush.
     //!
-    //! should be called on an open SPI port in order to flush any remaining data in the SPI RX buffer
+    //! should be called on an open SPI port in order to flush any remaining data in the SPI RX buffer,
+    //! including the bytes clocked in ahead of the reads
     void flushRX();
 
     //! @brief Read bytes.
@@ -93,9 +101,11 @@ protected:
     //! @param direction SPI data transfer bits direction. 1 for LSB, 0 for MSB.
     bool init(const char *port, long speed, uint8_t polarity, uint8_t phase, uint8_t direction);
 
-    int m_fileDescriptor;                    //!< Port file descriptor.
-    uint8_t m_buffer[kDefaultMaxPacketSize]; //!< Buffer for bytes used to build read packet.
-    uint32_t m_current_ReadTimeout;          //!< The last value sent to serial_set_read_timeout().
+    int m_fileDescriptor;                              //!< Port file descriptor.
+    uint8_t m_rxBuffer[kSpiPeripheral_ReadBurstBytes]; //!< Bytes clocked in by the last short read.
+    uint32_t m_rxCount;                                //!< Number of bytes in m_rxBuffer.
+    uint32_t m_rxOffset;                               //!< Number of bytes of m_rxBuffer already read.
+    uint32_t m_current_ReadTimeout;                    //!< The last value sent to serial_set_read_timeout().
 };
 
 } // namespace blfwk
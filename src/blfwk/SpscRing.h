@@ -0,0 +1,113 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_SpscRing_h_)
+#define _SpscRing_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace blfwk
+{
+/*!
+ * \brief Lock-free byte ring buffer for a single producer and a single consumer.
+ *
+ * One thread may call write() while another thread calls read(), without any
+ * locking. The read and write positions increase without wrapping and are only
+ * reduced modulo the capacity when indexing, so a full ring is told apart from an
+ * empty one without wasting a byte.
+ */
+class SpscRing
+{
+public:
+    //! \brief Constructor. \a capacity is rounded up to a power of two.
+    explicit SpscRing(size_t capacity)
+        : m_readPosition(0)
+        , m_writePosition(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        m_buffer.resize(size);
+    }
+
+    //! \brief Returns the number of bytes the ring can hold.
+    size_t getCapacity() const { return m_buffer.size(); }
+
+    //! \brief Returns the number of bytes available to read.
+    size_t getReadAvailable() const
+    {
+        return m_writePosition.load(std::memory_order_acquire) - m_readPosition.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Returns the number of bytes that can be written without overwriting unread data.
+    size_t getWriteAvailable() const
+    {
+        return m_buffer.size() -
+               (m_writePosition.load(std::memory_order_relaxed) - m_readPosition.load(std::memory_order_acquire));
+    }
+
+    //! \brief Copies up to \a size bytes into the ring. Producer only.
+    //!
+    //! \return The number of bytes copied, which is less than \a size if the ring is full.
+    size_t write(const uint8_t *data, size_t size)
+    {
+        size_t position = m_writePosition.load(std::memory_order_relaxed);
+        size = std::min(size, getWriteAvailable());
+        copyIn(position, data, size);
+        m_writePosition.store(position + size, std::memory_order_release);
+        return size;
+    }
+
+    //! \brief Copies up to \a size bytes out of the ring. Consumer only.
+    //!
+    //! \return The number of bytes copied, which is less than \a size if the ring runs empty.
+    size_t read(uint8_t *data, size_t size)
+    {
+        size_t position = m_readPosition.load(std::memory_order_relaxed);
+        size = std::min(size, getReadAvailable());
+        copyOut(position, data, size);
+        m_readPosition.store(position + size, std::memory_order_release);
+        return size;
+    }
+
+    //! \brief Discards all unread data. Consumer only.
+    void clear() { m_readPosition.store(m_writePosition.load(std::memory_order_acquire), std::memory_order_release); }
+
+protected:
+    //! \brief Copies \a size bytes from \a data into the ring, starting at \a position.
+    void copyIn(size_t position, const uint8_t *data, size_t size)
+    {
+        size_t offset = position & (m_buffer.size() - 1);
+        size_t first = std::min(size, m_buffer.size() - offset);
+        memcpy(&m_buffer[offset], data, first);
+        memcpy(&m_buffer[0], data + first, size - first);
+    }
+
+    //! \brief Copies \a size bytes out of the ring into \a data, starting at \a position.
+    void copyOut(size_t position, uint8_t *data, size_t size) const
+    {
+        size_t offset = position & (m_buffer.size() - 1);
+        size_t first = std::min(size, m_buffer.size() - offset);
+        memcpy(data, &m_buffer[offset], first);
+        memcpy(data + first, &m_buffer[0], size - first);
+    }
+
+protected:
+    std::vector<uint8_t> m_buffer;       //!< Ring storage, a power of two in size.
+    std::atomic<size_t> m_readPosition;  //!< Total number of bytes read.
+    std::atomic<size_t> m_writePosition; //!< Total number of bytes written.
+};
+
+}; // namespace blfwk
+
+#endif // _SpscRing_h_
@@ -40,6 +40,12 @@ typedef enum
  * The stream passed into the constructor needs to stay open for the life
  * of the object. This is because calls to getSectionDataAtIndex() and
  * getSegmentDataAtIndex() read the data directly from the input stream.
+ *
+ * Alternatively the parser can work on a memory image of the whole file,
+ * usually a blfwk::MappedFile. The header tables are then parsed in place and
+ * getSectionDataView() returns pointers straight into the image, so only the
+ * parts of the file that are actually used are ever read from disk. The image
+ * must stay valid for the life of the object.
  */
 class StELFFile
 {
@@ -51,6 +57,9 @@ public:
     //! \brief Constructor.
     StELFFile(std::istream &inStream);
 
+    //! \brief Constructor for a file image already in memory.
+    StELFFile(const uint8_t *inData, size_t inSize);
+
     //! \brief Destructor.
     virtual ~StELFFile();
 
@@ -92,6 +101,12 @@ public:
 
     //! \brief Returns the data for the section.
     uint8_t *getSectionData(const_section_iterator inSection);
+
+    //! \brief Returns a read-only view of the section data without copying it.
+    const uint8_t *getSectionDataView(unsigned inIndex);
+
+    //! \brief Returns true if the file is parsed from a memory image rather than a stream.
+    inline bool isMapped() const { return m_mappedData != NULL; }
     //@}
 
     //! \name Segments
@@ -109,6 +124,9 @@ public:
 
     //! \brief Returns the data of the specified segment.
     uint8_t *getSegmentData(const_segment_iterator inSegment);
+
+    //! \brief Returns a read-only view of the segment data without copying it.
+    const uint8_t *getSegmentDataView(unsigned inIndex);
     //@}
 
     //! \name String table
@@ -149,7 +167,9 @@ public:
     //@}
 
 protected:
-    std::istream &m_stream;                   //!< The source stream for the ELF file.
+    std::istream *m_stream;                   //!< The source stream for the ELF file, or NULL if mapped.
+    const uint8_t *m_mappedData;              //!< Memory image of the whole ELF file, or NULL.
+    size_t m_mappedSize;                      //!< Size in bytes of the memory image.
     ELFVariant_t m_elfVariant;                //!< Variant of the ARM ELF format specification.
     std::string m_name;                       //!< File name. (optional)
     Elf32_Ehdr m_header;                      //!< The ELF file header.
@@ -165,9 +185,11 @@ protected:
         uint8_t *m_data; //!< Pointer to section data.
         unsigned m_size; //!< Section data size in bytes.
         bool m_swapped;  //!< Has this section been byte swapped yet? Used for symbol table.
+        bool m_owned;    //!< True if m_data was allocated by us, false if it points into the memory image.
     };
     typedef std::map<unsigned, SectionDataInfo> SectionDataMap;
     SectionDataMap m_sectionDataCache; //!< Cached data of sections.
+    SectionDataMap m_segmentDataCache; //!< Cached data of segments. Only used when parsing a stream.
 
     //! \brief Reads a section's data either from cache or from disk.
     SectionDataInfo &getCachedSectionData(unsigned inSectionIndex);
@@ -175,6 +197,12 @@ protected:
     //! \brief Reads the file, section, and program headers into memory.
     void readFileHeaders();
 
+    //! \brief Reads \a inLength bytes at file offset \a inOffset into \a outData.
+    void readBytes(uint32_t inOffset, uint32_t inLength, void *outData);
+
+    //! \brief Returns a pointer to a whole header table, read with a single access.
+    const uint8_t *readTable(uint32_t inOffset, unsigned inEntrySize, unsigned inCount, std::vector<uint8_t> &buffer);
+
     uint8_t *readSectionData(const Elf32_Shdr &inHeader);
     uint8_t *readSegmentData(const Elf32_Phdr &inHeader);
 
@@ -29,7 +29,10 @@ enum
     INTELHEX_TYPE_START_CHAR_INDEX = 7,
 
     //! Index of the first character of the record type field.
-    INTELHEX_DATA_START_CHAR_INDEX = 9
+    INTELHEX_DATA_START_CHAR_INDEX = 9,
+
+    //! Size of a buffer large enough to hold the data of any Intel Hex record.
+    INTELHEX_MAX_DATA_LENGTH = 256
 };
 
 //! Intel Hex Record Type
@@ -123,6 +126,9 @@ public:
     inline const IntelHex &operator[](unsigned inIndex) { return m_records[inIndex]; }
     //@}
 
+    //! \brief Parses a single Intel Hex record of \a inLength characters at \a inLine.
+    static void parseRecord(const char *inLine, unsigned inLength, IntelHex &outRecord, uint8_t *outData);
+
 protected:
     std::istream &m_stream;          //!< The input stream for the Intel Hex data.
     std::vector<IntelHex> m_records; //!< Vector of Intel Hex in the input data.
@@ -133,9 +139,10 @@ protected:
     //@{
     virtual void parseLine(std::string &inLine);
 
-    bool isHexDigit(char c);
-    int hexDigitToInt(char digit);
+    static bool isHexDigit(char c);
+    static int hexDigitToInt(char digit);
     int readHexByte(std::string &inString, int inIndex);
+    static int readHexByte(const char *inLine, int inIndex);
     //@}
 };
 
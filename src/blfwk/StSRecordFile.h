@@ -23,7 +23,10 @@ enum
     SRECORD_MIN_LENGTH = 10,
 
     //! Index of the first character of the address field.
-    SRECORD_ADDRESS_START_CHAR_INDEX = 4
+    SRECORD_ADDRESS_START_CHAR_INDEX = 4,
+
+    //! Size of a buffer large enough to hold the data of any S-record.
+    SRECORD_MAX_DATA_LENGTH = 256
 };
 
 /*!
@@ -90,6 +93,9 @@ public:
     inline const SRecord &operator[](unsigned inIndex) { return m_records[inIndex]; }
     //@}
 
+    //! \brief Parses a single S-record of \a inLength characters at \a inLine.
+    static void parseRecord(const char *inLine, unsigned inLength, SRecord &outRecord, uint8_t *outData);
+
 protected:
     std::istream &m_stream;         //!< The input stream for the S-record data.
     std::vector<SRecord> m_records; //!< Vector of S-records in the input data.
@@ -100,9 +106,10 @@ protected:
     //@{
     virtual void parseLine(std::string &inLine);
 
-    bool isHexDigit(char c);
-    int hexDigitToInt(char digit);
+    static bool isHexDigit(char c);
+    static int hexDigitToInt(char digit);
     int readHexByte(std::string &inString, int inIndex);
+    static int readHexByte(const char *inLine, int inIndex);
     //@}
 };
 
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_StreamingDataSource_h_)
+#define _StreamingDataSource_h_
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "DataSource.h"
+
+namespace blfwk
+{
+/*!
+ * \brief Data source whose segments are produced while the file is still being parsed.
+ *
+ * A parser function runs on a separate thread and passes the data it finds to
+ * addData(). Contiguous data is collected into chunks of at most a fixed size,
+ * which are placed in a queue of limited depth. The consumer takes the chunks out
+ * of the queue in order with getNextSegment() and can start sending the first chunk
+ * while the rest of the file is still being parsed. When the queue is full the parser
+ * waits, so the memory used never exceeds the queue depth times the chunk size,
+ * whatever the size of the file.
+ *
+ * Unlike other data sources the segments are not randomly accessible, so
+ * getSegmentCount() returns 0. Data is not merged or reordered: chunks are produced in
+ * the order the data appears in the file. Data that overlaps data added before is
+ * rejected with an OverlapException, since it would be written twice.
+ *
+ * Records are checked as they are parsed. Once the parser has failed, getData() of the
+ * chunks returns no more data, so that a chunk being written is cut short rather than
+ * written in full from a file known to be bad.
+ */
+class StreamingDataSource : public DataSource
+{
+public:
+    //! \brief Function that parses a file and passes its data to addData().
+    typedef std::function<void(StreamingDataSource &source)> parser_t;
+
+    enum
+    {
+        kDefaultChunkSize = 1024 * 1024, //!< Default maximum size of each chunk, 1MB.
+        kDefaultQueueDepth = 4           //!< Default number of chunks that may be queued.
+    };
+
+    //! \brief Thrown by addData(), and rethrown by getNextSegment(), when data overlaps earlier data.
+    class OverlapException : public std::runtime_error
+    {
+    public:
+        explicit OverlapException(const std::string &msg)
+            : std::runtime_error(msg)
+        {
+        }
+    };
+
+    /*!
+     * \brief One chunk of contiguous data.
+     *
+     * The segment is owned by whoever received it from getNextSegment().
+     */
+    class ChunkSegment : public DataSource::Segment
+    {
+    public:
+        ChunkSegment(StreamingDataSource &source, uint32_t address)
+            : DataSource::Segment(source)
+            , m_streamingSource(source)
+            , m_address(address)
+        {
+        }
+
+        virtual unsigned getData(unsigned offset, unsigned maxBytes, uint8_t *buffer);
+        virtual unsigned getLength() { return static_cast<unsigned>(m_data.size()); }
+        virtual bool hasNaturalLocation() { return true; }
+        virtual uint32_t getBaseAddress() { return m_address; }
+
+        //! \brief Returns the address just past the end of the chunk.
+        uint32_t getEndAddress() const { return m_address + static_cast<uint32_t>(m_data.size()); }
+
+    protected:
+        friend class StreamingDataSource;
+
+        StreamingDataSource &m_streamingSource; //!< Source that produced the chunk.
+        uint32_t m_address;                     //!< Address of the first byte.
+        std::vector<uint8_t> m_data;            //!< Data of the chunk.
+    };
+
+public:
+    //! \brief Constructor.
+    StreamingDataSource(unsigned chunkSize = kDefaultChunkSize, unsigned queueDepth = kDefaultQueueDepth);
+
+    //! \brief Destructor. Stops the parser thread if it is still running.
+    virtual ~StreamingDataSource();
+
+    //! \brief Starts running \a parser on a separate thread.
+    void start(parser_t parser);
+
+    //! \name Producer interface
+    //@{
+    //! \brief Adds \a length bytes of data located at \a address.
+    void addData(uint32_t address, const uint8_t *data, unsigned length);
+    //@}
+
+    //! \name Consumer interface
+    //@{
+    //! \brief Returns the next chunk, waiting for the parser if needed.
+    ChunkSegment *getNextSegment();
+
+    //! \brief Takes and discards all chunks, so that the whole file is checked.
+    void drain();
+
+    //! \brief Returns true once the parser has stopped with an error.
+    bool hasFailed();
+    //@}
+
+    //! \name DataSource
+    //@{
+    //! \brief Segments are not randomly accessible.
+    virtual unsigned getSegmentCount() { return 0; }
+    //! \brief Segments are not randomly accessible.
+    virtual DataSource::Segment *getSegmentAt(unsigned) { return NULL; }
+    //@}
+
+protected:
+    //! \brief Thrown inside the parser thread when the consumer has gone away.
+    class Cancelled
+    {
+    };
+
+    //! \brief Records the range of \a length bytes at \a address, throwing if it overlaps a range added before.
+    void addRange(uint32_t address, unsigned length);
+
+    //! \brief Moves the chunk being collected to the queue.
+    void flushChunk();
+
+    //! \brief Body of the parser thread.
+    void runParser(parser_t parser);
+
+    unsigned m_chunkSize;                  //!< Maximum size of a chunk.
+    unsigned m_queueDepth;                 //!< Maximum number of queued chunks.
+    ChunkSegment *m_chunk;                 //!< Chunk being collected by the parser thread, or NULL.
+    std::map<uint32_t, uint64_t> m_ranges; //!< Start and end addresses of the data added so far.
+    std::deque<ChunkSegment *> m_queue;    //!< Completed chunks waiting for the consumer.
+    bool m_isFinished;                     //!< Set when the parser has returned.
+    bool m_isCancelled;                    //!< Set when the consumer stops before the end.
+    std::exception_ptr m_error;            //!< Exception thrown by the parser, if any.
+    std::mutex m_mutex;                    //!< Protects the queue and flags.
+    std::condition_variable m_condition;   //!< Signalled whenever the queue or flags change.
+    std::thread m_thread;                  //!< The parser thread.
+};
+
+}; // namespace blfwk
+
+#endif // _StreamingDataSource_h_
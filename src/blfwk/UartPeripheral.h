@@ -17,6 +17,8 @@
 
 namespace blfwk
 {
+class SerialIoThread;
+
 /*!
  * @brief Peripheral that talks to the target device over COM port hardware.
  */
@@ -26,11 +28,27 @@ public:
     //! @breif Constants.
     enum _uart_peripheral_constants
     {
-        // The read() implementation for the UartPeripheral does not use this the timeout parameter.
+        // A read() with this timeout waits as long as the serial timeout set during init() allows.
         kUartPeripheral_UnusedTimeout = 0,
         // Serial timeout is set to this default during init().
         kUartPeripheral_DefaultReadTimeoutMs = 1000,
-        kUartPeripheral_DefaultBaudRate = 9600
+        kUartPeripheral_DefaultBaudRate = 9600,
+        // Latency timer set on USB-UART adapters in low latency mode.
+        kUartPeripheral_LowLatencyTimerMs = 1
+    };
+
+    //! @brief Port options, passed to the constructor as a bit mask.
+    enum _uart_peripheral_options
+    {
+        kUartOption_None = 0,
+        //! Have the driver and USB-UART adapter deliver received bytes immediately (Linux only).
+        kUartOption_LowLatency = (1 << 0),
+        //! Use RTS/CTS hardware flow control. Both lines must be wired to the target.
+        //! Only checked to be accepted by the driver: a pty keeps the setting but has no
+        //! RTS/CTS lines, so the throttling itself can only be tested on real hardware.
+        kUartOption_FlowControl = (1 << 1),
+        //! Drain and fill the port on a dedicated I/O thread (not supported on Windows).
+        kUartOption_IoThread = (1 << 2)
     };
 
 public:
@@ -42,7 +60,8 @@ public:
     //!
     //! @param port OS file path for COM port. For example "COM1" on Windows.
     //! @param speed Port speed, e.g. 9600.
-    UartPeripheral(const char *port, long speed = kUartPeripheral_DefaultBaudRate);
+    //! @param options Bit mask of _uart_peripheral_options.
+    UartPeripheral(const char *port, long speed = kUartPeripheral_DefaultBaudRate, uint32_t options = kUartOption_None);
 
     //! @brief Destructor.
     virtual ~UartPeripheral();
@@ -57,8 +76,9 @@ public:
     //! @param buffer Pointer to buffer.
     //! @param requestedBytes Number of bytes to read.
     //! @param actualBytes Number of bytes actually read.
-    //! @param timeoutMs Time in milliseconds to wait for read to complete.
-    virtual status_t read(uint8_t *buffer, uint32_t requestedBytes, uint32_t *actualBytes, uint32_t unused_timeoutMs);
+    //! @param timeoutMs Time in milliseconds to wait for all bytes to arrive, or kUartPeripheral_UnusedTimeout
+    //!     to use the serial timeout.
+    virtual status_t read(uint8_t *buffer, uint32_t requestedBytes, uint32_t *actualBytes, uint32_t timeoutMs);
 
     //! @brief Write bytes.
     //!
@@ -69,6 +89,14 @@ public:
     //! @brief Return peripheral Type
     virtual _host_peripheral_types get_type(void) { return kHostPeripheralType_UART; }
 
+    //! @brief Change the port speed, discarding any received data.
+    //!
+    //! @return False if the port does not support @a speed.
+    bool setSpeed(long speed);
+
+    //! @brief Return the port speed.
+    long getSpeed() const { return m_speed; }
+
 protected:
     //! @brief Initialize.
     //!
@@ -78,9 +106,19 @@ protected:
     //!
     //! @param port OS file path for COM port. For example "COM1" on Windows.
     //! @param speed Port speed, e.g. 9600.
-    bool init(const char *port, long speed);
+    //! @param options Bit mask of _uart_peripheral_options.
+    bool init(const char *port, long speed, uint32_t options);
+
+    //! @brief Enables the low latency mode of the serial driver and the USB-UART adapter.
+    //!
+    //! Failures are not fatal, the port then works with the default latency.
+    void setLowLatency();
+
     char *port_name;                         //!< Port name
     int m_fileDescriptor;                    //!< Port file descriptor.
+    long m_speed;                            //!< Port speed.
+    uint32_t m_options;                      //!< Bit mask of _uart_peripheral_options.
+    SerialIoThread *m_ioThread;              //!< I/O thread, or NULL to access the port directly.
     uint8_t m_buffer[kDefaultMaxPacketSize]; //!< Buffer for bytes used to build read packet.
 };
 
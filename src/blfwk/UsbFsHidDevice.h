@@ -0,0 +1,137 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_UsbFsHidDevice_h_)
+#define _UsbFsHidDevice_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace blfwk
+{
+/*!
+ * \brief HID device accessed through usbfs, with several output reports in flight.
+ *
+ * hidapi writes an output report with one blocking write(), which returns once the
+ * report has been transferred, so the next report is only queued after the previous
+ * one is done. The data phase of a command has no per-packet handshake, so the host
+ * can instead submit the interrupt OUT transfers of several reports at once and keep
+ * the endpoint busy.
+ *
+ * The device is opened through its /dev/bus/usb node, the same way libusb does, and
+ * its HID interface is claimed from the kernel driver, which is attached again when
+ * the device is closed. Transfers are submitted asynchronously and an event thread
+ * reaps their completions. A few input transfers are kept queued, so input reports
+ * are received as with hidapi. A failed output transfer is logged when it completes
+ * and makes the next write() fail.
+ *
+ * Only available on Linux. On other platforms open() fails.
+ */
+class UsbFsHidDevice
+{
+public:
+    //! \brief Number of input transfers kept queued.
+    static const size_t kInTransferCount = 4;
+
+    //! \brief Constructor.
+    //!
+    //! \param queueDepth Number of output reports that may be in flight at once.
+    explicit UsbFsHidDevice(uint32_t queueDepth);
+
+    //! \brief Destructor. Closes the device.
+    ~UsbFsHidDevice();
+
+    //! \brief Opens the HID device with \a vid, \a pid and, if not empty, \a serialNumber.
+    //!
+    //! If \a path is not empty, it selects the device instead. It is either the usbfs node
+    //! of the device, such as /dev/bus/usb/001/004, or the hidraw node of its HID interface.
+    bool open(uint16_t vid, uint16_t pid, const std::wstring &serialNumber, const std::string &path);
+
+    //! \brief Closes the device, cancelling the transfers in flight, and gives it back to the kernel driver.
+    void close();
+
+    //! \brief Queues output report \a report of \a length bytes, including the report ID.
+    //!
+    //! Returns once the transfer is submitted. If \a queueDepth reports are in flight already,
+    //! waits up to \a timeoutMs milliseconds for one of them to complete, and cancels them all
+    //! if none does.
+    //!
+    //! \return \a length, or -1 on failure, including the failure of an earlier transfer.
+    int write(const uint8_t *report, size_t length, uint32_t timeoutMs);
+
+    //! \brief Reads the next input report into \a buffer, truncated to \a length bytes.
+    //!
+    //! Waits up to \a timeoutMs milliseconds for a report, or forever if \a timeoutMs is negative.
+    //!
+    //! \return The number of bytes read, 0 on timeout, or -1 if the device failed.
+    int read(uint8_t *buffer, size_t length, int timeoutMs);
+
+    //! \brief Cancels the output reports in flight, for instance after the target aborted a data phase.
+    void discardWrites();
+
+    //! \brief Returns the report descriptor of the HID interface.
+    const std::vector<uint8_t> &getReportDescriptor() const { return m_reportDescriptor; }
+
+protected:
+    struct transfer_t; //!< An asynchronous transfer and its buffer.
+
+    //! \brief Finds the usbfs node and the HID interface of the device, as described for open().
+    bool findDevice(uint16_t vid, uint16_t pid, const std::wstring &serialNumber, const std::string &path);
+
+    //! \brief Parses the descriptors of the device for the endpoints of the HID interface.
+    bool readEndpoints();
+
+    //! \brief Reads the report descriptor of the HID interface.
+    bool readReportDescriptor();
+
+    //! \brief Submits \a transfer. Must be called with #m_mutex held.
+    bool submit(transfer_t *transfer);
+
+    //! \brief Cancels every pending transfer that is an output transfer if \a isOutOnly, or any transfer.
+    //!
+    //! Must be called with #m_mutex held.
+    void discard(bool isOutOnly);
+
+    //! \brief Event thread function. Reaps the completed transfers.
+    void run();
+
+    //! \brief Reaps the completed transfers without waiting.
+    //!
+    //! \return False if the device is gone.
+    bool reap();
+
+protected:
+    uint32_t m_queueDepth;                   //!< Number of output transfers.
+    int m_fd;                                //!< usbfs node of the device, or -1 when closed.
+    std::string m_sysfsPath;                 //!< sysfs directory of the device.
+    int m_interface;                         //!< Number of the HID interface, or -1 for the first one.
+    bool m_isClaimed;                        //!< Whether the interface was claimed from the kernel driver.
+    uint8_t m_inEndpoint;                    //!< Address of the interrupt IN endpoint.
+    uint8_t m_outEndpoint;                   //!< Address of the interrupt OUT endpoint.
+    uint32_t m_inPacketSize;                 //!< Maximum packet size of the IN endpoint.
+    uint32_t m_reportDescriptorLength;       //!< Length of the report descriptor, from the HID descriptor.
+    std::vector<uint8_t> m_reportDescriptor; //!< Report descriptor of the interface.
+    std::vector<transfer_t *> m_transfers;   //!< All transfers, input ones first.
+    std::vector<transfer_t *> m_freeOut;     //!< Output transfers not in flight.
+    std::deque<transfer_t *> m_completedIn;  //!< Completed input transfers not read yet, oldest first.
+    int m_writeError;                        //!< Error of the last failed output transfer, or 0.
+    std::atomic<bool> m_isFailed;            //!< Whether the device has gone.
+    std::atomic<bool> m_isStopped;           //!< Whether the event thread should exit.
+    std::thread m_thread;                    //!< The event thread.
+    std::mutex m_mutex;                      //!< Protects the transfers.
+    std::condition_variable m_condition;     //!< Signalled when a transfer completes.
+};
+
+}; // namespace blfwk
+
+#endif // _UsbFsHidDevice_h_
@@ -10,6 +10,7 @@
 #define _usb_hid_packetizer_h_
 
 #include "Packetizer.h"
+#include <chrono>
 #include "UsbHidPeripheral.h"
 #include "hidapi.h"
 
@@ -32,9 +33,7 @@ public:
     enum _usbhid_contants
     {
         kReadFlushTimeoutMs = 100000,
-        kPollAbortTimeoutMs = 10,
         kPollPacketMaxRetryCnt = 50,
-        kContinuousReadMargin = 2,
     };
 public:
     //! @brief Default Constructor.
@@ -74,6 +73,8 @@ public:
     virtual void setAborted(bool aborted) {}
     //! @brief Returns the max packet size supported
     virtual uint32_t getMaxPacketSize();
+    //! @brief Make the report buffers resident.
+    virtual void prefaultBuffers();
 
     //! @brief Peripheral accessor.
     virtual UsbHidPeripheral *getPeripheral() { return (UsbHidPeripheral *)m_peripheral; }
@@ -81,16 +82,15 @@ protected:
     //! @brief Flush input from device.
     virtual void flushInput();
 
-    //! @brief Poll overlapped read for receiver data phase abort.
+    //! @brief Check, without waiting, whether the target has aborted the data phase it receives.
     bool pollForAbortPacket();
 
 protected:
     bl_hid_report_t m_report;      //!< Used for building and receiving the report.
     bl_hid_report_t m_abortReport; //!< Used for received abort report.
-
-private:
-    uint32_t
-        m_continuousReadCount; //!< Used for distinguish abort report for write-memory/receive-sb-file or read-memory
+    bool m_isCommandWritten;       //!< Whether a command was written and its response not read yet.
+    uint32_t m_maxPacketSize;      //!< Largest packet the data reports of the device hold.
+    std::chrono::steady_clock::time_point m_commandWriteTime; //!< When the last command was written.
 };
 
 } // namespace blfwk
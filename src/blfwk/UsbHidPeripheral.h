@@ -8,6 +8,7 @@
 #ifndef _UsbHidPeripheral_h_
 #define _UsbHidPeripheral_h_
 
+#include "HidReportDescriptor.h"
 #include "Peripheral.h"
 #include "hidapi.h"
 
@@ -16,10 +17,19 @@
 
 namespace blfwk
 {
+class UsbFsHidDevice;
+class UsbHidReaderThread;
+
 /*!
  * @brief Represents a USB HID peripheral.
  *
  * Interface class for objects that provide the source for commands or sink for responses.
+ *
+ * Input reports are read by a helper thread as soon as the device sends them, and
+ * read() and readReport() take them from its ring.
+ *
+ * The device is accessed through hidapi, or on Linux through usbfs when a queue depth
+ * is given, in which case several output reports are in flight at once.
  */
 class UsbHidPeripheral : public Peripheral
 {
@@ -44,7 +54,13 @@ public:
     //! @param vendor_id The Vendor ID of the USB HID device.
     //! @param product_id The Product ID of the USB HID device.
     //! @param serial_number The Serial Number of the USB HID device.
-    UsbHidPeripheral(unsigned short vendor_id, unsigned short product_id, const char *serial_number, const char *path);
+    //! @param path The path of the USB HID device, used instead of the IDs if not empty.
+    //! @param queueDepth Number of output reports in flight with the usbfs backend, or 0 to use hidapi.
+    UsbHidPeripheral(unsigned short vendor_id,
+                     unsigned short product_id,
+                     const char *serial_number,
+                     const char *path,
+                     uint32_t queueDepth = 0);
 
     //! @brief Destructor.
     virtual ~UsbHidPeripheral();
@@ -57,11 +73,32 @@ public:
     //! @param actualBytes Number of bytes actually read.
     virtual status_t read(uint8_t *buffer, uint32_t requestedBytes, uint32_t *actualBytes, uint32_t timeoutMS);
 
+    //! @brief Read the oldest report with a given report ID.
+    //!
+    //! @param reportId ID of the report to read.
+    //! @param isDiscardingOthers If true, reports with other IDs that arrived before it are discarded.
+    //! @param buffer Pointer to buffer
+    //! @param requestedBytes Size of the buffer
+    //! @param actualBytes Number of bytes actually read.
+    //! @param timeoutMs Time in milliseconds to wait for the report.
+    status_t readReport(uint8_t reportId,
+                        bool isDiscardingOthers,
+                        uint8_t *buffer,
+                        uint32_t requestedBytes,
+                        uint32_t *actualBytes,
+                        uint32_t timeoutMs);
+
     //! @brief Write bytes. This is a do nothing function implemented here to satisfy abstract base class
     //! requirements. This function is not used. The write(buffer, count, timeout) function is used
     //! in this child class instead of the write(buffer, cout) function declared in the base class.
     virtual status_t write(const uint8_t *buffer, uint32_t byteCount) { return kStatus_Success; }
 
+    //! @brief Return true if an input report has arrived and has not been read yet. Does not block.
+    bool isReportPending() const;
+
+    //! @brief Cancel the output reports still in flight. Only the usbfs backend queues them.
+    void discardWrites();
+
     //! @brief Return peripheral Type
     virtual _host_peripheral_types get_type(void) { return kHostPeripheralType_USB_HID; }
 
@@ -78,17 +115,29 @@ public:
     unsigned short getProductId() { return m_product_id; }
     //! @brief Return USB Serial Number
     const wchar_t *getSerialNumber() { return m_serial_number.c_str(); }
+    //! @brief Return the report sizes declared by the device. Describes no report if they could not be read.
+    const HidReportDescriptor &getReportDescriptor() const { return m_descriptor; }
 private:
     //! @brief Initialize.
     //!
     //! Opens the HID device.
     bool init();
 
+    //! @brief Read the report descriptor of the open device, on platforms where it is available.
+    void readReportDescriptor();
+
+    //! @brief Log a report read by read() or readReport() and convert its length to a status.
+    status_t completeRead(const uint8_t *buffer, int count, uint32_t *actualBytes);
+
     unsigned short m_vendor_id;
     unsigned short m_product_id;
     std::wstring m_serial_number;
     std::string m_path;
-    hid_device *m_device; //!< Device handle.
+    uint32_t m_queueDepth;            //!< Output reports in flight with usbfs, or 0 for hidapi.
+    hid_device *m_device;             //!< Device handle.
+    UsbFsHidDevice *m_usbfs;          //!< Device handle of the usbfs backend.
+    UsbHidReaderThread *m_reader;     //!< Thread that reads the input reports.
+    HidReportDescriptor m_descriptor; //!< Report sizes declared by the device.
 };
 
 } // namespace blfwk
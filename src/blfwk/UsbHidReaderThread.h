@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#if !defined(_UsbHidReaderThread_h_)
+#define _UsbHidReaderThread_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace blfwk
+{
+/*!
+ * \brief Helper thread that reads every input report of a HID device into a ring.
+ *
+ * The thread reads reports as soon as the device sends them, so a report that arrives
+ * while the caller is busy is already in user space when it asks for it, and reading
+ * it does not cost a system call.
+ *
+ * Reports are kept in the order they arrive and can be read by report ID, so reports
+ * of one kind, such as data reports, do not get in the way of reading another kind,
+ * such as command responses.
+ */
+class UsbHidReaderThread
+{
+public:
+    //! \brief Report ID value that matches any report.
+    static const int kAnyReportId = -1;
+
+    //! \brief Default number of reports the ring holds.
+    static const size_t kDefaultReportCount = 32;
+
+    //! \brief Function that reads one report into a buffer of a given size, waiting up to a given
+    //! number of milliseconds, with the return values of hid_read_timeout().
+    typedef std::function<int(uint8_t *report, size_t size, int timeoutMs)> read_function_t;
+
+    //! \brief Constructor. Starts the thread, which reads the reports of the open device with \a readReport.
+    //!
+    //! \param reportSize Size of the largest input report, including the report ID.
+    //! \param reportCount Number of reports the ring holds. The thread stops reading while it is full.
+    UsbHidReaderThread(const read_function_t &readReport, size_t reportSize, size_t reportCount = kDefaultReportCount);
+
+    //! \brief Destructor. Stops the thread. Does not close the device.
+    ~UsbHidReaderThread();
+
+    //! \brief Reads the oldest report with ID \a reportId into \a buffer, truncated to \a size bytes.
+    //!
+    //! Waits up to \a timeoutMs milliseconds, measured on the monotonic clock, for such a report.
+    //! If \a isDiscardingOthers is true, reports with other IDs that arrived before it are discarded.
+    //!
+    //! \return The number of bytes read, 0 on timeout, or -1 if reading from the device failed.
+    int read(int reportId, bool isDiscardingOthers, uint8_t *buffer, uint32_t size, uint32_t timeoutMs);
+
+    //! \brief Discards all reports that have not been read yet.
+    void flush();
+
+    //! \brief Returns true if a report has arrived and has not been read yet.
+    //!
+    //! Does not take the lock, so it costs no more than an atomic load.
+    bool isReportPending() const { return m_unreadCount != 0; }
+
+    //! \brief Returns true if reading from the device failed.
+    bool isFailed() const { return m_isFailed; }
+
+protected:
+    //! \brief State of a slot of the ring.
+    struct slot_t
+    {
+        uint32_t length; //!< Length of the report in the slot.
+        bool isRead;     //!< Whether the report has been read, so that the slot can be reused.
+    };
+
+    //! \brief Thread function.
+    void run();
+
+    //! \brief Takes the oldest report with ID \a reportId, as described for read().
+    //!
+    //! Must be called with #m_mutex held.
+    //!
+    //! \return The number of bytes read, or -1 if there is no such report.
+    int take(int reportId, bool isDiscardingOthers, uint8_t *buffer, uint32_t size);
+
+    //! \brief Frees the read slots at the head of the ring. Must be called with #m_mutex held.
+    void advanceHead();
+
+protected:
+    read_function_t m_readReport;        //!< Reads a report from the device.
+    size_t m_reportSize;                 //!< Size of a slot, in bytes.
+    std::vector<uint8_t> m_reports;      //!< Report data, one slot after the other.
+    std::vector<slot_t> m_slots;         //!< State of each slot.
+    size_t m_head;                       //!< Index of the oldest report.
+    size_t m_count;                      //!< Number of slots in use.
+    std::thread m_thread;                //!< The helper thread.
+    std::atomic<bool> m_isStopped;       //!< Whether the thread should exit.
+    std::atomic<bool> m_isFailed;        //!< Whether reading from the device failed.
+    std::atomic<size_t> m_unreadCount;   //!< Number of reports not read yet.
+    std::mutex m_mutex;                  //!< Protects the ring.
+    std::condition_variable m_condition; //!< Signalled when a report arrives or a slot is freed.
+};
+
+}; // namespace blfwk
+
+#endif // _UsbHidReaderThread_h_
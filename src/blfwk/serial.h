@@ -58,8 +58,22 @@ extern "C" {
 
 int serial_setup(int fd, speed_t speed);
 int serial_set_read_timeout(int fd, uint32_t timeoutMs);
+//! Enables or disables RTS/CTS hardware flow control. Returns 0 on success and -1 if the
+//! port does not support it. A pty accepts the setting without having the lines, so this
+//! cannot tell a port that really throttles from one that ignores it.
+int serial_set_flow_control(int fd, int enable);
+//! Enables the low latency mode of the serial driver. Returns 0 on success and -1 if the
+//! driver or platform does not support it.
+int serial_set_low_latency(int fd);
+//! Sets the latency timer of a USB-UART adapter through sysfs. Returns 0 on success, 1 if
+//! the adapter has no latency timer and -1 if it cannot be set.
+int serial_set_latency_timer(const char *port, unsigned int latencyMs);
 int serial_write(int fd, char *buf, int size);
 int serial_read(int fd, char *buf, int size);
+//! Reads up to \a size bytes, waiting at most \a timeoutMs milliseconds on the monotonic clock
+//! for all of them. Returns the number of bytes read, or -1 if the port failed. On Windows the
+//! timeouts set with serial_set_read_timeout() apply instead.
+int serial_read_timeout(int fd, char *buf, int size, uint32_t timeoutMs);
 int serial_open(char *port);
 int serial_close(int fd);
 
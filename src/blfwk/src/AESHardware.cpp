@@ -0,0 +1,372 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/stdafx.h"
+#include "blfwk/AESHardware.h"
+#include "blfwk/EndianUtilities.h"
+#include "blfwk/Logging.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define AES_HARDWARE_X86 1
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AES_HARDWARE_TARGET
+#else // _MSC_VER
+#include <cpuid.h>
+#define AES_HARDWARE_TARGET __attribute__((target("aes,sse2")))
+#endif // _MSC_VER
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AES_HARDWARE_ARM64 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+#if defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO) || defined(_MSC_VER)
+#define AES_HARDWARE_TARGET
+#elif defined(__clang__)
+#define AES_HARDWARE_TARGET __attribute__((target("aes")))
+#else
+#define AES_HARDWARE_TARGET __attribute__((target("+crypto")))
+#endif
+#endif
+
+//! Number of blocks encrypted at a time.
+static const size_t kBlocksInFlight = 8;
+
+//! Number of rounds of AES-128.
+static const unsigned kRounds = 10;
+
+//! \brief Loads a 128-bit big-endian counter into two 64-bit halves.
+static void loadCounter(const uint8_t *counter, uint64_t &high, uint64_t &low)
+{
+    high = 0;
+    low = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        high = (high << 8) | counter[i];
+        low = (low << 8) | counter[i + 8];
+    }
+}
+
+//! \brief Stores two 64-bit halves as a 128-bit big-endian counter.
+static void storeCounter(uint8_t *counter, uint64_t high, uint64_t low)
+{
+    for (int i = 7; i >= 0; --i)
+    {
+        counter[i] = static_cast<uint8_t>(high);
+        counter[i + 8] = static_cast<uint8_t>(low);
+        high >>= 8;
+        low >>= 8;
+    }
+}
+
+//! \brief Fills \a counterBlocks with \a count consecutive counter values.
+static void makeCounterBlocks(uint8_t (*counterBlocks)[16], size_t count, uint64_t &high, uint64_t &low,
+                              unsigned step)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t bigHigh = ENDIAN_HOST_TO_BIG_U64(high);
+        uint64_t bigLow = ENDIAN_HOST_TO_BIG_U64(low);
+        memcpy(&counterBlocks[i][0], &bigHigh, sizeof(bigHigh));
+        memcpy(&counterBlocks[i][8], &bigLow, sizeof(bigLow));
+
+        uint64_t previous = low;
+        low += step;
+        if (low < previous)
+        {
+            ++high;
+        }
+    }
+}
+
+#if defined(AES_HARDWARE_X86)
+
+//! \brief Returns true if the processor supports AES-NI.
+static bool detectHardware()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) && (info[3] & (1 << 26));
+#else
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    return (ecx & bit_AES) && (edx & bit_SSE2);
+#endif
+}
+
+static const char *const kHardwareName = "AES-NI";
+
+//! \brief Performs one step of the AES-128 key expansion.
+AES_HARDWARE_TARGET static inline __m128i expandKeyStep(__m128i key, __m128i assist)
+{
+    assist = _mm_shuffle_epi32(assist, 0xff);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+//! \brief Expands \a key into the 11 round keys of AES-128.
+AES_HARDWARE_TARGET static void expandKey(const uint8_t *key, __m128i *roundKeys)
+{
+    // The round constant of aeskeygenassist must be an immediate value.
+    roundKeys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key));
+    roundKeys[1] = expandKeyStep(roundKeys[0], _mm_aeskeygenassist_si128(roundKeys[0], 0x01));
+    roundKeys[2] = expandKeyStep(roundKeys[1], _mm_aeskeygenassist_si128(roundKeys[1], 0x02));
+    roundKeys[3] = expandKeyStep(roundKeys[2], _mm_aeskeygenassist_si128(roundKeys[2], 0x04));
+    roundKeys[4] = expandKeyStep(roundKeys[3], _mm_aeskeygenassist_si128(roundKeys[3], 0x08));
+    roundKeys[5] = expandKeyStep(roundKeys[4], _mm_aeskeygenassist_si128(roundKeys[4], 0x10));
+    roundKeys[6] = expandKeyStep(roundKeys[5], _mm_aeskeygenassist_si128(roundKeys[5], 0x20));
+    roundKeys[7] = expandKeyStep(roundKeys[6], _mm_aeskeygenassist_si128(roundKeys[6], 0x40));
+    roundKeys[8] = expandKeyStep(roundKeys[7], _mm_aeskeygenassist_si128(roundKeys[7], 0x80));
+    roundKeys[9] = expandKeyStep(roundKeys[8], _mm_aeskeygenassist_si128(roundKeys[8], 0x1b));
+    roundKeys[10] = expandKeyStep(roundKeys[9], _mm_aeskeygenassist_si128(roundKeys[9], 0x36));
+}
+
+//! \brief Encrypts \a count counter blocks and XORs them with \a data.
+//!
+//! Each round is applied to all blocks before the next round, so that the blocks
+//! are processed in parallel by the AES unit.
+AES_HARDWARE_TARGET static inline void processBlocks(const __m128i *roundKeys, const uint8_t (*counterBlocks)[16],
+                                                     size_t count, const uint8_t *data, uint8_t *dest)
+{
+    __m128i state[kBlocksInFlight];
+    for (size_t i = 0; i < count; ++i)
+    {
+        state[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(counterBlocks[i]));
+        state[i] = _mm_xor_si128(state[i], roundKeys[0]);
+    }
+    for (unsigned round = 1; round < kRounds; ++round)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            state[i] = _mm_aesenc_si128(state[i], roundKeys[round]);
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        state[i] = _mm_aesenclast_si128(state[i], roundKeys[kRounds]);
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 16), _mm_xor_si128(state[i], input));
+    }
+}
+
+AES_HARDWARE_TARGET static void processCtrHardware(
+    const uint8_t *key, uint64_t &high, uint64_t &low, unsigned step, const uint8_t *data, size_t blocks, uint8_t *dest)
+{
+    __m128i roundKeys[kRounds + 1];
+    uint8_t counterBlocks[kBlocksInFlight][16];
+
+    expandKey(key, roundKeys);
+
+    while (blocks >= kBlocksInFlight)
+    {
+        makeCounterBlocks(counterBlocks, kBlocksInFlight, high, low, step);
+        processBlocks(roundKeys, counterBlocks, kBlocksInFlight, data, dest);
+        data += kBlocksInFlight * 16;
+        dest += kBlocksInFlight * 16;
+        blocks -= kBlocksInFlight;
+    }
+    if (blocks)
+    {
+        makeCounterBlocks(counterBlocks, blocks, high, low, step);
+        processBlocks(roundKeys, counterBlocks, blocks, data, dest);
+    }
+}
+
+#elif defined(AES_HARDWARE_ARM64)
+
+//! \brief Returns true if the processor supports the ARMv8 AES instructions.
+static bool detectHardware()
+{
+#if defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO)
+    return true;
+#elif defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#elif defined(__APPLE__)
+    return true;
+#elif defined(_WIN32)
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0;
+#else
+    return false;
+#endif
+}
+
+static const char *const kHardwareName = "ARMv8 Crypto Extension";
+
+//! Round constants of the AES-128 key schedule.
+static const uint8_t kRoundConstants[kRounds] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+//! \brief Applies the AES S-box to each byte of \a word.
+//!
+//! AESE with a zero round key performs ShiftRows and SubBytes. ShiftRows has no
+//! effect when all four columns of the state are the same.
+AES_HARDWARE_TARGET static uint32_t subWord(uint32_t word)
+{
+    uint8x16_t state = vreinterpretq_u8_u32(vdupq_n_u32(word));
+    state = vaeseq_u8(state, vdupq_n_u8(0));
+    return vgetq_lane_u32(vreinterpretq_u32_u8(state), 0);
+}
+
+//! \brief Expands \a key into the 11 round keys of AES-128.
+AES_HARDWARE_TARGET static void expandKey(const uint8_t *key, uint8x16_t *roundKeys)
+{
+    // Words hold the key bytes in little-endian order, so the first byte of a word
+    // is its least significant byte.
+    uint32_t words[(kRounds + 1) * 4];
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        words[i] = key[i * 4] | (key[i * 4 + 1] << 8) | (key[i * 4 + 2] << 16) | ((uint32_t)key[i * 4 + 3] << 24);
+    }
+    for (unsigned i = 4; i < (kRounds + 1) * 4; ++i)
+    {
+        uint32_t temp = words[i - 1];
+        if (i % 4 == 0)
+        {
+            temp = subWord(temp);
+            temp = (temp >> 8) | (temp << 24);
+            temp ^= kRoundConstants[i / 4 - 1];
+        }
+        words[i] = words[i - 4] ^ temp;
+    }
+
+    for (unsigned round = 0; round <= kRounds; ++round)
+    {
+        uint8_t bytes[16];
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            bytes[i] = static_cast<uint8_t>(words[round * 4 + i / 4] >> ((i % 4) * 8));
+        }
+        roundKeys[round] = vld1q_u8(bytes);
+    }
+}
+
+//! \brief Encrypts \a count counter blocks and XORs them with \a data.
+//!
+//! Each round is applied to all blocks before the next round, so that the blocks
+//! are processed in parallel by the AES unit.
+AES_HARDWARE_TARGET static inline void processBlocks(const uint8x16_t *roundKeys, const uint8_t (*counterBlocks)[16],
+                                                     size_t count, const uint8_t *data, uint8_t *dest)
+{
+    uint8x16_t state[kBlocksInFlight];
+    for (size_t i = 0; i < count; ++i)
+    {
+        state[i] = vld1q_u8(counterBlocks[i]);
+    }
+    for (unsigned round = 0; round < kRounds - 1; ++round)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            state[i] = vaesmcq_u8(vaeseq_u8(state[i], roundKeys[round]));
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        state[i] = veorq_u8(vaeseq_u8(state[i], roundKeys[kRounds - 1]), roundKeys[kRounds]);
+        vst1q_u8(dest + i * 16, veorq_u8(state[i], vld1q_u8(data + i * 16)));
+    }
+}
+
+AES_HARDWARE_TARGET static void processCtrHardware(
+    const uint8_t *key, uint64_t &high, uint64_t &low, unsigned step, const uint8_t *data, size_t blocks, uint8_t *dest)
+{
+    uint8x16_t roundKeys[kRounds + 1];
+    uint8_t counterBlocks[kBlocksInFlight][16];
+
+    expandKey(key, roundKeys);
+
+    while (blocks >= kBlocksInFlight)
+    {
+        makeCounterBlocks(counterBlocks, kBlocksInFlight, high, low, step);
+        processBlocks(roundKeys, counterBlocks, kBlocksInFlight, data, dest);
+        data += kBlocksInFlight * 16;
+        dest += kBlocksInFlight * 16;
+        blocks -= kBlocksInFlight;
+    }
+    if (blocks)
+    {
+        makeCounterBlocks(counterBlocks, blocks, high, low, step);
+        processBlocks(roundKeys, counterBlocks, blocks, data, dest);
+    }
+}
+
+#else
+
+static bool detectHardware()
+{
+    return false;
+}
+
+static const char *const kHardwareName = NULL;
+
+static void processCtrHardware(
+    const uint8_t *key, uint64_t &high, uint64_t &low, unsigned step, const uint8_t *data, size_t blocks, uint8_t *dest)
+{
+}
+
+#endif
+
+//! \brief Checks the hardware path against the FIPS-197 appendix C.1 test vector.
+//!
+//! Only the result is checked here. The throughput of the hardware path against the
+//! software one is measured by the aesbench tool.
+static bool checkHardware()
+{
+    static const uint8_t kKey[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                      0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+    static const uint8_t kPlainText[16] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                            0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    static const uint8_t kCipherText[16] = { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                                             0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+
+    // In counter mode the plain text is the counter, and XOR with zero data gives
+    // the encrypted counter.
+    uint64_t high, low;
+    uint8_t zero[16] = { 0 };
+    uint8_t cipherText[16];
+    loadCounter(kPlainText, high, low);
+    processCtrHardware(kKey, high, low, 1, zero, 1, cipherText);
+    if (memcmp(cipherText, kCipherText, sizeof(cipherText)) != 0)
+    {
+        Log::warning("Warning: %s failed the AES test vector, using software AES\n", kHardwareName);
+        return false;
+    }
+    return true;
+}
+
+//! The processor features and the result of the hardware path are only checked once.
+bool AESHardware::isAvailable()
+{
+    static const bool s_isAvailable = detectHardware() && checkHardware();
+    return s_isAvailable;
+}
+
+const char *AESHardware::getName()
+{
+    return isAvailable() ? kHardwareName : NULL;
+}
+
+void AESHardware::processCtr(
+    const uint8_t *key, uint8_t *counter, unsigned counterStep, const uint8_t *data, size_t blocks, uint8_t *dest)
+{
+    uint64_t high, low;
+    loadCounter(counter, high, low);
+    processCtrHardware(key, high, low, counterStep, data, blocks, dest);
+    storeCounter(counter, high, low);
+}
@@ -40,6 +40,9 @@ enum
 Bootloader::Bootloader()
     : m_hostPacketizer(NULL)
     , m_logger(NULL)
+    , m_commandTimeoutMs(0)
+    , m_isAdaptiveTimeoutEnabled(true)
+    , m_commandTimeouts()
 {
     // create logger instance
     if (Log::getLogger() == NULL)
@@ -54,6 +57,9 @@ Bootloader::Bootloader()
 Bootloader::Bootloader(const Peripheral::PeripheralConfigData &config)
     : m_hostPacketizer(NULL)
     , m_logger(NULL)
+    , m_commandTimeoutMs(0)
+    , m_isAdaptiveTimeoutEnabled(true)
+    , m_commandTimeouts()
 {
     // create logger instance
     if (Log::getLogger() == NULL)
@@ -67,7 +73,8 @@ Bootloader::Bootloader(const Peripheral::PeripheralConfigData &config)
     {
         case Peripheral::kHostPeripheralType_UART:
         {
-            UartPeripheral *peripheral = new UartPeripheral(config.comPortName.c_str(), config.comPortSpeed);
+            UartPeripheral *peripheral =
+                new UartPeripheral(config.comPortName.c_str(), config.comPortSpeed, config.comPortOptions);
             m_hostPacketizer = new SerialPacketizer(peripheral, config.packetTimeoutMs);
 
             if (config.ping)
@@ -93,7 +100,7 @@ Bootloader::Bootloader(const Peripheral::PeripheralConfigData &config)
             try
             {
                 peripheral = new UsbHidPeripheral(config.usbHidVid, config.usbHidPid, config.usbHidSerialNumber.c_str(),
-                                                  config.usbPath.c_str());
+                                                  config.usbPath.c_str(), config.usbHidQueueDepth);
                 m_hostPacketizer = new UsbHidPacketizer(peripheral, config.packetTimeoutMs);
             }
             catch (...)
@@ -217,6 +224,36 @@ Bootloader::~Bootloader()
     }
 }
 
+// See host_bootloader.h for documentation of this method.
+void Bootloader::inject(Command &cmd)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_hostPacketizer->setCommandDeadline(m_commandTimeoutMs ? Deadline(m_commandTimeoutMs) : Deadline::never());
+    try
+    {
+        // The commands that cmd sends itself, such as the erases and writes of flash-image,
+        // get adaptive timeouts too.
+        if (m_isAdaptiveTimeoutEnabled)
+        {
+            cmd.setCommandTimeouts(&m_commandTimeouts);
+            m_commandTimeouts.send(*m_hostPacketizer, cmd);
+        }
+        else
+        {
+            cmd.sendTo(*m_hostPacketizer);
+        }
+    }
+    catch (...)
+    {
+        m_hostPacketizer->setCommandDeadline(Deadline::never());
+        throw;
+    }
+    m_hostPacketizer->setCommandDeadline(Deadline::never());
+
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+    Log::debug("  - took %2.3f seconds\n", std::chrono::duration<double>(elapsed).count());
+}
+
 // See host_bootloader.h for documentation of this method.
 void Bootloader::flush()
 {
@@ -325,13 +362,19 @@ uint32_t Bootloader::getDataPacketSize()
 
 // See host_bootloader.h for documentation of this method.
 void Bootloader::ping(int retries, unsigned int delay, int comSpeed, int *actualComSpeed)
+{
+    ping(retries, delay, std::vector<int>(1, comSpeed), actualComSpeed);
+}
+
+// See host_bootloader.h for documentation of this method.
+void Bootloader::ping(int retries, unsigned int delay, const std::vector<int> &comSpeeds, int *actualComSpeed)
 {
     this->flush();
 
     SerialPacketizer *pPacketizer = dynamic_cast<SerialPacketizer *>(m_hostPacketizer);
     if (pPacketizer)
     {
-        status_t status = pPacketizer->ping(retries, delay, NULL, comSpeed, actualComSpeed);
+        status_t status = pPacketizer->pingSpeeds(retries, delay, NULL, comSpeeds, actualComSpeed);
         if (status != kStatus_Success)
         {
             this->flush();
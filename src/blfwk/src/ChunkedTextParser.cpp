@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/ChunkedTextParser.h"
+#include "blfwk/Realtime.h"
+#include <exception>
+#include <string.h>
+#include <thread>
+
+using namespace blfwk;
+
+//! The number of chunks is limited by the number of hardware threads and by
+//! #kMinChunkSize. Each chunk boundary is moved forward to just past the next
+//! line ending, so that no line is split between two chunks.
+ChunkedTextParser::chunk_vector_t ChunkedTextParser::split(const uint8_t *data, size_t size)
+{
+    chunk_vector_t chunks;
+    const char *begin = reinterpret_cast<const char *>(data);
+    const char *end = begin + size;
+
+    size_t threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+    size_t chunkCount = size / kMinChunkSize;
+    if (chunkCount > threadCount)
+    {
+        chunkCount = threadCount;
+    }
+    if (chunkCount == 0)
+    {
+        chunkCount = 1;
+    }
+    size_t chunkSize = size / chunkCount;
+
+    while (begin != end)
+    {
+        const char *chunkEnd = end;
+        if (chunks.size() + 1 < chunkCount && (size_t)(end - begin) > chunkSize)
+        {
+            chunkEnd = begin + chunkSize;
+            while (chunkEnd != end && *chunkEnd != '\r' && *chunkEnd != '\n')
+            {
+                ++chunkEnd;
+            }
+            while (chunkEnd != end && (*chunkEnd == '\r' || *chunkEnd == '\n'))
+            {
+                ++chunkEnd;
+            }
+        }
+
+        Chunk chunk = { begin, chunkEnd };
+        chunks.push_back(chunk);
+        begin = chunkEnd;
+    }
+
+    return chunks;
+}
+
+//! Index 0 is processed on the calling thread. If any of the calls throws, the
+//! exception from the lowest index is rethrown after all threads have finished,
+//! so errors are reported in the same order as a serial parse would.
+void ChunkedTextParser::run(size_t count, const std::function<void(size_t)> &work)
+{
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        threads.push_back(std::thread([&work, &errors, i]() {
+            Realtime::leave();
+            try
+            {
+                work(i);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }));
+    }
+
+    if (count)
+    {
+        try
+        {
+            work(0);
+        }
+        catch (...)
+        {
+            errors[0] = std::current_exception();
+        }
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (errors[i])
+        {
+            std::rethrow_exception(errors[i]);
+        }
+    }
+}
+
+void ChunkedTextParser::appendData(run_vector_t &runs, uint32_t address, const uint8_t *data, unsigned length)
+{
+    if (runs.empty() || runs.back().m_address + runs.back().m_data.size() != address)
+    {
+        runs.push_back(DataRun());
+        runs.back().m_address = address;
+    }
+
+    std::vector<uint8_t> &runData = runs.back().m_data;
+    runData.insert(runData.end(), data, data + length);
+}
@@ -8,11 +8,16 @@
  */
 
 #include "blfwk/Command.h"
+#include "blfwk/CommandTimeouts.h"
+#include "blfwk/ELFSourceFile.h"
 #include "blfwk/EndianUtilities.h"
 #include "blfwk/Logging.h"
+#include "blfwk/Realtime.h"
+#include "blfwk/SBSourceFile.h"
 #include "blfwk/json.h"
 #include "blfwk/utils.h"
 #include "bootloader_common.h"
+#include <algorithm>
 #ifdef LINUX
 #include <string.h>
 #endif
@@ -576,6 +581,20 @@ bool Command::processResponse(const generic_response_packet_t *packet, uint8_t c
     return true;
 }
 
+// See host_command.h for documentation of this method.
+void Command::sendSubCommand(Packetizer &packetizer, Command &cmd)
+{
+    if (m_commandTimeouts)
+    {
+        cmd.setCommandTimeouts(m_commandTimeouts);
+        m_commandTimeouts->send(packetizer, cmd);
+    }
+    else
+    {
+        cmd.sendTo(packetizer);
+    }
+}
+
 //! See host_command.h for documentation on this function.
 bool blfwk::DataPacket::FileDataProducer::init(string filePath, uint32_t count)
 {
@@ -615,6 +634,85 @@ uint32_t blfwk::DataPacket::FileDataProducer::getData(uint8_t *data, uint32_t si
     return (uint32_t)fread(data, 1, size, m_filePointer);
 }
 
+//! If \a count is zero, the size of the data is not known until the whole stream
+//! has been read, so the stream is read into memory first. Otherwise only \a count
+//! bytes are read, as they are sent.
+bool blfwk::DataPacket::StreamDataProducer::init(string filePath, uint32_t count)
+{
+    try
+    {
+        m_stream = InputStream::open(filePath);
+
+        if (count)
+        {
+            m_dataSize = count;
+        }
+        else
+        {
+            Log::info("Reading '%s' to determine its size.\n", filePath.c_str());
+            uint8_t buffer[64 * 1024];
+            size_t bytesRead;
+            while ((bytesRead = m_stream->read(buffer, sizeof(buffer))) != 0)
+            {
+                m_data.insert(m_data.end(), buffer, buffer + bytesRead);
+                if (m_data.size() > UINT32_MAX)
+                {
+                    throw std::runtime_error("input is larger than 4GB");
+                }
+            }
+            m_stream.safe_delete();
+            m_dataSize = static_cast<uint32_t>(m_data.size());
+        }
+    }
+    catch (exception &e)
+    {
+        Log::error("Error: cannot read input data '%s': %s\n", filePath.c_str(), e.what());
+        return false;
+    }
+
+    Log::info("Preparing to send %d (0x%x) bytes to the target.\n", m_dataSize, m_dataSize);
+    return true;
+}
+
+//! If the stream ends before the declared byte count, or cannot be read, an error
+//! is logged and no more data is produced.
+uint32_t blfwk::DataPacket::StreamDataProducer::getData(uint8_t *data, uint32_t size)
+{
+    assert(data);
+    size = std::min(size, m_dataSize - m_byteIndex);
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    uint32_t count;
+    if (m_stream)
+    {
+        try
+        {
+            count = static_cast<uint32_t>(m_stream->read(data, size));
+        }
+        catch (exception &e)
+        {
+            Log::error("Error: %s\n", e.what());
+            count = 0;
+        }
+        if (count == 0)
+        {
+            Log::error("Error: input data ended after %d of %d bytes\n", m_byteIndex, m_dataSize);
+            m_dataSize = m_byteIndex;
+        }
+    }
+    else
+    {
+        count = size;
+        memcpy(data, &m_data[m_byteIndex], count);
+    }
+
+    m_byteIndex += count;
+    return count;
+}
+
 //! See host_command.h for documentation on this function.
 uint32_t blfwk::DataPacket::HexDataProducer::initFromString(const string hexData)
 {
@@ -737,6 +835,112 @@ uint8_t *blfwk::DataPacket::sendTo(Packetizer &device, uint32_t *bytesWritten, P
     return sendTo(device, bytesWritten, progress, true);
 }
 
+blfwk::DataPacket::PacketPipeline::PacketPipeline(Packetizer &device,
+                                                  DataProducer &producer,
+                                                  uint32_t packetSize,
+                                                  bool isThreaded)
+    : m_device(device)
+    , m_producer(producer)
+    , m_packetSize(MIN(packetSize, (uint32_t)kMaxHostPacketSize))
+    , m_next(0)
+    , m_offset(0)
+    , m_isRequested(false)
+    , m_isStopped(false)
+{
+    if (isThreaded)
+    {
+        m_thread = std::thread(&PacketPipeline::run, this);
+    }
+}
+
+blfwk::DataPacket::PacketPipeline::~PacketPipeline()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopped = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+}
+
+void blfwk::DataPacket::PacketPipeline::prepare(uint32_t offset)
+{
+    if (!m_thread.joinable())
+    {
+        m_offset = offset;
+        prepareNext();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_offset = offset;
+        m_isRequested = true;
+    }
+    m_condition.notify_all();
+}
+
+PreparedPacket &blfwk::DataPacket::PacketPipeline::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return !m_isRequested; });
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+
+    PreparedPacket &packet = m_packets[m_next];
+    m_next ^= 1;
+    return packet;
+}
+
+void blfwk::DataPacket::PacketPipeline::prepareNext()
+{
+    uint32_t count = 0;
+    if (m_producer.hasMoreData() && (m_offset < m_producer.getDataSize()))
+    {
+        count = m_producer.getData(m_buffers[m_next], MIN(m_packetSize, m_producer.getDataSize() - m_offset));
+    }
+    m_device.preparePacket(m_packets[m_next], m_buffers[m_next], count, kPacketType_Data);
+}
+
+void blfwk::DataPacket::PacketPipeline::run()
+{
+    Realtime::leave();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_condition.wait(lock, [this] { return m_isRequested || m_isStopped; });
+        if (m_isStopped)
+        {
+            return;
+        }
+
+        // Only the packet at m_next is touched, the other one may be in flight.
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            prepareNext();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        m_error = error;
+        m_isRequested = false;
+        m_condition.notify_all();
+    }
+}
+
 //! See host_command.h for documentation on this function.
 uint8_t *blfwk::DataPacket::sendTo(Packetizer &device, uint32_t *bytesWritten, Progress *progress, bool hasResponse)
 {
@@ -747,43 +951,59 @@ uint8_t *blfwk::DataPacket::sendTo(Packetizer &device, uint32_t *bytesWritten, P
         device.pumpSimulator();
     }
 
-    while (m_dataProducer->hasMoreData() && *bytesWritten < m_dataProducer->getDataSize())
+    // A helper thread only pays off if there is more than one packet.
+    uint32_t dataSize = m_dataProducer->getDataSize();
+    PacketPipeline pipeline(device, *m_dataProducer, m_packetSize, dataSize > m_packetSize);
+    pipeline.prepare(0);
+    PreparedPacket *packet = &pipeline.wait();
+
+    while (packet->byteCount)
     {
-        uint32_t count = MIN(m_packetSize, (m_dataProducer->getDataSize() - *bytesWritten));
-        count = m_dataProducer->getData(m_packet, count);
-        if (count)
+        uint32_t count = packet->byteCount;
+
+        // Prepare the next packet while this one is written and acknowledged.
+        pipeline.prepare(*bytesWritten + count);
+        status_t status = device.writePreparedPacket(*packet);
+        PreparedPacket *nextPacket = &pipeline.wait();
+        if (status != kStatus_Success)
         {
-            status_t status = device.writePacket((const uint8_t *)m_packet, count, kPacketType_Data);
-            if (status != kStatus_Success)
+            Log::error("Data phase write aborted by status 0x%x %s\n", status,
+                       Command::getStatusMessage(status).c_str());
+            if ((status == kStatus_AbortDataPhase) && device.isAbortEnabled())
             {
-                Log::error("Data phase write aborted by status 0x%x %s\n", status,
-                           Command::getStatusMessage(status).c_str());
-                if ((status == kStatus_AbortDataPhase) && device.isAbortEnabled())
-                {
-                    Log::error("Possible JUMP or RESET command received.\n");
-                }
-                break;
+                Log::error("Possible JUMP or RESET command received.\n");
             }
+            break;
+        }
 
-            *bytesWritten += count;
+        *bytesWritten += count;
 
-            if (progress != NULL)
+        if (progress != NULL)
+        {
+            // execute process callback function.
+            progress->progressCallback(*bytesWritten * 100 / dataSize);
+            if (progress->abortPhase())
             {
-                // execute process callback function.
-                progress->progressCallback(*bytesWritten * 100 / m_dataProducer->getDataSize());
-                if (progress->abortPhase())
-                {
-                    device.writePacket((const uint8_t *)&m_packet, 0, kPacketType_Data);
-                    break;
-                }
+                device.writePacket((const uint8_t *)&m_packet, 0, kPacketType_Data);
+                break;
             }
+        }
 #ifdef TEST_SENDER_ABORT
-            // Send zero length packet to abort data phase.
-            Log::info("Testing data phase abort\n");
-            device.writePacket((const uint8_t *)&m_packet, 0, kPacketType_Data);
-            break;
+        // Send zero length packet to abort data phase.
+        Log::info("Testing data phase abort\n");
+        device.writePacket((const uint8_t *)&m_packet, 0, kPacketType_Data);
+        break;
 #endif
-        }
+
+        packet = nextPacket;
+    }
+
+    if (!packet->byteCount && (*bytesWritten < dataSize))
+    {
+        // The data ended early, send zero length packet to abort data phase instead of leaving
+        // the target waiting for the rest.
+        Log::error("Error: aborting data phase after %d of %d bytes\n", *bytesWritten, dataSize);
+        device.writePacket((const uint8_t *)&m_packet, 0, kPacketType_Data);
     }
 
     if (hasResponse)
@@ -806,6 +1026,120 @@ uint8_t *blfwk::DataPacket::sendTo(Packetizer &device, uint32_t *bytesWritten, P
     }
 }
 
+blfwk::DataPacket::ConsumerQueue::ConsumerQueue(DataConsumer &consumer, bool isThreaded)
+    : m_consumer(consumer)
+    , m_isProcessing(false)
+    , m_isStopped(false)
+{
+    if (isThreaded)
+    {
+        m_thread = std::thread(&ConsumerQueue::run, this);
+    }
+}
+
+blfwk::DataPacket::ConsumerQueue::~ConsumerQueue()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopped = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+}
+
+void blfwk::DataPacket::ConsumerQueue::push(const uint8_t *data, uint32_t size)
+{
+    if (!m_thread.joinable())
+    {
+        m_consumer.processData(data, size);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return (m_queue.size() < kMaxQueuedPackets) || m_error; });
+    rethrowError();
+
+    std::vector<uint8_t> buffer;
+    if (!m_buffers.empty())
+    {
+        buffer.swap(m_buffers.back());
+        m_buffers.pop_back();
+    }
+    buffer.assign(data, data + size);
+    m_queue.push_back(std::vector<uint8_t>());
+    m_queue.back().swap(buffer);
+    m_condition.notify_all();
+}
+
+void blfwk::DataPacket::ConsumerQueue::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return (m_queue.empty() && !m_isProcessing) || m_error; });
+    rethrowError();
+}
+
+void blfwk::DataPacket::ConsumerQueue::rethrowError()
+{
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = std::exception_ptr();
+        m_queue.clear();
+        std::rethrow_exception(error);
+    }
+}
+
+void blfwk::DataPacket::ConsumerQueue::run()
+{
+    Realtime::leave();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        // Process everything that was queued before stopping.
+        m_condition.wait(lock, [this] { return !m_queue.empty() || m_isStopped; });
+        if (m_queue.empty())
+        {
+            return;
+        }
+
+        std::vector<uint8_t> buffer;
+        buffer.swap(m_queue.front());
+        m_queue.pop_front();
+        m_isProcessing = true;
+        m_condition.notify_all();
+
+        // Once the consumer has failed, the rest of the data is dropped.
+        bool isFailed = (bool)m_error;
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            if (!isFailed)
+            {
+                m_consumer.processData(buffer.data(), (uint32_t)buffer.size());
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        m_isProcessing = false;
+        if (error && !m_error)
+        {
+            m_error = error;
+        }
+        m_buffers.push_back(std::vector<uint8_t>());
+        m_buffers.back().swap(buffer);
+        m_condition.notify_all();
+    }
+}
+
 //! See host_command.h for documentation on this function.
 uint8_t *blfwk::DataPacket::receiveFrom(Packetizer &device, uint32_t *byteCount, Progress *progress)
 {
@@ -817,6 +1151,11 @@ uint8_t *blfwk::DataPacket::receiveFrom(Packetizer &device, uint32_t *byteCount,
         device.pumpSimulator();
     }
 
+    // The ACK of a data packet is deferred until the next packet is read, so hand the
+    // data to the consumer thread and read on without waiting for it to be processed.
+    ConsumerQueue queue(*m_dataConsumer, m_dataConsumer->canProcessInBackground() && (totalCount > m_packetSize));
+    bool isComplete = false;
+
     while (*byteCount > 0)
     {
         uint8_t *dataPacket;
@@ -831,6 +1170,7 @@ uint8_t *blfwk::DataPacket::receiveFrom(Packetizer &device, uint32_t *byteCount,
         if (status != kStatus_Success)
         {
             Log::info("Read data packet error. Sending ACK.\n");
+            queue.flush();
             m_dataConsumer->finalize();
             device.sync();
             return NULL;
@@ -843,12 +1183,12 @@ uint8_t *blfwk::DataPacket::receiveFrom(Packetizer &device, uint32_t *byteCount,
             break;
         }
 
-        m_dataConsumer->processData(dataPacket, length);
+        queue.push(dataPacket, length);
         *byteCount -= length;
 
         if (*byteCount <= 0)
         {
-            m_dataConsumer->finalize();
+            isComplete = true;
         }
 
         if (progress != NULL)
@@ -870,7 +1210,15 @@ uint8_t *blfwk::DataPacket::receiveFrom(Packetizer &device, uint32_t *byteCount,
     // Read the final generic response packet.
     uint8_t *responsePacket;
     uint32_t responseLength;
-    if (device.readPacket(&responsePacket, &responseLength, kPacketType_Command) != kStatus_Success)
+    status = device.readPacket(&responsePacket, &responseLength, kPacketType_Command);
+
+    queue.flush();
+    if (isComplete)
+    {
+        m_dataConsumer->finalize();
+    }
+
+    if (status != kStatus_Success)
     {
         return NULL;
     }
@@ -1707,9 +2055,11 @@ void WriteMemory::sendTo(Packetizer &device)
 {
     DataPacket::HexDataProducer hexProducer(m_data);
     DataPacket::FileDataProducer fileProducer;
+    DataPacket::StreamDataProducer streamProducer;
     DataPacket::SegmentDataProducer segmentProducer(m_segment);
     DataPacket::DataProducer *dataProducer;
 
+    m_bytesWritten = 0;
     if (m_segment)
     {
         dataProducer = &segmentProducer;
@@ -1727,6 +2077,15 @@ void WriteMemory::sendTo(Packetizer &device)
     {
         dataProducer = &hexProducer;
     }
+    else if (InputStream::isStreamingPath(m_fileOrData))
+    {
+        // Standard input, pipe or compressed file, which cannot be seeked.
+        if (!streamProducer.init(m_fileOrData, m_count))
+        {
+            return;
+        }
+        dataProducer = &streamProducer;
+    }
     else
     {
         // Argument string is file name, so use file data producer.
@@ -1753,9 +2112,10 @@ void WriteMemory::sendTo(Packetizer &device)
         packetSizeInBytes = getPacketSize.getResponseValues()->at(1);
         if (packetSizeInBytes > device.getMaxPacketSize())
         {
-            Log::error("Error: Packet size(%d) is bigger than max supported size(%d).", packetSizeInBytes,
-                       kMaxHostPacketSize);
-            return;
+            // Smaller packets are always accepted, and the peripheral may not carry bigger ones.
+            Log::debug("Packet size(%d) is bigger than max supported size(%d), using the latter.\n",
+                       packetSizeInBytes, device.getMaxPacketSize());
+            packetSizeInBytes = device.getMaxPacketSize();
         }
     }
 
@@ -1780,6 +2140,7 @@ void WriteMemory::sendTo(Packetizer &device)
     blfwk::DataPacket dataPacket(dataProducer, packetSizeInBytes);
 
     processResponse(dataPacket.sendTo(device, &bytesWritten, m_progress));
+    m_bytesWritten = bytesWritten;
 
     // Format the command transfer details.
     m_responseDetails = format_string("Wrote %d of %d bytes.", bytesWritten, bytesToWrite);
@@ -2030,14 +2391,67 @@ void FillMemory::sendTo(Packetizer &device)
 // See host_command.h for documentation of this method.
 bool ReceiveSbFile::init()
 {
-    if (getArgCount() != 2)
+    if (getArgCount() != 2 && getArgCount() != 3)
     {
         return false;
     }
     m_dataFile = getArg(1);
+
+    if (getArgCount() == 3)
+    {
+        string strAbortMode = getArg(2);
+        if (strAbortMode == "auto")
+        {
+            m_abortMode = kAbortModeAuto;
+        }
+        else if (strAbortMode == "abort")
+        {
+            m_abortMode = kAbortModeEnabled;
+        }
+        else if (strAbortMode == "noabort")
+        {
+            m_abortMode = kAbortModeDisabled;
+        }
+        else
+        {
+            return false;
+        }
+    }
     return true;
 }
 
+//! Polling for an abort packet after every data packet is only needed if the SB file
+//! contains a JUMP(EXECUTE), CALL or RESET command, or another command that ends the
+//! data phase early. In auto mode the file is scanned for such commands. If it cannot
+//! be scanned, for example because it is encrypted, polling stays enabled.
+//!
+//! Building with BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP set to 1 turns polling off
+//! in auto mode without scanning.
+bool ReceiveSbFile::isAbortPollingNeeded() const
+{
+    switch (m_abortMode)
+    {
+        case kAbortModeEnabled:
+            return true;
+
+        case kAbortModeDisabled:
+            return false;
+
+        default:
+        {
+#if defined(BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP) && (BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP == 1)
+            return false;
+#else
+            std::ifstream stream(m_dataFile.c_str(), std::ios_base::in | std::ios_base::binary);
+            bool canAbort = !stream.is_open() || SBSourceFile::canAbortTransfer(stream);
+            Log::info("SB file %s abort the transfer, %s abort packet polling.\n", canAbort ? "may" : "cannot",
+                      canAbort ? "enabling" : "disabling");
+            return canAbort;
+#endif
+        }
+    }
+}
+
 // See host_command.h for documentation of this method.
 void ReceiveSbFile::sendTo(Packetizer &device)
 {
@@ -2063,9 +2477,10 @@ void ReceiveSbFile::sendTo(Packetizer &device)
         packetSizeInBytes = getPacketSize.getResponseValues()->at(1);
         if (packetSizeInBytes > device.getMaxPacketSize())
         {
-            Log::error("Error: Packet size(%d) is bigger than max supported size(%d).", packetSizeInBytes,
-                       kMaxHostPacketSize);
-            return;
+            // Smaller packets are always accepted, and the peripheral may not carry bigger ones.
+            Log::debug("Packet size(%d) is bigger than max supported size(%d), using the latter.\n",
+                       packetSizeInBytes, device.getMaxPacketSize());
+            packetSizeInBytes = device.getMaxPacketSize();
         }
     }
 
@@ -2086,18 +2501,14 @@ void ReceiveSbFile::sendTo(Packetizer &device)
     }
 
     // Send data packets.
-#if !(defined(BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP) && (BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP == 1))
-    /*
-     * If the SB file used for the target doesn't contain any JUMP(EXECUTE), CALL or RESET command.
-     * The macro BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP can be set to improve the transformation performance.
-     */
-    device.setAbortEnabled(true);
-#endif
+    bool isAbortEnabled = isAbortPollingNeeded();
+    device.setAbortEnabled(isAbortEnabled);
     blfwk::DataPacket dataPacket(&dataProducer, packetSizeInBytes);
     processResponse(dataPacket.sendTo(device, &bytesWritten, m_progress));
-#if !(defined(BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP) && (BL_FEATURE_RECEIVE_SB_FILE_CMD_PERF_IMP == 1))
-    device.setAbortEnabled(false);
-#endif
+    if (isAbortEnabled)
+    {
+        device.setAbortEnabled(false);
+    }
 
     // Format the command transfer details.
     m_responseDetails = format_string("Wrote %d of %d bytes.", bytesWritten, bytesToWrite);
@@ -2221,9 +2632,10 @@ void FuseProgram::sendTo(Packetizer &device)
         packetSizeInBytes = getPacketSize.getResponseValues()->at(1);
         if (packetSizeInBytes > device.getMaxPacketSize())
         {
-            Log::error("Error: Packet size(%d) is bigger than max supported size(%d).", packetSizeInBytes,
-                       kMaxHostPacketSize);
-            return;
+            // Smaller packets are always accepted, and the peripheral may not carry bigger ones.
+            Log::debug("Packet size(%d) is bigger than max supported size(%d), using the latter.\n",
+                       packetSizeInBytes, device.getMaxPacketSize());
+            packetSizeInBytes = device.getMaxPacketSize();
         }
     }
 
@@ -2440,9 +2852,10 @@ void LoadImage::sendTo(Packetizer &device)
         packetSizeInBytes = getPacketSize.getResponseValues()->at(1);
         if (packetSizeInBytes > device.getMaxPacketSize())
         {
-            Log::error("Error: Packet size(%d) is bigger than max supported size(%d).", packetSizeInBytes,
-                       kMaxHostPacketSize);
-            return;
+            // Smaller packets are always accepted, and the peripheral may not carry bigger ones.
+            Log::debug("Packet size(%d) is bigger than max supported size(%d), using the latter.\n",
+                       packetSizeInBytes, device.getMaxPacketSize());
+            packetSizeInBytes = device.getMaxPacketSize();
         }
     }
 
@@ -3270,9 +3683,10 @@ void KeyProvisioning::sendCmdAndData(Packetizer &device)
         packetSizeInBytes = getPacketSize.getResponseValues()->at(1);
         if (packetSizeInBytes > device.getMaxPacketSize())
         {
-            Log::error("Error: Packet size(%d) is bigger than max supported size(%d).", packetSizeInBytes,
-                       kMaxHostPacketSize);
-            return;
+            // Smaller packets are always accepted, and the peripheral may not carry bigger ones.
+            Log::debug("Packet size(%d) is bigger than max supported size(%d), using the latter.\n",
+                       packetSizeInBytes, device.getMaxPacketSize());
+            packetSizeInBytes = device.getMaxPacketSize();
         }
     }
 
@@ -3950,14 +4364,32 @@ bool TrustProvisioning::processResponse(const trust_provisioning_response_packet
 // See host_command.h for documentation of this method.
 bool FlashImage::init()
 {
-    if (getArgCount() != 2 && getArgCount() != 3 && getArgCount() != 4)
+    size_t argCount = getArgCount();
+
+    // An optional trailing keyword selects how ELF files are split into segments.
+    if (argCount > 2)
+    {
+        string strLoadModeOpt = getArg(argCount - 1);
+        if (strLoadModeOpt == "segments")
+        {
+            m_elfLoadMode = kLoadSegments;
+            --argCount;
+        }
+        else if (strLoadModeOpt == "sections")
+        {
+            m_elfLoadMode = kLoadSections;
+            --argCount;
+        }
+    }
+
+    if (argCount != 2 && argCount != 3 && argCount != 4)
     {
         return false;
     }
 
     m_fileName = getArg(1);
 
-    if (getArgCount() == 3)
+    if (argCount == 3)
     {
         string strDoEraseOpt = getArg(2);
         if (strDoEraseOpt == "erase")
@@ -3988,7 +4420,7 @@ bool FlashImage::init()
             m_doEraseOpt = false;
         }
     }
-    else if (getArgCount() == 4)
+    else if (argCount == 4)
     {
         string strDoEraseOpt = getArg(2);
         if (strDoEraseOpt == "erase")
@@ -4024,6 +4456,25 @@ void FlashImage::sendTo(Packetizer &device)
     uint32_t fw_status;
     DataSource *dataSource;
 
+    // The standard input, pipes and compressed files can only be read once, from
+    // start to end, so they are always streamed.
+    if (InputStream::isStreamingPath(m_fileName))
+    {
+        StreamingDataSource *streamingSource;
+        try
+        {
+            streamingSource = SourceFile::openStream(m_fileName);
+        }
+        catch (exception &e)
+        {
+            Log::error("Error: %s\n", e.what());
+            return;
+        }
+        Log::log(Logger::kDebug2, "streaming %s\n", m_fileName.c_str());
+        sendStreamingTo(device, streamingSource);
+        return;
+    }
+
     try
     {
         m_sourceFile = SourceFile::openFile(m_fileName);
@@ -4039,8 +4490,73 @@ void FlashImage::sendTo(Packetizer &device)
         return;
     }
 
-    m_sourceFile->open();
-    dataSource = m_sourceFile->createDataSource();
+    ELFSourceFile *elfFile = dynamic_cast<ELFSourceFile *>(m_sourceFile);
+    if (elfFile)
+    {
+        elfFile->setLoadMode(m_elfLoadMode);
+    }
+
+    // Look the file up in the parsed image cache, if enabled. The key covers every
+    // setting that changes the segments built from the file.
+    smart_ptr<ImageCache> imageCache;
+    std::string cacheKey;
+    dataSource = NULL;
+    if (!m_imageCacheDirectory.empty())
+    {
+        imageCache = new ImageCache(m_imageCacheDirectory);
+        try
+        {
+            std::string cacheOptions =
+                format_string("type=%d,elfLoadMode=%d", (int)m_sourceFile->getFileType(), (int)m_elfLoadMode);
+            cacheKey = imageCache->makeKey(m_sourceFile->getPath(), cacheOptions);
+            dataSource = imageCache->load(cacheKey);
+        }
+        catch (exception &e)
+        {
+            Log::warning("Warning: not using image cache: %s\n", e.what());
+            imageCache.safe_delete();
+        }
+    }
+    // Very large files are written while they are parsed, to bound memory use and so
+    // that writing starts before the whole file has been parsed. The cache needs the
+    // whole parsed image, so files are not streamed when it is enabled.
+    else if (m_sourceFile->getSize() >= kMinStreamingFileSize)
+    {
+        StreamingDataSource *streamingSource;
+        try
+        {
+            streamingSource = m_sourceFile->createStreamingDataSource();
+        }
+        catch (exception &e)
+        {
+            Log::error("Error: %s\n", e.what());
+            return;
+        }
+        if (streamingSource)
+        {
+            Log::log(Logger::kDebug2, "streaming %s\n", m_sourceFile->getPath().c_str());
+            sendStreamingTo(device, streamingSource);
+            return;
+        }
+    }
+
+    if (!dataSource)
+    {
+        m_sourceFile->open();
+        dataSource = m_sourceFile->createDataSource();
+
+        if (imageCache)
+        {
+            try
+            {
+                imageCache->store(cacheKey, *dataSource);
+            }
+            catch (exception &e)
+            {
+                Log::warning("Warning: %s\n", e.what());
+            }
+        }
+    }
 
     m_progress->m_segmentCount = dataSource->getSegmentCount();
 
@@ -4058,7 +4574,7 @@ void FlashImage::sendTo(Packetizer &device)
 
             // Do erase operation to erase the necessary flash.
             FlashEraseRegion cmd(alignedStart, alignedLength, m_memoryId);
-            cmd.sendTo(device);
+            sendSubCommand(device, cmd);
 
             // Print and check the command response values.
             fw_status = cmd.getResponseValues()->at(0);
@@ -4082,7 +4598,7 @@ void FlashImage::sendTo(Packetizer &device)
         m_progress->m_segmentIndex = index + 1;
         cmd.registerProgress(m_progress);
 
-        cmd.sendTo(device);
+        sendSubCommand(device, cmd);
 
         // Print and check the command response values.
         fw_status = cmd.getResponseValues()->at(0);
@@ -4096,7 +4612,137 @@ void FlashImage::sendTo(Packetizer &device)
 
     m_responseValues.push_back(fw_status);
     delete dataSource;
-    m_sourceFile->close();
+    if (m_sourceFile->isOpen())
+    {
+        m_sourceFile->close();
+    }
+}
+
+//! Segments are written as soon as the parser produces them, so the total segment
+//! count is not known in advance and the progress shows the running segment index.
+//! If erase is requested, the sectors of each segment are erased just before it is
+//! written, skipping sectors that an earlier segment already erased.
+//!
+//! Records are checked as they are parsed, so a bad record or overlapping data stops
+//! the write with the data before it already written. The parser runs ahead of the
+//! writes, so once it fails the data phase of the segment being written is aborted
+//! and no further segments are written.
+//!
+//! Takes ownership of \a dataSource.
+void FlashImage::sendStreamingTo(Packetizer &device, StreamingDataSource *dataSource)
+{
+    smart_ptr<StreamingDataSource> source(dataSource);
+    erased_range_map_t erasedRanges;
+    uint32_t fw_status = kStatus_Success;
+    uint32_t index = 0;
+
+    try
+    {
+        StreamingDataSource::ChunkSegment *nextSegment;
+        while ((nextSegment = source->getNextSegment()) != NULL)
+        {
+            smart_ptr<StreamingDataSource::ChunkSegment> segment(nextSegment);
+            ++index;
+            m_progress->m_segmentIndex = index;
+            m_progress->m_segmentCount = index;
+
+            if (m_doEraseOpt)
+            {
+                fw_status = eraseRange(device, segment->getBaseAddress(), segment->getLength(), erasedRanges);
+                if (fw_status != kStatus_Success)
+                {
+                    m_responseValues.push_back(fw_status);
+                    return;
+                }
+            }
+
+            // Write the segment to its base address.
+            Log::info("Wrote %d bytes to address %#x\n", segment->getLength(), segment->getBaseAddress());
+            WriteMemory cmd(segment.get(), m_memoryId);
+            cmd.registerProgress(m_progress);
+            sendSubCommand(device, cmd);
+
+            // Print and check the command response values.
+            fw_status = cmd.getResponseValues()->at(0);
+            if (fw_status != kStatus_Success)
+            {
+                m_responseValues.push_back(fw_status);
+            }
+
+            // Stop at a bad record, which may have cut this write short, and report it.
+            if (source->hasFailed())
+            {
+                source->drain();
+            }
+            if (fw_status != kStatus_Success)
+            {
+                return;
+            }
+        }
+    }
+    catch (exception &e)
+    {
+        Log::error("Error: %s\n", e.what());
+        return;
+    }
+
+    m_responseValues.push_back(fw_status);
+}
+
+//! The range is widened to #MinEraseAlignment boundaries. Only the parts of the
+//! widened range that are not in \a erased are erased, after which the range is
+//! merged into \a erased.
+//!
+//! \return Status of the first failing erase, or kStatus_Success.
+uint32_t FlashImage::eraseRange(Packetizer &device, uint32_t start, uint32_t length, erased_range_map_t &erased)
+{
+    uint64_t alignedStart = start & (~(MinEraseAlignment - 1));
+    uint64_t alignedEnd = ((uint64_t)start + length + MinEraseAlignment - 1) & (~((uint64_t)MinEraseAlignment - 1));
+    uint64_t mergedStart = alignedStart;
+    uint64_t mergedEnd = alignedEnd;
+    uint64_t position = alignedStart;
+    uint32_t fw_status = kStatus_Success;
+
+    // Find the first erased range that overlaps or touches the new range.
+    erased_range_map_t::iterator it = erased.upper_bound(alignedStart);
+    if (it != erased.begin())
+    {
+        erased_range_map_t::iterator previous = it;
+        --previous;
+        if (previous->second >= alignedStart)
+        {
+            it = previous;
+        }
+    }
+
+    while (fw_status == kStatus_Success)
+    {
+        bool isOverlapping = (it != erased.end()) && (it->first <= alignedEnd);
+        uint64_t gapEnd = isOverlapping ? std::min(it->first, alignedEnd) : alignedEnd;
+
+        if (position < gapEnd)
+        {
+            FlashEraseRegion cmd((uint32_t)position, (uint32_t)(gapEnd - position), m_memoryId);
+            sendSubCommand(device, cmd);
+            fw_status = cmd.getResponseValues()->at(0);
+        }
+
+        if (!isOverlapping)
+        {
+            break;
+        }
+
+        position = std::max(position, it->second);
+        mergedStart = std::min(mergedStart, it->first);
+        mergedEnd = std::max(mergedEnd, it->second);
+        erased.erase(it++);
+    }
+
+    if (fw_status == kStatus_Success)
+    {
+        erased[mergedStart] = mergedEnd;
+    }
+    return fw_status;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/CommandTimeouts.h"
+#include "blfwk/Logging.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace blfwk;
+
+//! Program unit assumed when the device does not report its page size.
+static const uint32_t kDefaultPageSize = 4096;
+
+//! Rates assumed before one is measured, in milliseconds per KiB or per configure, for
+//! internal and external memories. They are close to the worst case of common parts.
+static const double kDefaultRates[kMemoryOperation_Count][2] = {
+    { 32, 100 },    // Erase
+    { 8, 16 },      // Erase all
+    { 32, 16 },     // Write
+    { 3000, 3000 }, // Configure
+};
+
+//! Returns true if \a memoryId is the internal flash, whose geometry has its own properties.
+static bool is_internal_flash(uint32_t memoryId)
+{
+    return (memoryId == kMemoryInternal) || (memoryId == kMemoryFlashExecuteOnly);
+}
+
+uint32_t CommandTimeouts::getPacketTimeout(Packetizer &packetizer, const Command &cmd, uint32_t baseTimeoutMs)
+{
+    memory_operation_t operation;
+    if (!cmd.getMemoryOperation(operation) || isOutsideFlash(operation))
+    {
+        return baseTimeoutMs;
+    }
+
+    double expectedMs = getWork(packetizer, operation) * getRate(operation);
+    const memory_info_t *info = findMemoryInfo(operation.memoryId);
+    if ((operation.operation == kMemoryOperation_Write) && info)
+    {
+        expectedMs = std::max(expectedMs, (double)info->byteWriteTimeoutMs);
+    }
+
+    double timeoutMs = baseTimeoutMs + kMargin * expectedMs;
+    uint32_t packetTimeoutMs = (timeoutMs >= (double)UINT32_MAX) ? UINT32_MAX : (uint32_t)timeoutMs;
+    Log::debug("  - expected to take %.0f ms, packet timeout %u ms\n", expectedMs, packetTimeoutMs);
+    return packetTimeoutMs;
+}
+
+void CommandTimeouts::learn(Packetizer &packetizer, const Command &cmd, uint64_t elapsedUs)
+{
+    memory_operation_t operation;
+    if (!cmd.getMemoryOperation(operation) || isOutsideFlash(operation))
+    {
+        return;
+    }
+
+    // A write to memory ID 0 may have been to RAM until the flash range is known.
+    if ((operation.operation == kMemoryOperation_Write) && (operation.memoryId == kMemoryInternal) &&
+        !findMemoryInfo(operation.memoryId))
+    {
+        return;
+    }
+
+    // The work of a write is the whole range here, while getWork() returns that of one packet.
+    double work = (operation.operation == kMemoryOperation_Write) ? operation.byteCount / 1024.0 :
+                                                                    getWork(packetizer, operation);
+    if (work <= 0)
+    {
+        return;
+    }
+
+    // Rates rise at once to a slower measurement, and only fall gradually, so that a
+    // single fast command does not make the next one time out.
+    double rate = (elapsedUs / 1000.0) / work;
+    rate_key_t key(operation.operation, operation.memoryId);
+    std::map<rate_key_t, double>::iterator it = m_rates.find(key);
+    if (it == m_rates.end())
+    {
+        m_rates[key] = rate;
+    }
+    else
+    {
+        it->second = std::max(rate, (3 * it->second + rate) / 4);
+    }
+}
+
+void CommandTimeouts::send(Packetizer &packetizer, Command &cmd)
+{
+    uint32_t baseTimeoutMs = packetizer.getPacketTimeout();
+    packetizer.setPacketTimeout(getPacketTimeout(packetizer, cmd, baseTimeoutMs));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    try
+    {
+        cmd.sendTo(packetizer);
+    }
+    catch (...)
+    {
+        packetizer.setPacketTimeout(baseTimeoutMs);
+        throw;
+    }
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+    packetizer.setPacketTimeout(baseTimeoutMs);
+
+    const uint32_vector_t *responseValues = cmd.getResponseValues();
+    if (responseValues->size() && (responseValues->at(0) == kStatus_Success))
+    {
+        learn(packetizer, cmd, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+}
+
+const CommandTimeouts::memory_info_t &CommandTimeouts::getMemoryInfo(Packetizer &packetizer, uint32_t memoryId)
+{
+    std::map<uint32_t, memory_info_t>::iterator it = m_memories.find(memoryId);
+    if (it != m_memories.end())
+    {
+        return it->second;
+    }
+
+    memory_info_t info = { 0, 0, 0, 0, 0 };
+    uint32_vector_t values;
+    if (is_internal_flash(memoryId))
+    {
+        if (readProperty(packetizer, kProperty_FlashStartAddress, memoryId, values))
+        {
+            info.startAddress = values.at(0);
+        }
+        if (readProperty(packetizer, kProperty_FlashSizeInBytes, memoryId, values))
+        {
+            info.sizeInBytes = values.at(0);
+        }
+        if (readProperty(packetizer, kProperty_FlashSectorSize, memoryId, values))
+        {
+            info.sectorSize = values.at(0);
+        }
+        if (readProperty(packetizer, kProperty_FlashPageSize, memoryId, values))
+        {
+            info.pageSize = values.at(0);
+        }
+        if (readProperty(packetizer, kProperty_ByteWriteTimeoutMs, memoryId, values))
+        {
+            info.byteWriteTimeoutMs = values.at(0);
+        }
+    }
+    else if (readProperty(packetizer, kProperty_ExernalMemoryAttributes, memoryId, values) && (values.size() >= 6))
+    {
+        uint32_t available = values[0];
+        if (available & (1 << (kExternalMemoryPropertyTag_MemorySizeInKbytes - 1)))
+        {
+            info.sizeInBytes = (uint64_t)values[2] * 1024;
+        }
+        if (available & (1 << (kExternalMemoryPropertyTag_PageSize - 1)))
+        {
+            info.pageSize = values[3];
+        }
+        if (available & (1 << (kExternalMemoryPropertyTag_SectorSize - 1)))
+        {
+            info.sectorSize = values[4];
+        }
+    }
+
+    Log::debug("  - memory 0x%x: start 0x%08x, size %llu, sector %u, page %u, write timeout %u ms\n",
+               memoryId, info.startAddress, (unsigned long long)info.sizeInBytes, info.sectorSize, info.pageSize,
+               info.byteWriteTimeoutMs);
+    return m_memories[memoryId] = info;
+}
+
+const CommandTimeouts::memory_info_t *CommandTimeouts::findMemoryInfo(uint32_t memoryId) const
+{
+    std::map<uint32_t, memory_info_t>::const_iterator it = m_memories.find(memoryId);
+    return (it != m_memories.end()) ? &it->second : NULL;
+}
+
+bool CommandTimeouts::isOutsideFlash(const memory_operation_t &operation) const
+{
+    const memory_info_t *info = findMemoryInfo(operation.memoryId);
+    if ((operation.memoryId != kMemoryInternal) || (operation.operation == kMemoryOperation_EraseAll) || !info ||
+        !info->sizeInBytes)
+    {
+        return false;
+    }
+    return (operation.address < info->startAddress) ||
+           (operation.address >= (uint64_t)info->startAddress + info->sizeInBytes);
+}
+
+bool CommandTimeouts::readProperty(Packetizer &packetizer, property_t tag, uint32_t memoryId, uint32_vector_t &values)
+{
+    GetProperty cmd(tag, memoryId);
+    cmd.sendTo(packetizer);
+
+    const uint32_vector_t *response = cmd.getResponseValues();
+    if ((response->size() < 2) || (response->at(0) != kStatus_Success))
+    {
+        return false;
+    }
+    values.assign(response->begin() + 1, response->end());
+    return true;
+}
+
+double CommandTimeouts::getWork(Packetizer &packetizer, const memory_operation_t &operation)
+{
+    switch (operation.operation)
+    {
+        case kMemoryOperation_Erase:
+        {
+            // The device erases whole sectors, so the range is widened to sector boundaries.
+            uint64_t sectorSize = std::max(getMemoryInfo(packetizer, operation.memoryId).sectorSize, 1u);
+            uint64_t start = operation.address - (operation.address % sectorSize);
+            uint64_t end = (uint64_t)operation.address + operation.byteCount;
+            end = ((end + sectorSize - 1) / sectorSize) * sectorSize;
+            return (end - start) / 1024.0;
+        }
+        case kMemoryOperation_EraseAll:
+            return getMemoryInfo(packetizer, operation.memoryId).sizeInBytes / 1024.0;
+        case kMemoryOperation_Write:
+        {
+            // Each data packet is answered once at most a page has been programmed.
+            const memory_info_t *info = findMemoryInfo(operation.memoryId);
+            return ((info && info->pageSize) ? info->pageSize : kDefaultPageSize) / 1024.0;
+        }
+        case kMemoryOperation_Configure:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+double CommandTimeouts::getRate(const memory_operation_t &operation) const
+{
+    std::map<rate_key_t, double>::const_iterator it = m_rates.find(rate_key_t(operation.operation, operation.memoryId));
+    if (it != m_rates.end())
+    {
+        return it->second;
+    }
+    return kDefaultRates[operation.operation][is_internal_flash(operation.memoryId) ? 0 : 1];
+}
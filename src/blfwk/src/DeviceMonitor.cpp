@@ -0,0 +1,188 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/DeviceMonitor.h"
+#include "blfwk/Logging.h"
+#include "hidapi.h"
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#if defined(LINUX)
+#include <limits.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#elif !defined(WIN32)
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif // LINUX
+
+using namespace blfwk;
+
+#if defined(LINUX)
+//! Netlink multicast groups of the kernel and of udev. Events of the kernel arrive first,
+//! those of udev once the node has been set up.
+static const uint32_t kKernelEventGroup = 1;
+static const uint32_t kUdevEventGroup = 2;
+#endif // LINUX
+
+DeviceMonitor::DeviceMonitor()
+    : m_socket(-1)
+    , m_removed()
+{
+#if defined(LINUX)
+    m_socket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (m_socket < 0)
+    {
+        Log::debug("Cannot open the device event socket: %s\n", strerror(errno));
+        return;
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = kKernelEventGroup | kUdevEventGroup;
+    if (bind(m_socket, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        Log::debug("Cannot listen to device events: %s\n", strerror(errno));
+        close(m_socket);
+        m_socket = -1;
+    }
+#endif // LINUX
+}
+
+DeviceMonitor::~DeviceMonitor()
+{
+#if defined(LINUX)
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+    }
+#endif // LINUX
+}
+
+bool DeviceMonitor::waitUntil(const std::function<bool()> &isDone, const Deadline &deadline)
+{
+    for (;;)
+    {
+        readEvents();
+        if (isDone())
+        {
+            return true;
+        }
+
+        uint32_t timeoutMs = deadline.getRemainingMs();
+        if (timeoutMs == 0)
+        {
+            return false;
+        }
+        if (timeoutMs > kCheckIntervalMs)
+        {
+            timeoutMs = kCheckIntervalMs;
+        }
+#if defined(LINUX)
+        if (m_socket >= 0)
+        {
+            struct pollfd fd;
+            fd.fd = m_socket;
+            fd.events = POLLIN;
+            fd.revents = 0;
+            poll(&fd, 1, (int)timeoutMs);
+            continue;
+        }
+#endif // LINUX
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+    }
+}
+
+bool DeviceMonitor::isRemoved(const std::string &devicePath) const
+{
+    return m_removed.find(devicePath) != m_removed.end();
+}
+
+void DeviceMonitor::readEvents()
+{
+#if defined(LINUX)
+    if (m_socket < 0)
+    {
+        return;
+    }
+
+    // Kernel events are "<action>@<path>" followed by "<key>=<value>" strings. The removal of
+    // a node is taken from them, events of udev only serve to wake up.
+    char buffer[8192];
+    ssize_t length;
+    while ((length = recv(m_socket, buffer, sizeof(buffer) - 1, 0)) > 0)
+    {
+        buffer[length] = 0;
+        if (strncmp(buffer, "remove@", strlen("remove@")) != 0)
+        {
+            continue;
+        }
+        for (const char *field = buffer; field < buffer + length; field += strlen(field) + 1)
+        {
+            if (strncmp(field, "DEVNAME=", strlen("DEVNAME=")) == 0)
+            {
+                std::string name(field + strlen("DEVNAME="));
+                m_removed.insert((name[0] == '/') ? name : "/dev/" + name);
+                Log::debug("Device %s removed\n", name.c_str());
+            }
+        }
+    }
+#endif // LINUX
+}
+
+bool DeviceMonitor::findUsbHid(uint16_t vid, uint16_t pid, const std::string &serialNumber, std::string &devicePath)
+{
+    struct hid_device_info *devices = hid_enumerate(vid, pid);
+    bool isFound = false;
+    for (struct hid_device_info *device = devices; device && !isFound; device = device->next)
+    {
+        if (!serialNumber.empty())
+        {
+            // Serial numbers are ASCII, so comparing them character by character is enough.
+            const wchar_t *serial = device->serial_number ? device->serial_number : L"";
+            if (std::wstring(serial) != std::wstring(serialNumber.begin(), serialNumber.end()))
+            {
+                continue;
+            }
+        }
+        devicePath = device->path ? device->path : "";
+        isFound = true;
+    }
+    hid_free_enumeration(devices);
+#if defined(LINUX)
+    // udev sets the permissions of the node after the kernel has created it.
+    return isFound && isNodeReady(devicePath);
+#else
+    return isFound;
+#endif // LINUX
+}
+
+bool DeviceMonitor::isNodeReady(const std::string &devicePath)
+{
+#if defined(WIN32)
+    return true;
+#else
+    return access(devicePath.c_str(), R_OK | W_OK) == 0;
+#endif // WIN32
+}
+
+std::string DeviceMonitor::resolveNode(const std::string &path)
+{
+#if defined(WIN32)
+    return path;
+#else
+    char resolved[PATH_MAX];
+    return realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+#endif // WIN32
+}
@@ -32,12 +32,18 @@
 #define kSecinfoROMName "ROM"
 #define kSecinfoCName "C"
 
+//! Name of the option to select how segments are built.
+#define kLoadModeOptionName "loadMode"
+#define kLoadSectionsName "SECTIONS"
+#define kLoadSegmentsName "SEGMENTS"
+
 using namespace blfwk;
 
 ELFSourceFile::ELFSourceFile(const std::string &path)
     : SourceFile(path, kELFSourceFile)
     , m_toolset(kUnknownToolset)
     , m_secinfoOption(kSecinfoDefault)
+    , m_loadMode(kLoadModeDefault)
 {
 }
 
@@ -68,10 +74,29 @@ void ELFSourceFile::open()
         m_secinfoOption = kSecinfoCStartupClear;
     }
 
+    // An explicitly set load mode takes precedence over the option
+    if (m_loadMode == kLoadModeDefault)
+    {
+        m_loadMode = readLoadModeOption();
+    }
+
     // Open the stream
     SourceFile::open();
 
-    m_file = new StELFFile(*m_stream);
+    // Prefer parsing a memory mapping of the file, so that only the headers and the
+    // loadable sections are ever read. Debug sections are never touched. Fall back to
+    // reading through the stream if the file cannot be mapped.
+    try
+    {
+        m_mapping = new MappedFile(m_path);
+        m_file = new StELFFile(m_mapping->getData(), m_mapping->getSize());
+    }
+    catch (std::runtime_error &e)
+    {
+        Log::log(Logger::kDebug2, "not using memory mapping for %s: %s\n", m_path.c_str(), e.what());
+        m_mapping.safe_delete();
+        m_file = new StELFFile(*m_stream);
+    }
     //  m_file->dumpSections();
 
     // Set toolset in elf file object
@@ -96,6 +121,7 @@ void ELFSourceFile::close()
     SourceFile::close();
 
     m_file.safe_delete();
+    m_mapping.safe_delete();
 }
 
 elf_toolset_t ELFSourceFile::readToolsetOption()
@@ -194,14 +220,142 @@ secinfo_clear_t ELFSourceFile::readSecinfoClearOption()
     return kSecinfoDefault;
 }
 
+elf_load_mode_t ELFSourceFile::readLoadModeOption()
+{
+    do
+    {
+        const OptionContext *options = getOptions();
+        if (!options || !options->hasOption(kLoadModeOptionName))
+        {
+            break;
+        }
+
+        const Value *value = options->getOption(kLoadModeOptionName);
+        const StringValue *stringValue = dynamic_cast<const StringValue *>(value);
+        if (!stringValue)
+        {
+            // Not a string value, warn the user.
+            Log::log(Logger::kWarning, "invalid type for 'loadMode' option\n");
+            break;
+        }
+
+        std::string loadMode = *stringValue;
+
+        // convert option value to uppercase
+        std::transform<std::string::const_iterator, std::string::iterator, int (*)(int)>(
+            loadMode.begin(), loadMode.end(), loadMode.begin(), toupper);
+
+        if (loadMode == kLoadSectionsName)
+        {
+            return kLoadSections;
+        }
+        else if (loadMode == kLoadSegmentsName)
+        {
+            return kLoadSegments;
+        }
+
+        // Unrecognized option value, log a warning.
+        Log::log(Logger::kWarning, "unrecognized value for 'loadMode' option\n");
+    } while (0);
+
+    return kLoadModeDefault;
+}
+
 //! To create a data source for all sections of the ELF file, a WildcardMatcher
 //! is instantiated and passed to createDataSource(StringMatcher&).
+//!
+//! If the load mode is #kLoadSegments, the data source is built from the program
+//! headers instead by createDataSourceFromSegments().
 DataSource *ELFSourceFile::createDataSource()
 {
+    if (m_loadMode == kLoadSegments)
+    {
+        return createDataSourceFromSegments();
+    }
+
     WildcardMatcher matcher;
     return createDataSource(matcher);
 }
 
+//! Returns true if any allocated, non-empty section lies within the memory image
+//! of the program segment \a segment.
+static bool segmentContainsSections(StELFFile *elf, const Elf32_Phdr &segment)
+{
+    unsigned index = 1;
+    for (; index < elf->getSectionCount(); ++index)
+    {
+        const Elf32_Shdr &header = elf->getSectionAtIndex(index);
+        if ((header.sh_flags & SHF_ALLOC) == 0 || header.sh_size == 0)
+        {
+            continue;
+        }
+
+        if (header.sh_addr >= segment.p_vaddr && header.sh_addr - segment.p_vaddr < segment.p_memsz)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//! Each #PT_LOAD program header results in at most two segments: one for the data
+//! present in the file, located at the physical address (p_paddr), and a fill segment
+//! for the remainder of the memory image (p_memsz - p_filesz). This follows the load
+//! layout chosen by the linker, and typically produces a few large segments instead
+//! of one per section.
+//!
+//! Program segments that contain no allocated sections, such as a segment that only
+//! maps the ELF headers, are skipped. If the file has no loadable program segments at
+//! all, the data source is built from the sections instead.
+DataSource *ELFSourceFile::createDataSourceFromSegments()
+{
+    assert(m_file);
+    ELFDataSource *source = new ELFDataSource(m_file);
+    source->setSecinfoOption(m_secinfoOption);
+
+    Log::log(Logger::kDebug2, "loading program segments of file: %s\n", getPath().c_str());
+    try
+    {
+        unsigned index = 0;
+        for (; index < m_file->getSegmentCount(); ++index)
+        {
+            const Elf32_Phdr &header = m_file->getSegmentAtIndex(index);
+            if (header.p_type != PT_LOAD || header.p_memsz == 0)
+            {
+                continue;
+            }
+
+            if (!segmentContainsSections(m_file, header))
+            {
+                Log::log(Logger::kDebug2, "program segment %u at 0x%08X has no sections, skipping\n", index,
+                         header.p_paddr);
+                continue;
+            }
+
+            Log::log(Logger::kDebug2, "creating segment for program segment %u at 0x%08X (file %u, memory %u bytes)\n",
+                     index, header.p_paddr, header.p_filesz, header.p_memsz);
+            source->addProgramSegment(index);
+        }
+    }
+    catch (...)
+    {
+        delete source;
+        throw;
+    }
+
+    if (source->getSegmentCount() == 0)
+    {
+        Log::log(Logger::kDebug2, "no loadable program segments, using sections\n");
+        delete source;
+
+        WildcardMatcher matcher;
+        return createDataSource(matcher);
+    }
+
+    return source;
+}
+
 DataSource *ELFSourceFile::createDataSource(const std::vector<uint32_t> &baseAddresses, bool match)
 {
     assert(m_file);
@@ -572,6 +726,64 @@ void ELFSourceFile::ELFDataSource::addSection(unsigned sectionIndex)
     }
 }
 
+//! The file-backed part of the program segment becomes a LoadSegment. If the memory
+//! size is larger than the file size, the rest becomes a FillSegment. The .secinfo
+//! rules for GHS ELF files are applied to the fill segment in the same way as for
+//! #SHT_NOBITS sections.
+//!
+//! No fill segment is created when the load address differs from the run address.
+//! Such a segment is copied to its run address by the startup code, which also clears
+//! the zero-initialized tail, so filling it at the load address would only write zeroes
+//! into whatever follows the segment in flash.
+void ELFSourceFile::ELFDataSource::addProgramSegment(unsigned segmentIndex)
+{
+    const Elf32_Phdr &header = m_elf->getSegmentAtIndex(segmentIndex);
+
+    if (header.p_filesz)
+    {
+        m_segments.push_back(new LoadSegment(*this, m_elf, segmentIndex));
+    }
+
+    if (header.p_memsz > header.p_filesz)
+    {
+        bool addFill = (header.p_paddr == header.p_vaddr);
+        uint32_t fillAddress = header.p_paddr + header.p_filesz;
+        uint32_t fillLength = header.p_memsz - header.p_filesz;
+
+        if (addFill && m_elf->ELFVariant() == eGHSVariant)
+        {
+            GHSSecInfo secinfo(m_elf);
+
+            if (secinfo.hasSecinfo() && m_secinfoOption != kSecinfoIgnore)
+            {
+                switch (m_secinfoOption)
+                {
+                    case kSecinfoROMClear:
+                        addFill = secinfo.isSectionFilled(fillAddress, fillLength);
+                        break;
+
+                    case kSecinfoCStartupClear:
+                        addFill = false;
+                        break;
+
+                    default:
+                        // Do nothing.
+                        break;
+                }
+            }
+        }
+
+        if (addFill)
+        {
+            m_segments.push_back(new FillSegment(*this, m_elf, segmentIndex));
+        }
+        else
+        {
+            Log::log(Logger::kDebug2, "..program segment %u tail is not filled\n", segmentIndex);
+        }
+    }
+}
+
 ELFSourceFile::ELFDataSource::ProgBitsSegment::ProgBitsSegment(ELFDataSource &source, StELFFile *elf, unsigned index)
     : DataSource::Segment(source)
     , m_elf(elf)
@@ -582,16 +794,15 @@ ELFSourceFile::ELFDataSource::ProgBitsSegment::ProgBitsSegment(ELFDataSource &so
 unsigned ELFSourceFile::ELFDataSource::ProgBitsSegment::getData(unsigned offset, unsigned maxBytes, uint8_t *buffer)
 {
     const Elf32_Shdr &section = m_elf->getSectionAtIndex(m_sectionIndex);
-    uint8_t *data = m_elf->getSectionDataAtIndex(m_sectionIndex);
+    const uint8_t *data = m_elf->getSectionDataView(m_sectionIndex);
 
     assert(offset < section.sh_size);
 
     unsigned copyBytes = std::min<unsigned>(section.sh_size - offset, maxBytes);
-    if (copyBytes)
+    if (copyBytes && data)
     {
         memcpy(buffer, &data[offset], copyBytes);
     }
-    delete[] data;
     return copyBytes;
 }
 
@@ -625,3 +836,56 @@ uint32_t ELFSourceFile::ELFDataSource::NoBitsSegment::getBaseAddress()
     const Elf32_Shdr &section = m_elf->getSectionAtIndex(m_sectionIndex);
     return section.sh_addr;
 }
+
+ELFSourceFile::ELFDataSource::LoadSegment::LoadSegment(ELFDataSource &source, StELFFile *elf, unsigned index)
+    : DataSource::Segment(source)
+    , m_elf(elf)
+    , m_segmentIndex(index)
+{
+}
+
+unsigned ELFSourceFile::ELFDataSource::LoadSegment::getData(unsigned offset, unsigned maxBytes, uint8_t *buffer)
+{
+    const Elf32_Phdr &segment = m_elf->getSegmentAtIndex(m_segmentIndex);
+    const uint8_t *data = m_elf->getSegmentDataView(m_segmentIndex);
+
+    assert(offset < segment.p_filesz);
+
+    unsigned copyBytes = std::min<unsigned>(segment.p_filesz - offset, maxBytes);
+    if (copyBytes && data)
+    {
+        memcpy(buffer, &data[offset], copyBytes);
+    }
+    return copyBytes;
+}
+
+unsigned ELFSourceFile::ELFDataSource::LoadSegment::getLength()
+{
+    const Elf32_Phdr &segment = m_elf->getSegmentAtIndex(m_segmentIndex);
+    return segment.p_filesz;
+}
+
+uint32_t ELFSourceFile::ELFDataSource::LoadSegment::getBaseAddress()
+{
+    const Elf32_Phdr &segment = m_elf->getSegmentAtIndex(m_segmentIndex);
+    return segment.p_paddr;
+}
+
+ELFSourceFile::ELFDataSource::FillSegment::FillSegment(ELFDataSource &source, StELFFile *elf, unsigned index)
+    : DataSource::PatternSegment(source)
+    , m_elf(elf)
+    , m_segmentIndex(index)
+{
+}
+
+unsigned ELFSourceFile::ELFDataSource::FillSegment::getLength()
+{
+    const Elf32_Phdr &segment = m_elf->getSegmentAtIndex(m_segmentIndex);
+    return segment.p_memsz - segment.p_filesz;
+}
+
+uint32_t ELFSourceFile::ELFDataSource::FillSegment::getBaseAddress()
+{
+    const Elf32_Phdr &segment = m_elf->getSegmentAtIndex(m_segmentIndex);
+    return segment.p_paddr + segment.p_filesz;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/HidReportDescriptor.h"
+#include "blfwk/Logging.h"
+#include <string.h>
+#include <vector>
+
+#if defined(LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+#endif // LINUX
+
+using namespace blfwk;
+
+//! Items of a report descriptor, as the prefix byte without its size bits. See the HID
+//! specification, version 1.11, section 6.2.2.
+enum _hid_items
+{
+    kItem_Input = 0x80,
+    kItem_Output = 0x90,
+    kItem_Feature = 0xb0,
+    kItem_ReportSize = 0x74,
+    kItem_ReportId = 0x84,
+    kItem_ReportCount = 0x94,
+    kItem_Push = 0xa4,
+    kItem_Pop = 0xb4,
+    kItem_Long = 0xfe
+};
+
+bool HidReportDescriptor::parse(const uint8_t *data, size_t length)
+{
+    //! Global items that size the reports, saved by Push and restored by Pop.
+    struct globals_t
+    {
+        uint32_t reportSize;
+        uint32_t reportCount;
+        uint8_t reportId;
+    };
+    globals_t globals = { 0, 0, 0 };
+    std::vector<globals_t> stack;
+
+    m_inputBits.clear();
+    m_outputBits.clear();
+
+    size_t i = 0;
+    while (i < length)
+    {
+        uint8_t prefix = data[i];
+        if (prefix == kItem_Long)
+        {
+            // Long items are reserved and carry nothing about the report sizes.
+            if (i + 1 >= length)
+            {
+                break;
+            }
+            i += 3 + data[i + 1];
+            continue;
+        }
+
+        static const size_t kDataSizes[] = { 0, 1, 2, 4 };
+        size_t dataSize = kDataSizes[prefix & 0x3];
+        if (i + 1 + dataSize > length)
+        {
+            break;
+        }
+        uint32_t value = 0;
+        for (size_t byte = 0; byte < dataSize; ++byte)
+        {
+            value |= (uint32_t)data[i + 1 + byte] << (8 * byte);
+        }
+        i += 1 + dataSize;
+
+        switch (prefix & ~0x3)
+        {
+            case kItem_ReportSize:
+                globals.reportSize = value;
+                break;
+            case kItem_ReportCount:
+                globals.reportCount = value;
+                break;
+            case kItem_ReportId:
+                globals.reportId = (uint8_t)value;
+                break;
+            case kItem_Push:
+                stack.push_back(globals);
+                break;
+            case kItem_Pop:
+                if (stack.empty())
+                {
+                    Log::debug("Malformed HID report descriptor: pop without push\n");
+                    m_inputBits.clear();
+                    m_outputBits.clear();
+                    return false;
+                }
+                globals = stack.back();
+                stack.pop_back();
+                break;
+            case kItem_Input:
+                m_inputBits[globals.reportId] += globals.reportSize * globals.reportCount;
+                break;
+            case kItem_Output:
+                m_outputBits[globals.reportId] += globals.reportSize * globals.reportCount;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (i != length)
+    {
+        Log::debug("Malformed HID report descriptor: item at offset %u is truncated\n", (uint32_t)i);
+        m_inputBits.clear();
+        m_outputBits.clear();
+        return false;
+    }
+    return true;
+}
+
+bool HidReportDescriptor::read(const std::string &devicePath)
+{
+#if defined(LINUX)
+    int fd = open(devicePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        Log::debug("Cannot open %s to read its report descriptor: %s\n", devicePath.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct hidraw_report_descriptor descriptor;
+    memset(&descriptor, 0, sizeof(descriptor));
+    int size = 0;
+    bool isRead = (ioctl(fd, HIDIOCGRDESCSIZE, &size) == 0) && (size > 0) && (size <= HID_MAX_DESCRIPTOR_SIZE);
+    if (isRead)
+    {
+        descriptor.size = (uint32_t)size;
+        isRead = (ioctl(fd, HIDIOCGRDESC, &descriptor) == 0);
+    }
+    if (!isRead)
+    {
+        Log::debug("Cannot read the report descriptor of %s: %s\n", devicePath.c_str(), strerror(errno));
+    }
+    close(fd);
+
+    return isRead && parse(descriptor.value, descriptor.size);
+#else
+    return false;
+#endif // LINUX
+}
+
+uint32_t HidReportDescriptor::getMaxReportSize(const report_bits_t &reports)
+{
+    uint32_t maxSize = 0;
+    for (report_bits_t::const_iterator it = reports.begin(); it != reports.end(); ++it)
+    {
+        uint32_t size = getReportSize(reports, it->first);
+        maxSize = (size > maxSize) ? size : maxSize;
+    }
+    return maxSize;
+}
+
+uint32_t HidReportDescriptor::getReportSize(const report_bits_t &reports, uint8_t reportId)
+{
+    report_bits_t::const_iterator it = reports.find(reportId);
+    if (it == reports.end())
+    {
+        return 0;
+    }
+
+    // Numbered reports are sent with their ID in front.
+    return (it->second + 7) / 8 + (reportId ? 1 : 0);
+}
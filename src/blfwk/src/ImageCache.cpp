@@ -0,0 +1,297 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/ImageCache.h"
+#include "blfwk/Logging.h"
+#include "blfwk/Sha256.h"
+#include "blfwk/format_string.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef WIN32
+#include <process.h>
+#define getpid _getpid
+#else // WIN32
+#include <unistd.h>
+#endif // WIN32
+
+using namespace blfwk;
+
+//! Identifies an image cache file.
+static const uint8_t kCacheMagic[4] = { 'B', 'L', 'I', 'C' };
+
+//! Version of the cache file format. Must be changed whenever the format, or the
+//! segments produced by any of the parsers, change.
+static const uint32_t kCacheVersion = 2;
+
+//! Length of a cache key, in characters. The key is a SHA-256 digest in hex.
+static const size_t kCacheKeyLength = Sha256::kDigestSize * 2;
+
+//! Segment table entry flag set for segments stored as a fill byte.
+static const uint32_t kSegmentFlagFill = 1;
+
+//! Header at the start of a cache file.
+struct cache_header_t
+{
+    uint8_t magic[4];          //!< #kCacheMagic.
+    uint32_t version;          //!< #kCacheVersion.
+    char key[kCacheKeyLength]; //!< Key the file was stored under.
+    uint32_t segmentCount;     //!< Number of entries in the segment table.
+    uint32_t reserved;         //!< Keeps the segment table 8-byte aligned.
+};
+
+//! Segment table entry, which immediately follows the header.
+struct cache_segment_t
+{
+    uint32_t address; //!< Address of the first byte.
+    uint32_t length;  //!< Length in bytes.
+    uint32_t flags;   //!< Segment flags.
+    uint32_t fill;    //!< Fill byte, if #kSegmentFlagFill is set.
+    uint64_t offset;  //!< File offset of the data, if #kSegmentFlagFill is not set.
+};
+
+//! \brief Reads all data of \a segment into \a buffer.
+static void readSegment(DataSource::Segment &segment, std::vector<uint8_t> &buffer)
+{
+    buffer.resize(segment.getLength());
+
+    unsigned offset = 0;
+    while (offset < buffer.size())
+    {
+        unsigned count = segment.getData(offset, static_cast<unsigned>(buffer.size()) - offset, &buffer[offset]);
+        if (count == 0)
+        {
+            throw std::runtime_error(format_string("segment at %#x is shorter than its length",
+                                                   segment.getBaseAddress()));
+        }
+        offset += count;
+    }
+}
+
+unsigned CachedDataSource::CachedSegment::getData(unsigned offset, unsigned maxBytes, uint8_t *buffer)
+{
+    if (offset >= m_length)
+    {
+        return 0;
+    }
+
+    unsigned copyBytes = std::min(m_length - offset, maxBytes);
+    if (m_data)
+    {
+        memcpy(buffer, m_data + offset, copyBytes);
+    }
+    else
+    {
+        memset(buffer, m_fill, copyBytes);
+    }
+    return copyBytes;
+}
+
+CachedDataSource::~CachedDataSource()
+{
+    std::vector<CachedSegment *>::iterator it = m_segments.begin();
+    for (; it != m_segments.end(); ++it)
+    {
+        delete *it;
+    }
+}
+
+void CachedDataSource::addSegment(uint32_t address, unsigned length, const uint8_t *data, uint8_t fill)
+{
+    m_segments.push_back(new CachedSegment(*this, address, length, data, fill));
+}
+
+//! The key is the SHA-256 digest of the cache format version, \a options and the file
+//! contents. The cached segments are flashed without looking at the file again, so
+//! the key must not collide for different files. The \a options string must describe
+//! every setting that changes the segments produced from the file, such as the file
+//! type or ELF load mode. Its length is hashed first, so that it cannot run into the
+//! file contents.
+//!
+//! \exception std::runtime_error Thrown if the file cannot be read.
+std::string ImageCache::makeKey(const std::string &path, const std::string &options)
+{
+    MappedFile file(path);
+
+    Sha256 digest;
+    uint64_t optionsLength = options.size();
+    digest.update(&kCacheVersion, sizeof(kCacheVersion));
+    digest.update(&optionsLength, sizeof(optionsLength));
+    digest.update(options.data(), options.size());
+    digest.update(file.getData(), (size_t)file.getSize());
+
+    return digest.finishHex();
+}
+
+std::string ImageCache::getCachePath(const std::string &key) const
+{
+    std::string path = m_directory;
+    if (!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\')
+    {
+        path += '/';
+    }
+    return path + key + ".blic";
+}
+
+//! \retval NULL There is no usable cache file for \a key.
+DataSource *ImageCache::load(const std::string &key)
+{
+    smart_ptr<MappedFile> mapping;
+    try
+    {
+        mapping = new MappedFile(getCachePath(key));
+    }
+    catch (std::runtime_error &)
+    {
+        Log::log(Logger::kDebug2, "image cache miss for %s\n", key.c_str());
+        return NULL;
+    }
+
+    // Validate the header.
+    const uint8_t *base = mapping->getData();
+    if (!mapping->contains(0, sizeof(cache_header_t)))
+    {
+        return NULL;
+    }
+    const cache_header_t *header = reinterpret_cast<const cache_header_t *>(base);
+    if (memcmp(header->magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header->version != kCacheVersion ||
+        key.size() != kCacheKeyLength || memcmp(header->key, key.data(), kCacheKeyLength) != 0)
+    {
+        Log::log(Logger::kDebug2, "ignoring invalid image cache file %s\n", mapping->getPath().c_str());
+        return NULL;
+    }
+    if (!mapping->contains(sizeof(cache_header_t), (uint64_t)header->segmentCount * sizeof(cache_segment_t)))
+    {
+        Log::log(Logger::kDebug2, "ignoring truncated image cache file %s\n", mapping->getPath().c_str());
+        return NULL;
+    }
+
+    // Validate the segment table before handing out any pointers into the mapping.
+    const cache_segment_t *table = reinterpret_cast<const cache_segment_t *>(base + sizeof(cache_header_t));
+    for (uint32_t index = 0; index < header->segmentCount; ++index)
+    {
+        const cache_segment_t &entry = table[index];
+        if (!(entry.flags & kSegmentFlagFill) && !mapping->contains(entry.offset, entry.length))
+        {
+            Log::log(Logger::kDebug2, "ignoring truncated image cache file %s\n", mapping->getPath().c_str());
+            return NULL;
+        }
+    }
+
+    uint32_t segmentCount = header->segmentCount;
+    CachedDataSource *source = new CachedDataSource(mapping);
+    mapping.reset();
+    for (uint32_t index = 0; index < segmentCount; ++index)
+    {
+        const cache_segment_t &entry = table[index];
+        const uint8_t *data = (entry.flags & kSegmentFlagFill) ? NULL : base + entry.offset;
+        source->addSegment(entry.address, entry.length, data, static_cast<uint8_t>(entry.fill));
+    }
+
+    Log::log(Logger::kDebug2, "image cache hit for %s, %u segments\n", key.c_str(), segmentCount);
+    return source;
+}
+
+//! The file is written under a temporary name unique to this process and then
+//! renamed, so other processes never see a partially written cache file. The segment data is read twice, once to
+//! find fill segments and lay out the file, and once to write it.
+//!
+//! \exception std::runtime_error Thrown if the cache file cannot be written.
+void ImageCache::store(const std::string &key, DataSource &source)
+{
+    if (key.size() != kCacheKeyLength)
+    {
+        throw std::runtime_error(format_string("invalid image cache key: %s", key.c_str()));
+    }
+
+    // Build the segment table.
+    unsigned segmentCount = source.getSegmentCount();
+    std::vector<cache_segment_t> table(segmentCount);
+    std::vector<uint8_t> buffer;
+    uint64_t offset = sizeof(cache_header_t) + segmentCount * sizeof(cache_segment_t);
+    for (unsigned index = 0; index < segmentCount; ++index)
+    {
+        DataSource::Segment *segment = source.getSegmentAt(index);
+        readSegment(*segment, buffer);
+
+        cache_segment_t &entry = table[index];
+        memset(&entry, 0, sizeof(entry));
+        entry.address = segment->getBaseAddress();
+        entry.length = static_cast<uint32_t>(buffer.size());
+
+        if (buffer.empty() || std::count(buffer.begin(), buffer.end(), buffer[0]) == (ptrdiff_t)buffer.size())
+        {
+            entry.flags = kSegmentFlagFill;
+            entry.fill = buffer.empty() ? 0 : buffer[0];
+        }
+        else
+        {
+            entry.offset = offset;
+            offset += (buffer.size() + 7) & ~(uint64_t)7;
+        }
+    }
+
+    cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    memcpy(header.key, key.data(), kCacheKeyLength);
+    header.segmentCount = segmentCount;
+
+    std::string path = getCachePath(key);
+    std::string tempPath = format_string("%s.%d.tmp", path.c_str(), (int)getpid());
+    {
+        std::ofstream stream(tempPath.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (!stream.is_open())
+        {
+            throw std::runtime_error(format_string("failed to create image cache file: %s", tempPath.c_str()));
+        }
+
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (segmentCount)
+        {
+            stream.write(reinterpret_cast<const char *>(&table[0]), segmentCount * sizeof(cache_segment_t));
+        }
+
+        // Write the data of every non-fill segment, padded to 8 bytes.
+        static const char kPadding[8] = { 0 };
+        for (unsigned index = 0; index < segmentCount; ++index)
+        {
+            if (table[index].flags & kSegmentFlagFill)
+            {
+                continue;
+            }
+
+            readSegment(*source.getSegmentAt(index), buffer);
+            stream.write(reinterpret_cast<const char *>(&buffer[0]), buffer.size());
+            stream.write(kPadding, ((buffer.size() + 7) & ~(size_t)7) - buffer.size());
+        }
+
+        stream.close();
+        if (stream.fail())
+        {
+            remove(tempPath.c_str());
+            throw std::runtime_error(format_string("failed to write image cache file: %s", tempPath.c_str()));
+        }
+    }
+
+    // Windows does not rename over an existing file. Elsewhere rename() replaces it
+    // atomically, so readers always find either the old or the new file.
+#ifdef WIN32
+    remove(path.c_str());
+#endif // WIN32
+    if (rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        remove(tempPath.c_str());
+        throw std::runtime_error(format_string("failed to rename image cache file: %s", path.c_str()));
+    }
+
+    Log::log(Logger::kDebug2, "stored %u segments in image cache file %s\n", segmentCount, path.c_str());
+}
@@ -0,0 +1,511 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/InputStream.h"
+#include "blfwk/Logging.h"
+#include "blfwk/Realtime.h"
+#include "blfwk/format_string.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#ifdef WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif // WIN32
+
+#if BL_HAVE_ZLIB
+#include <zlib.h>
+#endif // BL_HAVE_ZLIB
+
+#if BL_HAVE_ZSTD
+#include <zstd.h>
+#endif // BL_HAVE_ZSTD
+
+using namespace blfwk;
+
+const char *const InputStream::kStdinPath = "-";
+
+//! Magic number at the start of a gzip file.
+static const uint8_t kGzipMagic[] = { 0x1f, 0x8b };
+
+//! Magic number at the start of a zstd frame.
+static const uint8_t kZstdMagic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+//! Size of the buffer for compressed data read by the decompressing streams.
+static const size_t kCompressedBufferSize = 64 * 1024;
+
+//! Longest time a stream waits for its read ahead thread to stop, in milliseconds.
+static const int kStopTimeoutMs = 100;
+
+//! \brief Returns true if the \a length bytes at \a data start with \a magic.
+template <size_t N>
+static bool hasMagic(const uint8_t *data, size_t length, const uint8_t (&magic)[N])
+{
+    return length >= N && memcmp(data, magic, N) == 0;
+}
+
+/*!
+ * \brief Input stream reading a file or the standard input.
+ */
+class FileInputStream : public InputStream
+{
+public:
+    //! \brief Constructor. Opens \a path, or uses the standard input for InputStream::kStdinPath.
+    FileInputStream(const std::string &path)
+        : m_path(path)
+        , m_file(NULL)
+    {
+        if (path == kStdinPath)
+        {
+#ifdef WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+#endif // WIN32
+            m_file = stdin;
+            m_path = "<stdin>";
+        }
+        else
+        {
+            m_file = fopen(path.c_str(), "rb");
+            if (!m_file)
+            {
+                throw std::runtime_error(format_string("cannot open input file '%s'", path.c_str()));
+            }
+        }
+    }
+
+    virtual ~FileInputStream()
+    {
+        if (m_file && m_file != stdin)
+        {
+            fclose(m_file);
+        }
+    }
+
+protected:
+    virtual size_t readData(uint8_t *buffer, size_t size)
+    {
+        size_t count = fread(buffer, 1, size, m_file);
+        if (count == 0 && ferror(m_file))
+        {
+            throw std::runtime_error(format_string("error reading '%s': %s", m_path.c_str(), strerror(errno)));
+        }
+        return count;
+    }
+
+protected:
+    std::string m_path; //!< Path of the file, for error messages.
+    FILE *m_file;       //!< The open file.
+};
+
+#if BL_HAVE_ZLIB
+/*!
+ * \brief Input stream decompressing gzip data with zlib.
+ *
+ * Concatenated gzip members, as produced by appending gzip files or by parallel
+ * compressors, are decompressed one after the other.
+ */
+class GzipInputStream : public InputStream
+{
+public:
+    //! \brief Constructor. Takes ownership of \a input.
+    GzipInputStream(InputStream *input)
+        : m_input(input)
+        , m_buffer(kCompressedBufferSize)
+        , m_isEnd(false)
+        , m_hasPendingOutput(false)
+    {
+        memset(&m_zstream, 0, sizeof(m_zstream));
+        // Adding 32 to the window bits accepts both the gzip and zlib headers.
+        if (inflateInit2(&m_zstream, 15 + 32) != Z_OK)
+        {
+            delete m_input;
+            throw std::runtime_error("cannot initialize gzip decompression");
+        }
+    }
+
+    virtual ~GzipInputStream()
+    {
+        inflateEnd(&m_zstream);
+        delete m_input;
+    }
+
+protected:
+    virtual size_t readData(uint8_t *buffer, size_t size)
+    {
+        size = std::min<size_t>(size, 0x40000000);
+        m_zstream.next_out = buffer;
+        m_zstream.avail_out = static_cast<uInt>(size);
+        while (!m_isEnd && m_zstream.avail_out == size)
+        {
+            if (m_zstream.avail_in == 0 && !m_hasPendingOutput)
+            {
+                m_zstream.next_in = &m_buffer[0];
+                m_zstream.avail_in = static_cast<uInt>(m_input->read(&m_buffer[0], m_buffer.size()));
+                if (m_zstream.avail_in == 0)
+                {
+                    throw std::runtime_error("unexpected end of gzip data");
+                }
+            }
+
+            int status = inflate(&m_zstream, Z_NO_FLUSH);
+            m_hasPendingOutput = (m_zstream.avail_out == 0);
+            if (status == Z_STREAM_END)
+            {
+                // Look for another gzip member.
+                uint8_t next;
+                if (m_zstream.avail_in == 0 && m_input->peek(&next, 1) == 0)
+                {
+                    m_isEnd = true;
+                }
+                else
+                {
+                    inflateReset(&m_zstream);
+                }
+            }
+            else if (status != Z_OK && status != Z_BUF_ERROR)
+            {
+                throw std::runtime_error(
+                    format_string("invalid gzip data: %s", m_zstream.msg ? m_zstream.msg : "unknown error"));
+            }
+        }
+        return size - m_zstream.avail_out;
+    }
+
+protected:
+    InputStream *m_input;          //!< Compressed data.
+    std::vector<uint8_t> m_buffer; //!< Compressed data read from #m_input.
+    z_stream m_zstream;            //!< zlib decompression state.
+    bool m_isEnd;                  //!< Whether the last gzip member has ended.
+    bool m_hasPendingOutput;       //!< Whether the last call filled the buffer, so more output may be pending.
+};
+#endif // BL_HAVE_ZLIB
+
+#if BL_HAVE_ZSTD
+/*!
+ * \brief Input stream decompressing zstd data.
+ */
+class ZstdInputStream : public InputStream
+{
+public:
+    //! \brief Constructor. Takes ownership of \a input.
+    ZstdInputStream(InputStream *input)
+        : m_input(input)
+        , m_buffer(ZSTD_DStreamInSize())
+        , m_dstream(ZSTD_createDStream())
+        , m_isFrameEnd(true)
+        , m_hasPendingOutput(false)
+    {
+        m_inBuffer.src = &m_buffer[0];
+        m_inBuffer.size = 0;
+        m_inBuffer.pos = 0;
+        if (!m_dstream || ZSTD_isError(ZSTD_initDStream(m_dstream)))
+        {
+            ZSTD_freeDStream(m_dstream);
+            delete m_input;
+            throw std::runtime_error("cannot initialize zstd decompression");
+        }
+    }
+
+    virtual ~ZstdInputStream()
+    {
+        ZSTD_freeDStream(m_dstream);
+        delete m_input;
+    }
+
+protected:
+    virtual size_t readData(uint8_t *buffer, size_t size)
+    {
+        ZSTD_outBuffer outBuffer = { buffer, size, 0 };
+        while (outBuffer.pos == 0)
+        {
+            if (m_inBuffer.pos == m_inBuffer.size && !m_hasPendingOutput)
+            {
+                m_inBuffer.size = m_input->read(&m_buffer[0], m_buffer.size());
+                m_inBuffer.pos = 0;
+                if (m_inBuffer.size == 0)
+                {
+                    if (!m_isFrameEnd)
+                    {
+                        throw std::runtime_error("unexpected end of zstd data");
+                    }
+                    return 0;
+                }
+            }
+
+            size_t status = ZSTD_decompressStream(m_dstream, &outBuffer, &m_inBuffer);
+            if (ZSTD_isError(status))
+            {
+                throw std::runtime_error(format_string("invalid zstd data: %s", ZSTD_getErrorName(status)));
+            }
+            m_isFrameEnd = (status == 0);
+            m_hasPendingOutput = (outBuffer.pos == outBuffer.size);
+        }
+        return outBuffer.pos;
+    }
+
+protected:
+    InputStream *m_input;          //!< Compressed data.
+    std::vector<uint8_t> m_buffer; //!< Compressed data read from #m_input.
+    ZSTD_DStream *m_dstream;       //!< zstd decompression state.
+    ZSTD_inBuffer m_inBuffer;      //!< Unconsumed part of #m_buffer.
+    bool m_isFrameEnd;             //!< Whether the last frame decompressed so far is complete.
+    bool m_hasPendingOutput;       //!< Whether the last call filled the buffer, so more output may be pending.
+};
+#endif // BL_HAVE_ZSTD
+
+//! The path InputStream::kStdinPath selects the standard input. Compressed data is
+//! recognized by its magic number, not by the file name extension, and is
+//! decompressed on a helper thread.
+//!
+//! \exception std::runtime_error Thrown if the file cannot be opened, or is
+//!     compressed with a format that is not supported by this build.
+InputStream *InputStream::open(const std::string &path)
+{
+    InputStream *input = new FileInputStream(path);
+
+    uint8_t magic[sizeof(kZstdMagic)];
+    size_t length;
+    try
+    {
+        length = input->peek(magic, sizeof(magic));
+    }
+    catch (...)
+    {
+        delete input;
+        throw;
+    }
+
+    if (hasMagic(magic, length, kGzipMagic))
+    {
+#if BL_HAVE_ZLIB
+        Log::log(Logger::kDebug2, "decompressing gzip data from %s\n", path.c_str());
+        return new PrefetchInputStream(new GzipInputStream(input));
+#else  // BL_HAVE_ZLIB
+        delete input;
+        throw std::runtime_error(format_string("%s: gzip input is not supported by this build", path.c_str()));
+#endif // BL_HAVE_ZLIB
+    }
+    else if (hasMagic(magic, length, kZstdMagic))
+    {
+#if BL_HAVE_ZSTD
+        Log::log(Logger::kDebug2, "decompressing zstd data from %s\n", path.c_str());
+        return new PrefetchInputStream(new ZstdInputStream(input));
+#else  // BL_HAVE_ZSTD
+        delete input;
+        throw std::runtime_error(format_string("%s: zstd input is not supported by this build", path.c_str()));
+#endif // BL_HAVE_ZSTD
+    }
+
+    return input;
+}
+
+//! These are the standard input, anything that is not a regular file such as a
+//! named pipe, and compressed files. Paths that do not exist return false, so
+//! that the caller reports the error the usual way.
+bool InputStream::isStreamingPath(const std::string &path)
+{
+    if (path == kStdinPath)
+    {
+        return true;
+    }
+
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+    {
+        return false;
+    }
+    if ((status.st_mode & S_IFMT) != S_IFREG)
+    {
+        return true;
+    }
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    uint8_t magic[sizeof(kZstdMagic)];
+    size_t length = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    return hasMagic(magic, length, kGzipMagic) || hasMagic(magic, length, kZstdMagic);
+}
+
+size_t InputStream::read(uint8_t *buffer, size_t size)
+{
+    if (m_peeked.empty())
+    {
+        return size ? readData(buffer, size) : 0;
+    }
+
+    size_t count = std::min(size, m_peeked.size());
+    memcpy(buffer, &m_peeked[0], count);
+    m_peeked.erase(m_peeked.begin(), m_peeked.begin() + count);
+    return count;
+}
+
+size_t InputStream::peek(uint8_t *buffer, size_t size)
+{
+    while (m_peeked.size() < size)
+    {
+        size_t used = m_peeked.size();
+        m_peeked.resize(size);
+        size_t count = readData(&m_peeked[used], size - used);
+        m_peeked.resize(used + count);
+        if (count == 0)
+        {
+            break;
+        }
+    }
+
+    size_t count = std::min(size, m_peeked.size());
+    if (count)
+    {
+        memcpy(buffer, &m_peeked[0], count);
+    }
+    return count;
+}
+
+PrefetchInputStream::SharedState::SharedState(InputStream *input, size_t blockSize, unsigned queueDepth)
+    : m_input(input)
+    , m_blockSize(blockSize)
+    , m_queueDepth(queueDepth)
+    , m_isFinished(false)
+    , m_isCancelled(false)
+{
+}
+
+PrefetchInputStream::SharedState::~SharedState()
+{
+    delete m_input;
+}
+
+PrefetchInputStream::PrefetchInputStream(InputStream *input, size_t blockSize, unsigned queueDepth)
+    : InputStream()
+    , m_state(std::make_shared<SharedState>(input, blockSize, queueDepth))
+    , m_block()
+    , m_blockOffset(0)
+{
+    m_thread = std::thread(&PrefetchInputStream::runReader, m_state);
+}
+
+//! Stops the helper thread. If the thread is blocked reading the inner stream, for
+//! example waiting for more data on the standard input, it is detached instead of
+//! waited for. It stops once that read returns, and the inner stream is deleted
+//! with the last reference to the shared state.
+PrefetchInputStream::~PrefetchInputStream()
+{
+    bool isFinished;
+    {
+        std::lock_guard<std::mutex> lock(m_state->m_mutex);
+        m_state->m_isCancelled = true;
+        isFinished = m_state->m_isFinished;
+    }
+    m_state->m_condition.notify_all();
+
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    // A thread waiting for room in the queue wakes up and stops at once, only one
+    // that reads may block.
+    std::unique_lock<std::mutex> lock(m_state->m_mutex);
+    if (isFinished || m_state->m_condition.wait_for(lock, std::chrono::milliseconds(kStopTimeoutMs),
+                                                    [this] { return m_state->m_isFinished; }))
+    {
+        lock.unlock();
+        m_thread.join();
+    }
+    else
+    {
+        Log::log(Logger::kDebug2, "input read ahead thread still reading, leaving it\n");
+        m_thread.detach();
+    }
+}
+
+void PrefetchInputStream::runReader(std::shared_ptr<SharedState> state)
+{
+    Realtime::leave();
+
+    std::exception_ptr error;
+
+    try
+    {
+        for (;;)
+        {
+            std::vector<uint8_t> block(state->m_blockSize);
+            size_t used = 0;
+            size_t count;
+            do
+            {
+                count = state->m_input->read(&block[used], block.size() - used);
+                used += count;
+            } while (count && used < block.size());
+            block.resize(used);
+
+            std::unique_lock<std::mutex> lock(state->m_mutex);
+            state->m_condition.wait(lock, [&state] {
+                return state->m_isCancelled || state->m_queue.size() < state->m_queueDepth;
+            });
+            if (state->m_isCancelled || block.empty())
+            {
+                break;
+            }
+            state->m_queue.push_back(std::vector<uint8_t>());
+            state->m_queue.back().swap(block);
+            lock.unlock();
+            state->m_condition.notify_all();
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->m_mutex);
+        state->m_error = error;
+        state->m_isFinished = true;
+    }
+    state->m_condition.notify_all();
+}
+
+//! \exception Any exception thrown by the inner stream is rethrown here, after all
+//!     data read before the error has been returned.
+size_t PrefetchInputStream::readData(uint8_t *buffer, size_t size)
+{
+    if (m_blockOffset == m_block.size())
+    {
+        std::unique_lock<std::mutex> lock(m_state->m_mutex);
+        m_state->m_condition.wait(lock, [this] { return m_state->m_isFinished || !m_state->m_queue.empty(); });
+        if (m_state->m_queue.empty())
+        {
+            if (m_state->m_error)
+            {
+                std::rethrow_exception(m_state->m_error);
+            }
+            return 0;
+        }
+
+        m_block.swap(m_state->m_queue.front());
+        m_state->m_queue.pop_front();
+        m_blockOffset = 0;
+        lock.unlock();
+        m_state->m_condition.notify_all();
+    }
+
+    size_t count = std::min(size, m_block.size() - m_blockOffset);
+    memcpy(buffer, &m_block[m_blockOffset], count);
+    m_blockOffset += count;
+    return count;
+}
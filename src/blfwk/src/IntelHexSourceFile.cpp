@@ -9,7 +9,11 @@
 #include <string.h>
 #include "blfwk/smart_ptr.h"
 #include "blfwk/IntelHexSourceFile.h"
+#include "blfwk/ChunkedTextParser.h"
+#include "blfwk/InputStream.h"
 #include "blfwk/Logging.h"
+#include "blfwk/StreamingDataSource.h"
+#include <memory>
 
 enum
 {
@@ -21,11 +25,45 @@ enum
 
 using namespace blfwk;
 
+//! Returns the base address set by a type 02 or 04 record.
+static uint32_t getExtendedAddress(const StIntelHexFile::IntelHex &theRecord)
+{
+    if (theRecord.m_dataCount < 2)
+    {
+        throw StIntelHexParseException("invalid extended address record");
+    }
+
+    // extended address stored at data field.
+    uint32_t baseAddress = (theRecord.m_data[0] << 8) | theRecord.m_data[1];
+    if (theRecord.m_type == INTELHEX_RECORD_EXTENDED_SEGMENT_ADDRESS)
+    {
+        baseAddress <<= 4; // Extended Segment Address Record, left shift 4 bits.
+    }
+    else
+    {
+        baseAddress <<= 16; // Extended Linear Address Record, left shitf 16 bits.
+    }
+    return baseAddress;
+}
+
+//! Returns the entry point address held by a type 03 or 05 record.
+static uint32_t getEntryAddress(const StIntelHexFile::IntelHex &theRecord)
+{
+    if (theRecord.m_dataCount < 4)
+    {
+        throw StIntelHexParseException("invalid start address record");
+    }
+
+    return (theRecord.m_data[0] << 24) | (theRecord.m_data[1] << 16) | (theRecord.m_data[2] << 8) |
+           (theRecord.m_data[3]);
+}
+
 IntelHexSourceFile::IntelHexSourceFile(const std::string &path)
     : SourceFile(path, kIntelHexSourceFile)
     , m_file(NULL)
     , m_image(0)
     , m_hasEntryRecord(false)
+    , m_entryPointAddress(0)
 {
     memset(&m_entryRecord, 0, sizeof(m_entryRecord));
 }
@@ -40,6 +78,24 @@ void IntelHexSourceFile::open()
 {
     SourceFile::open();
 
+    // Parse a memory mapping of the file in parallel if possible.
+    smart_ptr<MappedFile> mapping;
+    try
+    {
+        mapping = new MappedFile(m_path);
+    }
+    catch (std::runtime_error &e)
+    {
+        Log::log(Logger::kDebug2, "not using memory mapping for %s: %s\n", m_path.c_str(), e.what());
+    }
+
+    if (mapping && mapping->getSize())
+    {
+        m_image = new StExecutableImage();
+        buildMemoryImage(*mapping);
+        return;
+    }
+
     // create file parser and examine file
     m_file = new StIntelHexFile(*m_stream);
     m_file->parse();
@@ -72,6 +128,91 @@ DataSource *IntelHexSourceFile::createDataSource()
     return new MemoryImageDataSource(m_image);
 }
 
+//! The file is memory mapped and parsed sequentially on the data source's parser
+//! thread. Data records are passed on in file order, without building a memory image,
+//! until the end of file record. Entry point records are ignored.
+//!
+//! \retval NULL The file could not be mapped.
+StreamingDataSource *IntelHexSourceFile::createStreamingDataSource()
+{
+    std::shared_ptr<MappedFile> mapping;
+    try
+    {
+        mapping = std::make_shared<MappedFile>(m_path);
+    }
+    catch (std::runtime_error &e)
+    {
+        Log::log(Logger::kDebug2, "cannot stream %s: %s\n", m_path.c_str(), e.what());
+        return NULL;
+    }
+
+    StreamingDataSource *source = new StreamingDataSource();
+    source->start([mapping](StreamingDataSource &source) {
+        ChunkedTextParser::Chunk chunk;
+        chunk.m_begin = reinterpret_cast<const char *>(mapping->getData());
+        chunk.m_end = chunk.m_begin + mapping->getSize();
+        uint32_t baseAddress = 0;
+
+        ChunkedTextParser::forEachLine(chunk, [&](const char *line, unsigned length) -> bool {
+            return addRecordData(source, line, length, baseAddress);
+        });
+    });
+
+    return source;
+}
+
+//! The records are parsed on the thread of the returned data source. Takes
+//! ownership of \a input. The caller owns the returned object.
+StreamingDataSource *IntelHexSourceFile::createStreamingDataSource(InputStream *input)
+{
+    std::shared_ptr<InputStream> stream(input);
+
+    StreamingDataSource *source = new StreamingDataSource();
+    source->start([stream](StreamingDataSource &source) {
+        uint32_t baseAddress = 0;
+
+        stream->forEachLine([&](const char *line, unsigned length) -> bool {
+            return addRecordData(source, line, length, baseAddress);
+        });
+    });
+
+    return source;
+}
+
+//! Data records are added at \a baseAddress plus their address. Extended address
+//! records update \a baseAddress.
+//!
+//! \retval true Parsing continues with the next record.
+//! \retval false The record is the end of file record.
+bool IntelHexSourceFile::addRecordData(StreamingDataSource &source,
+                                       const char *line,
+                                       unsigned length,
+                                       uint32_t &baseAddress)
+{
+    StIntelHexFile::IntelHex theRecord;
+    uint8_t data[INTELHEX_MAX_DATA_LENGTH];
+    StIntelHexFile::parseRecord(line, length, theRecord, data);
+
+    switch (theRecord.m_type)
+    {
+        case INTELHEX_RECORD_DATA:
+            if (theRecord.m_dataCount)
+            {
+                source.addData(baseAddress + theRecord.m_address, data, theRecord.m_dataCount);
+            }
+            break;
+
+        case INTELHEX_RECORD_EXTENDED_SEGMENT_ADDRESS:
+        case INTELHEX_RECORD_EXTENDED_LINEAR_ADDRESS:
+            baseAddress = getExtendedAddress(theRecord);
+            break;
+
+        case INTELHEX_RECORD_END_OF_FILE:
+            return false;
+    }
+    return true;
+}
+
 //! \retval true The file has an 03 or 05 record.
 //! \retval false No entry point is available.
 bool IntelHexSourceFile::hasEntryPoint()
@@ -88,10 +229,8 @@ uint32_t IntelHexSourceFile::getEntryPointAddress()
     if (m_hasEntryRecord)
     {
         // the address in the record is the entry point
-        uint32_t address = (m_entryRecord.m_data[0] << 24) | (m_entryRecord.m_data[1] << 16) |
-                           (m_entryRecord.m_data[2] << 8) | (m_entryRecord.m_data[3]);
-        Log::log(Logger::kDebug2, "entry point address is 0x%08x\n", address);
-        return address;
+        Log::log(Logger::kDebug2, "entry point address is 0x%08x\n", m_entryPointAddress);
+        return m_entryPointAddress;
     }
 
     return 0;
@@ -121,6 +260,7 @@ void IntelHexSourceFile::buildMemoryImage()
     // Clear the entry point.
     m_hasEntryRecord = false;
     memset(&m_entryRecord, 0, sizeof(m_entryRecord));
+    m_entryPointAddress = 0;
 
     // Allocate buffer to hold data before adding it to the executable image.
     // Contiguous records are added to this buffer. When overflowed or when a
@@ -183,24 +323,18 @@ void IntelHexSourceFile::buildMemoryImage()
                 dataLength = 0;
             }
 
-            // extended address stored at data field.
-            baseAddress = (theRecord.m_data[0] << 8) | theRecord.m_data[1];
-            if (theRecord.m_type == INTELHEX_RECORD_EXTENDED_SEGMENT_ADDRESS)
-            {
-                baseAddress <<= 4; // Extended Segment Address Record, left shift 4 bits.
-            }
-            else
-            {
-                baseAddress <<= 16; // Extended Linear Address Record, left shitf 16 bits.
-            }
+            baseAddress = getExtendedAddress(theRecord);
         }
         // handle 03, 05 record
         else if (isEntryRecord)
         {
             if (!m_hasEntryRecord)
             {
-                // save off the entry point record so we don't have to scan again
+                // save off the entry point record so we don't have to scan again. the record
+                // data is owned by the parser, which is deleted once the image is built.
                 memcpy(&m_entryRecord, &theRecord, sizeof(m_entryRecord));
+                m_entryRecord.m_data = NULL;
+                m_entryPointAddress = getEntryAddress(theRecord);
                 m_hasEntryRecord = true;
             }
             else
@@ -223,3 +357,161 @@ void IntelHexSourceFile::buildMemoryImage()
         m_image->addTextRegion(startAddress + baseAddress, buffer, dataLength);
     }
 }
+
+//! Produces the same memory image as buildMemoryImage(), without building a list
+//! of records first. The file is split into newline-aligned chunks that are parsed
+//! concurrently.
+//!
+//! Data record addresses depend on the last type 02 or 04 record before them, which
+//! may be in an earlier chunk. So a first, quick pass over all chunks finds the last
+//! extended address record of each chunk and whether the chunk holds the end of file
+//! record. The base address in effect at the start of each chunk is then resolved in
+//! order, and the second pass parses the chunks up to the end of file record with
+//! their known starting base address.
+//!
+//! \pre The #m_image member variable must have been instantiated.
+void IntelHexSourceFile::buildMemoryImage(const MappedFile &mapping)
+{
+    assert(m_image);
+
+    //! Results of parsing one chunk of the file.
+    struct ChunkResult
+    {
+        bool m_hasBaseAddress;                  //!< Whether the chunk has a type 02 or 04 record.
+        uint32_t m_lastBaseAddress;             //!< Base address set by the last type 02 or 04 record.
+        bool m_hasEndRecord;                    //!< Whether the chunk has the end of file record.
+        uint32_t m_startBaseAddress;            //!< Base address in effect at the start of the chunk.
+        ChunkedTextParser::run_vector_t m_runs; //!< Data collected from the chunk.
+        unsigned m_entryRecordCount;            //!< Number of type 03 or 05 records.
+        uint32_t m_entryPointAddress;           //!< Address from the first type 03 or 05 record.
+    };
+
+    ChunkedTextParser::chunk_vector_t chunks = ChunkedTextParser::split(mapping.getData(), mapping.getSize());
+    std::vector<ChunkResult> results(chunks.size());
+
+    Log::log(Logger::kDebug2, "parsing %s in %u chunks\n", m_path.c_str(), (unsigned)chunks.size());
+
+    // First pass, find the extended address and end of file records of each chunk.
+    ChunkedTextParser::run(chunks.size(), [&chunks, &results](size_t index) {
+        ChunkResult &result = results[index];
+        result.m_hasBaseAddress = false;
+        result.m_lastBaseAddress = 0;
+        result.m_hasEndRecord = false;
+
+        ChunkedTextParser::forEachLine(chunks[index], [&result](const char *line, unsigned length) -> bool {
+            if (length < INTELHEX_MIN_LENGTH || line[INTELHEX_TYPE_START_CHAR_INDEX] != '0')
+            {
+                // not a record type of interest, errors are reported by the second pass
+                return true;
+            }
+
+            char typeChar = line[INTELHEX_TYPE_START_CHAR_INDEX + 1];
+            if (typeChar == '2' || typeChar == '4')
+            {
+                StIntelHexFile::IntelHex theRecord;
+                uint8_t data[INTELHEX_MAX_DATA_LENGTH];
+                StIntelHexFile::parseRecord(line, length, theRecord, data);
+                result.m_lastBaseAddress = getExtendedAddress(theRecord);
+                result.m_hasBaseAddress = true;
+            }
+            else if (typeChar == '1')
+            {
+                result.m_hasEndRecord = true;
+                return false;
+            }
+            return true;
+        });
+    });
+
+    // Resolve the base address at the start of each chunk, and drop chunks after the end of file record.
+    uint32_t baseAddress = 0;
+    size_t chunkCount = 0;
+    while (chunkCount < results.size())
+    {
+        ChunkResult &result = results[chunkCount++];
+        result.m_startBaseAddress = baseAddress;
+        if (result.m_hasEndRecord)
+        {
+            break;
+        }
+        if (result.m_hasBaseAddress)
+        {
+            baseAddress = result.m_lastBaseAddress;
+        }
+    }
+
+    // Second pass, parse all records of each chunk.
+    ChunkedTextParser::run(chunkCount, [&chunks, &results](size_t index) {
+        ChunkResult &result = results[index];
+        uint32_t baseAddress = result.m_startBaseAddress;
+        result.m_entryRecordCount = 0;
+        result.m_entryPointAddress = 0;
+
+        ChunkedTextParser::forEachLine(chunks[index], [&](const char *line, unsigned length) -> bool {
+            StIntelHexFile::IntelHex theRecord;
+            uint8_t data[INTELHEX_MAX_DATA_LENGTH];
+            StIntelHexFile::parseRecord(line, length, theRecord, data);
+
+            switch (theRecord.m_type)
+            {
+                // handle 00 data record
+                case INTELHEX_RECORD_DATA:
+                    if (theRecord.m_dataCount)
+                    {
+                        ChunkedTextParser::appendData(result.m_runs, baseAddress + theRecord.m_address, data,
+                                                      theRecord.m_dataCount);
+                    }
+                    break;
+
+                // handle 02, 04 record
+                case INTELHEX_RECORD_EXTENDED_SEGMENT_ADDRESS:
+                case INTELHEX_RECORD_EXTENDED_LINEAR_ADDRESS:
+                    baseAddress = getExtendedAddress(theRecord);
+                    break;
+
+                // handle 03, 05 record
+                case INTELHEX_RECORD_START_SEGMENT_ADDRESS:
+                case INTELHEX_RECORD_START_LINEAR_ADDRESS:
+                    if (result.m_entryRecordCount++ == 0)
+                    {
+                        result.m_entryPointAddress = getEntryAddress(theRecord);
+                    }
+                    break;
+
+                // handle 01 record, the records after it are not handled
+                case INTELHEX_RECORD_END_OF_FILE:
+                    return false;
+            }
+            return true;
+        });
+    });
+
+    // Clear the entry point.
+    m_hasEntryRecord = false;
+    memset(&m_entryRecord, 0, sizeof(m_entryRecord));
+    m_entryPointAddress = 0;
+
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        ChunkResult &result = results[i];
+        for (size_t j = 0; j < result.m_runs.size(); ++j)
+        {
+            ChunkedTextParser::DataRun &run = result.m_runs[j];
+            m_image->addTextRegion(run.m_address, &run.m_data[0], (unsigned)run.m_data.size());
+
+            // release the run as soon as the image has its own copy
+            std::vector<uint8_t>().swap(run.m_data);
+        }
+
+        if (result.m_entryRecordCount)
+        {
+            if (m_hasEntryRecord || result.m_entryRecordCount > 1)
+            {
+                // throw an exception when detecting a second entry record
+                throw StIntelHexParseException("multiple entry record detected");
+            }
+            m_entryPointAddress = result.m_entryPointAddress;
+            m_hasEntryRecord = true;
+        }
+    }
+}
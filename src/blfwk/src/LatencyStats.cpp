@@ -0,0 +1,66 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/LatencyStats.h"
+#include <algorithm>
+
+using namespace blfwk;
+
+//! Number of histogram buckets. Bucket n holds samples of 2^(n-1) to 2^n - 1 us.
+static const int kBucketCount = 33;
+
+//! Width of the longest histogram bar, in characters.
+static const int kMaxBarWidth = 40;
+
+//! Returns the sample at \a fraction of the sorted \a samples.
+static uint32_t get_percentile(const std::vector<uint32_t> &samples, double fraction)
+{
+    size_t index = (size_t)(fraction * (samples.size() - 1) + 0.5);
+    return samples[std::min(index, samples.size() - 1)];
+}
+
+void LatencyStats::log(Logger::log_level_t level, const std::string &name) const
+{
+    if (m_samples.empty())
+    {
+        Log::log(level, "%s: no samples\n", name.c_str());
+        return;
+    }
+
+    std::vector<uint32_t> sorted(m_samples);
+    std::sort(sorted.begin(), sorted.end());
+    uint64_t sum = 0;
+    uint64_t buckets[kBucketCount] = { 0 };
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        sum += sorted[i];
+        int bucket = 0;
+        for (uint32_t value = sorted[i]; value; value >>= 1)
+        {
+            ++bucket;
+        }
+        ++buckets[bucket];
+    }
+
+    Log::log(level, "%s: %u samples, min %u us, mean %u us, p50 %u us, p99 %u us, p99.9 %u us, max %u us\n",
+             name.c_str(), (unsigned)sorted.size(), sorted.front(), (unsigned)(sum / sorted.size()),
+             get_percentile(sorted, 0.5), get_percentile(sorted, 0.99), get_percentile(sorted, 0.999), sorted.back());
+
+    uint64_t largest = *std::max_element(buckets, buckets + kBucketCount);
+    for (int bucket = 0; bucket < kBucketCount; ++bucket)
+    {
+        if (!buckets[bucket])
+        {
+            continue;
+        }
+        uint32_t low = bucket ? (1u << (bucket - 1)) : 0;
+        uint32_t high = bucket ? (uint32_t)((1ull << bucket) - 1) : 0;
+        int width = (int)((buckets[bucket] * kMaxBarWidth + largest - 1) / largest);
+        Log::log(level, "  %10u - %10u us %8u %s\n", low, high, (unsigned)buckets[bucket],
+                 std::string(width, '#').c_str());
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/MappedFile.h"
+#include "blfwk/format_string.h"
+#include <stdexcept>
+
+#ifdef WIN32
+#include <windows.h>
+#else // WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // WIN32
+
+using namespace blfwk;
+
+//! An empty file is not mapped at all. In that case getData() returns NULL and
+//! getSize() returns 0.
+//!
+//! \exception std::runtime_error Thrown if the file cannot be opened or mapped.
+MappedFile::MappedFile(const std::string &path)
+    : m_path(path)
+    , m_data(NULL)
+    , m_size(0)
+#if defined(WIN32)
+    , m_fileHandle(INVALID_HANDLE_VALUE)
+    , m_mappingHandle(NULL)
+#endif
+{
+#if defined(WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error(format_string("failed to open file: %s", path.c_str()));
+    }
+    m_fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw std::runtime_error(format_string("failed to get size of file: %s", path.c_str()));
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    if (m_size == 0)
+    {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        throw std::runtime_error(format_string("failed to map file: %s", path.c_str()));
+    }
+    m_mappingHandle = mapping;
+
+    m_data = reinterpret_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error(format_string("failed to map file: %s", path.c_str()));
+    }
+#else  // WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error(format_string("failed to open file: %s", path.c_str()));
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        ::close(fd);
+        throw std::runtime_error(format_string("cannot map file: %s", path.c_str()));
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    if (m_size == 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    void *data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds its own reference to the file, so the descriptor is not needed anymore.
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        m_size = 0;
+        throw std::runtime_error(format_string("failed to map file: %s", path.c_str()));
+    }
+    m_data = reinterpret_cast<const uint8_t *>(data);
+#endif // WIN32
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(WIN32)
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle)
+    {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_fileHandle);
+    }
+#else  // WIN32
+    if (m_data)
+    {
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+    }
+#endif // WIN32
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/Realtime.h"
+#include "blfwk/Logging.h"
+#include <errno.h>
+#include <string.h>
+
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif // WIN32
+
+using namespace blfwk;
+
+//! Assumed page size, the smallest one used by the supported platforms.
+static const size_t kPageSize = 4096;
+
+//! True once enable() has been called. Threads created afterwards see it set.
+static bool s_isEnabled = false;
+
+#if !defined(WIN32)
+static int s_normalPolicy = SCHED_OTHER;  //!< Scheduling policy before enable().
+static struct sched_param s_normalParam;  //!< Scheduling parameters before enable().
+#if defined(LINUX)
+static cpu_set_t s_normalCpus;            //!< CPU affinity before enable().
+#endif // LINUX
+#endif // WIN32
+
+bool Realtime::enable(int cpu, int priority)
+{
+    bool isComplete = true;
+
+#if defined(WIN32)
+    if ((cpu != kAnyCpu) && !SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu))
+    {
+        Log::warning("Warning: cannot pin blhost to CPU %d\n", cpu);
+        isComplete = false;
+    }
+    (void)priority;
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+    {
+        Log::warning("Warning: cannot raise the thread priority\n");
+        isComplete = false;
+    }
+    Log::warning("Warning: memory locking is not supported on this platform\n");
+    isComplete = false;
+#else
+    pthread_getschedparam(pthread_self(), &s_normalPolicy, &s_normalParam);
+#if defined(LINUX)
+    // Only the calling thread is pinned, the affinity of the process is kept for leave().
+    sched_getaffinity(0, sizeof(s_normalCpus), &s_normalCpus);
+    if (cpu != kAnyCpu)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+        {
+            Log::warning("Warning: cannot pin blhost to CPU %d: %s\n", cpu, strerror(errno));
+            isComplete = false;
+        }
+    }
+#else
+    if (cpu != kAnyCpu)
+    {
+        Log::warning("Warning: pinning to a CPU is not supported on this platform\n");
+        isComplete = false;
+    }
+#endif // LINUX
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0)
+    {
+        Log::warning("Warning: cannot set SCHED_FIFO priority %d: %s\n", priority, strerror(result));
+        isComplete = false;
+    }
+
+    // The stack is touched first so that its pages are locked with the rest. Memory mapped
+    // later is not locked, so that helper threads and input files do not pin memory; the
+    // packet buffers are locked by prefault().
+    prefaultStack();
+    if (mlockall(MCL_CURRENT) != 0)
+    {
+        Log::warning("Warning: cannot lock memory: %s\n", strerror(errno));
+        isComplete = false;
+    }
+#endif // WIN32
+
+    s_isEnabled = true;
+
+    Log::debug("Real-time mode %s\n", isComplete ? "enabled" : "partially enabled");
+    return isComplete;
+}
+
+void Realtime::leave()
+{
+#if !defined(WIN32)
+    // Threads created on Windows do not inherit the affinity and priority.
+    if (!s_isEnabled)
+    {
+        return;
+    }
+    pthread_setschedparam(pthread_self(), s_normalPolicy, &s_normalParam);
+#if defined(LINUX)
+    sched_setaffinity(0, sizeof(s_normalCpus), &s_normalCpus);
+#endif // LINUX
+#endif // WIN32
+}
+
+void Realtime::prefault(void *buffer, size_t size)
+{
+    volatile uint8_t *bytes = reinterpret_cast<volatile uint8_t *>(buffer);
+    for (size_t offset = 0; offset < size; offset += kPageSize)
+    {
+        bytes[offset] = bytes[offset];
+    }
+    if (size)
+    {
+        bytes[size - 1] = bytes[size - 1];
+    }
+
+#if !defined(WIN32)
+    if (s_isEnabled && size)
+    {
+        // The range passed to mlock() must start on a page boundary on some platforms.
+        uintptr_t pageMask = (uintptr_t)sysconf(_SC_PAGESIZE) - 1;
+        uintptr_t start = (uintptr_t)buffer & ~pageMask;
+        if (mlock((void *)start, (uintptr_t)buffer + size - start) != 0)
+        {
+            Log::warning("Warning: cannot lock the packet buffers: %s\n", strerror(errno));
+        }
+    }
+#endif // WIN32
+}
+
+void Realtime::prefaultStack()
+{
+    volatile uint8_t stack[kPrefaultStackSize];
+    for (size_t offset = 0; offset < sizeof(stack); offset += kPageSize)
+    {
+        stack[offset] = 0;
+    }
+}
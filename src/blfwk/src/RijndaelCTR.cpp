@@ -6,6 +6,7 @@
  */
 
 #include "blfwk/RijndaelCTR.h"
+#include "blfwk/AESHardware.h"
 #include "blfwk/rijndael.h"
 #include <assert.h>
 #include "blfwk/Logging.h"
@@ -37,6 +38,18 @@ void RijndaelCTR::baseProcess(const uint8_t *data, unsigned length, uint8_t *des
     block_t remainder;
     AESCounter<128>::counter_t currentCounter;
 
+    // Whole blocks are processed by the AES instructions of the processor, if it has them.
+    if (blocks && AESHardware::isAvailable())
+    {
+        m_counter.getCounter(&currentCounter);
+        AESHardware::processCtr(m_key.getKey(), currentCounter, BLOCK_SIZE, data, blocks, dest);
+        m_counter.setCounter(currentCounter);
+
+        data += blocks * BLOCK_SIZE;
+        dest += blocks * BLOCK_SIZE;
+        blocks = 0;
+    }
+
     cipher.init(Rijndael::ECB, Rijndael::Encrypt, m_key, Rijndael::Key16Bytes);
 
     while (blocks--)
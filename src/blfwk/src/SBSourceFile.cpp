@@ -74,6 +74,151 @@ bool SBSourceFile::isSBFile(std::istream &stream)
     }
 }
 
+//! The target processes the boot commands of an SB file while the file is being
+//! received. A jump, call or reset command, a boot mode change or a failed firmware
+//! version check makes it end the data phase before the whole file has been sent.
+//! The host must then poll for an abort packet from the target after every data
+//! packet, which slows the transfer down considerably.
+//!
+//! This method walks the boot sections of an unencrypted SB 1.x/2.x file looking for
+//! any of those commands. The boot commands of encrypted and SB 3.x files cannot be
+//! read without the keys, so such files are assumed to abort.
+//!
+//! \retval true The file contains a command that may end the transfer early, or it
+//!     could not be scanned.
+//! \retval false The target will accept the whole file without aborting.
+bool SBSourceFile::canAbortTransfer(std::istream &stream)
+{
+    // SB 3.x files start with their own signature and are always encrypted.
+    char signature[4];
+    stream.seekg(0, std::ios_base::beg);
+    if (stream.read(signature, sizeof(signature)).fail())
+    {
+        stream.clear();
+        return true;
+    }
+    if (memcmp(signature, "sbv3", sizeof(signature)) == 0)
+    {
+        Log::log(Logger::kDebug2, "SB 3.x file commands cannot be scanned\n");
+        return true;
+    }
+
+    if (!isSBFile(stream))
+    {
+        stream.clear();
+        return true;
+    }
+
+    boot_image_header_t header;
+    stream.clear();
+    stream.seekg(0, std::ios_base::beg);
+    if (stream.read((char *)&header, sizeof(header)).fail())
+    {
+        stream.clear();
+        return true;
+    }
+    if (ENDIAN_LITTLE_TO_HOST_U16(header.m_keyCount) != 0)
+    {
+        Log::log(Logger::kDebug2, "encrypted SB file commands cannot be scanned\n");
+        return true;
+    }
+
+    // Walk the sections, starting at the first section tag.
+    stream.seekg(0, std::ios_base::end);
+    uint64_t fileSize = (uint64_t)stream.tellg();
+    uint64_t offset = (uint64_t)ENDIAN_LITTLE_TO_HOST_U32(header.m_firstBootTagBlock) * kCipherBlockSize;
+    boot_command_t command;
+    while (true)
+    {
+        if (!readBootCommand(stream, offset, command) || command.m_tag != ROM_TAG_CMD)
+        {
+            Log::log(Logger::kDebug2, "invalid SB section tag at offset %#llx\n", (unsigned long long)offset);
+            return true;
+        }
+
+        bool isLastSection = (command.m_flags & ROM_LAST_TAG) != 0;
+        bool isBootable = (command.m_data & ROM_SECTION_BOOTABLE) != 0;
+        uint64_t sectionStart = offset + kCipherBlockSize;
+        uint64_t sectionEnd = sectionStart + (uint64_t)command.m_count * kCipherBlockSize;
+        if (sectionEnd > fileSize)
+        {
+            Log::log(Logger::kDebug2, "SB section at offset %#llx is truncated\n", (unsigned long long)offset);
+            return true;
+        }
+
+        // Only bootable sections contain commands, the others are just data.
+        for (offset = sectionStart; isBootable && offset < sectionEnd; offset += kCipherBlockSize)
+        {
+            if (!readBootCommand(stream, offset, command))
+            {
+                Log::log(Logger::kDebug2, "invalid SB command at offset %#llx\n", (unsigned long long)offset);
+                return true;
+            }
+
+            switch (command.m_tag)
+            {
+                case ROM_NOP_CMD:
+                case ROM_TAG_CMD:
+                case ROM_FILL_CMD:
+                case ROM_ERASE_CMD:
+                case ROM_MEM_ENABLE_CMD:
+                case ROM_PROG_CMD:
+                    break;
+
+                case ROM_LOAD_CMD:
+                    // Skip the data that follows the command.
+                    offset += ((uint64_t)command.m_count + kCipherBlockSize - 1) / kCipherBlockSize * kCipherBlockSize;
+                    break;
+
+                default:
+                    Log::log(Logger::kDebug2, "SB command %#x at offset %#llx may abort the transfer\n",
+                             command.m_tag, (unsigned long long)offset);
+                    return true;
+            }
+        }
+
+        if (isLastSection)
+        {
+            break;
+        }
+        offset = sectionEnd;
+    }
+
+    return false;
+}
+
+//! The fields of \a command are converted to host byte order.
+//!
+//! \retval false The command could not be read or its checksum is wrong.
+bool SBSourceFile::readBootCommand(std::istream &stream, uint64_t offset, boot_command_t &command)
+{
+    stream.clear();
+    stream.seekg(offset, std::ios_base::beg);
+    if (stream.read((char *)&command, sizeof(command)).fail())
+    {
+        stream.clear();
+        return false;
+    }
+
+    // The checksum is 0x5a plus the sum of every other byte of the command.
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&command);
+    uint8_t checksum = 0x5a;
+    for (unsigned i = 1; i < sizeof(command); ++i)
+    {
+        checksum += bytes[i];
+    }
+    if (checksum != command.m_checksum)
+    {
+        return false;
+    }
+
+    command.m_flags = ENDIAN_LITTLE_TO_HOST_U16(command.m_flags);
+    command.m_address = ENDIAN_LITTLE_TO_HOST_U32(command.m_address);
+    command.m_count = ENDIAN_LITTLE_TO_HOST_U32(command.m_count);
+    command.m_data = ENDIAN_LITTLE_TO_HOST_U32(command.m_data);
+    return true;
+}
+
 DataSource *SBSourceFile::createDataSource()
 {
     throw std::runtime_error("SBSourceFile::createDataSource() has not been implemented.");
@@ -10,7 +10,11 @@
 #include <string.h>
 #include "blfwk/smart_ptr.h"
 #include "blfwk/SRecordSourceFile.h"
+#include "blfwk/ChunkedTextParser.h"
+#include "blfwk/InputStream.h"
 #include "blfwk/Logging.h"
+#include "blfwk/StreamingDataSource.h"
+#include <memory>
 
 enum
 {
@@ -40,6 +44,24 @@ void SRecordSourceFile::open()
 {
     SourceFile::open();
 
+    // Parse a memory mapping of the file in parallel if possible.
+    smart_ptr<MappedFile> mapping;
+    try
+    {
+        mapping = new MappedFile(m_path);
+    }
+    catch (std::runtime_error &e)
+    {
+        Log::log(Logger::kDebug2, "not using memory mapping for %s: %s\n", m_path.c_str(), e.what());
+    }
+
+    if (mapping && mapping->getSize())
+    {
+        m_image = new StExecutableImage();
+        buildMemoryImage(*mapping);
+        return;
+    }
+
     // create file parser and examine file
     m_file = new StSRecordFile(*m_stream);
     m_file->parse();
@@ -72,6 +94,72 @@ DataSource *SRecordSourceFile::createDataSource()
     return new MemoryImageDataSource(m_image);
 }
 
+//! The file is memory mapped and parsed sequentially on the data source's parser
+//! thread. Data records are passed on in file order, without building a memory image.
+//! Entry point records are ignored.
+//!
+//! \retval NULL The file could not be mapped.
+StreamingDataSource *SRecordSourceFile::createStreamingDataSource()
+{
+    std::shared_ptr<MappedFile> mapping;
+    try
+    {
+        mapping = std::make_shared<MappedFile>(m_path);
+    }
+    catch (std::runtime_error &e)
+    {
+        Log::log(Logger::kDebug2, "cannot stream %s: %s\n", m_path.c_str(), e.what());
+        return NULL;
+    }
+
+    StreamingDataSource *source = new StreamingDataSource();
+    source->start([mapping](StreamingDataSource &source) {
+        ChunkedTextParser::Chunk chunk;
+        chunk.m_begin = reinterpret_cast<const char *>(mapping->getData());
+        chunk.m_end = chunk.m_begin + mapping->getSize();
+
+        ChunkedTextParser::forEachLine(chunk, [&source](const char *line, unsigned length) -> bool {
+            return addRecordData(source, line, length);
+        });
+    });
+
+    return source;
+}
+
+//! The S-records are parsed on the thread of the returned data source. Takes
+//! ownership of \a input. The caller owns the returned object.
+StreamingDataSource *SRecordSourceFile::createStreamingDataSource(InputStream *input)
+{
+    std::shared_ptr<InputStream> stream(input);
+
+    StreamingDataSource *source = new StreamingDataSource();
+    source->start([stream](StreamingDataSource &source) {
+        stream->forEachLine([&source](const char *line, unsigned length) -> bool {
+            return addRecordData(source, line, length);
+        });
+    });
+
+    return source;
+}
+
+//! Only S3, S2 and S1 records have data. All other records are ignored.
+//!
+//! \retval true Always, parsing continues with the next record.
+bool SRecordSourceFile::addRecordData(StreamingDataSource &source, const char *line, unsigned length)
+{
+    StSRecordFile::SRecord theRecord;
+    uint8_t data[SRECORD_MAX_DATA_LENGTH];
+    StSRecordFile::parseRecord(line, length, theRecord, data);
+
+    // only handle S3,2,1 records
+    bool isDataRecord = theRecord.m_type == 3 || theRecord.m_type == 2 || theRecord.m_type == 1;
+    if (isDataRecord && theRecord.m_data && theRecord.m_dataCount)
+    {
+        source.addData(theRecord.m_address, data, theRecord.m_dataCount);
+    }
+    return true;
+}
+
 //! \retval true The file has an S7, S8, or S9 record.
 //! \retval false No entry point is available.
 bool SRecordSourceFile::hasEntryPoint()
@@ -180,3 +268,88 @@ void SRecordSourceFile::buildMemoryImage()
         m_image->addTextRegion(startAddress, buffer, dataLength);
     }
 }
+
+//! Produces the same memory image as buildMemoryImage(), without building a list
+//! of records first. The file is split into newline-aligned chunks that are parsed
+//! concurrently. Each chunk collects its data records into contiguous runs, which
+//! are then added to the executable image in file order.
+//!
+//! \pre The #m_image member variable must have been instantiated.
+void SRecordSourceFile::buildMemoryImage(const MappedFile &mapping)
+{
+    assert(m_image);
+
+    //! Results of parsing one chunk of the file.
+    struct ChunkResult
+    {
+        ChunkedTextParser::run_vector_t m_runs; //!< Data collected from the chunk.
+        bool m_hasEntryRecord;                  //!< Whether an S7,8,9 record was found in the chunk.
+        StSRecordFile::SRecord m_entryRecord;   //!< First entry point record of the chunk.
+        std::vector<uint8_t> m_entryData;       //!< Data of #m_entryRecord, which points at a parse buffer.
+    };
+
+    ChunkedTextParser::chunk_vector_t chunks = ChunkedTextParser::split(mapping.getData(), mapping.getSize());
+    std::vector<ChunkResult> results(chunks.size());
+
+    Log::log(Logger::kDebug2, "parsing %s in %u chunks\n", m_path.c_str(), (unsigned)chunks.size());
+
+    ChunkedTextParser::run(chunks.size(), [&chunks, &results](size_t index) {
+        ChunkResult &result = results[index];
+        result.m_hasEntryRecord = false;
+        memset(&result.m_entryRecord, 0, sizeof(result.m_entryRecord));
+
+        ChunkedTextParser::forEachLine(chunks[index], [&result](const char *line, unsigned length) -> bool {
+            StSRecordFile::SRecord theRecord;
+            uint8_t data[SRECORD_MAX_DATA_LENGTH];
+            StSRecordFile::parseRecord(line, length, theRecord, data);
+
+            // only handle S3,2,1 records
+            bool isDataRecord = theRecord.m_type == 3 || theRecord.m_type == 2 || theRecord.m_type == 1;
+            bool hasData = theRecord.m_data && theRecord.m_dataCount;
+            if (isDataRecord && hasData)
+            {
+                ChunkedTextParser::appendData(result.m_runs, theRecord.m_address, data, theRecord.m_dataCount);
+            }
+            else if (!result.m_hasEntryRecord)
+            {
+                // look for S7,8,9 records
+                if (theRecord.m_type == 7 || theRecord.m_type == 8 || theRecord.m_type == 9)
+                {
+                    result.m_entryRecord = theRecord;
+                    if (theRecord.m_data)
+                    {
+                        result.m_entryData.assign(data, data + theRecord.m_dataCount);
+                    }
+                    result.m_hasEntryRecord = true;
+                }
+            }
+            return true;
+        });
+    });
+
+    // Clear the entry point related members.
+    m_hasEntryRecord = false;
+    memset(&m_entryRecord, 0, sizeof(m_entryRecord));
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        ChunkResult &result = results[i];
+        for (size_t j = 0; j < result.m_runs.size(); ++j)
+        {
+            ChunkedTextParser::DataRun &run = result.m_runs[j];
+            m_image->addTextRegion(run.m_address, &run.m_data[0], (unsigned)run.m_data.size());
+
+            // release the run as soon as the image has its own copy
+            std::vector<uint8_t>().swap(run.m_data);
+        }
+
+        if (result.m_hasEntryRecord && !m_hasEntryRecord)
+        {
+            // keep a copy of the data that the record itself owns
+            m_entryRecord = result.m_entryRecord;
+            m_entryRecordData.swap(result.m_entryData);
+            m_entryRecord.m_data = m_entryRecordData.empty() ? NULL : &m_entryRecordData[0];
+            m_hasEntryRecord = true;
+        }
+    }
+}
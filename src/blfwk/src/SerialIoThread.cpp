@@ -0,0 +1,265 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/SerialIoThread.h"
+#include "blfwk/Logging.h"
+#include "blfwk/format_string.h"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#if !defined(WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif // WIN32
+
+using namespace blfwk;
+
+//! Poll interval of the thread while the receive ring is full, in milliseconds.
+static const int kRxFullPollMs = 10;
+
+//! Longest time the destructor waits for queued data to be sent, in milliseconds.
+static const int kStopTimeoutMs = 1000;
+
+SerialIoThread::SerialIoThread(int fd, size_t ringSize)
+    : m_fd(fd)
+    , m_rxRing(ringSize)
+    , m_txRing(ringSize)
+    , m_isStopped(false)
+    , m_isFailed(false)
+    , m_isReaderWaiting(false)
+    , m_isWriterWaiting(false)
+    , m_queuedCount(0)
+    , m_sentCount(0)
+{
+#if defined(WIN32)
+    throw std::runtime_error("the serial I/O thread is not supported on this platform");
+#else
+    if (pipe(m_wakePipe) != 0)
+    {
+        throw std::runtime_error(format_string("cannot create serial I/O thread wake pipe: %s", strerror(errno)));
+    }
+    fcntl(m_wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(m_wakePipe[1], F_SETFL, O_NONBLOCK);
+
+    m_thread = std::thread(&SerialIoThread::run, this);
+#endif // WIN32
+}
+
+SerialIoThread::~SerialIoThread()
+{
+#if !defined(WIN32)
+    m_isStopped = true;
+    wake();
+    m_thread.join();
+
+    close(m_wakePipe[0]);
+    close(m_wakePipe[1]);
+#endif // WIN32
+}
+
+uint32_t SerialIoThread::read(uint8_t *buffer, uint32_t size, uint32_t timeoutMs)
+{
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    uint32_t count = 0;
+    while (count < size)
+    {
+        count += (uint32_t)m_rxRing.read(buffer + count, size - count);
+        if (count == size)
+        {
+            break;
+        }
+
+        // Sleep until the thread has received more data. The flag is set before the ring is
+        // checked again, and the thread stores data before checking the flag, so one of the
+        // two always sees the other.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_isReaderWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool isReady = m_condition.wait_until(lock, deadline, [this] {
+            return m_rxRing.getReadAvailable() || m_isFailed;
+        });
+        m_isReaderWaiting = false;
+        if (!isReady || !m_rxRing.getReadAvailable())
+        {
+            break;
+        }
+    }
+
+    return count;
+}
+
+bool SerialIoThread::write(const uint8_t *buffer, uint32_t size)
+{
+    uint32_t count = 0;
+    while (!m_isFailed)
+    {
+        uint32_t written = (uint32_t)m_txRing.write(buffer + count, size - count);
+        count += written;
+        m_queuedCount += written;
+        wake();
+
+        // Sleep until the thread has sent some of a full ring, or all of the data once it is queued,
+        // so that the caller's timestamps after the write are those of the data leaving.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_isWriterWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (count == size)
+        {
+            m_condition.wait(lock, [this] { return (m_sentCount == m_queuedCount) || m_isFailed; });
+            m_isWriterWaiting = false;
+            return !m_isFailed;
+        }
+        m_condition.wait(lock, [this] { return m_txRing.getWriteAvailable() || m_isFailed; });
+        m_isWriterWaiting = false;
+    }
+
+    return false;
+}
+
+void SerialIoThread::notify(std::atomic<bool> &isWaiting)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (isWaiting)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+}
+
+void SerialIoThread::wake()
+{
+#if !defined(WIN32)
+    // The pipe is non-blocking, a full pipe already wakes the thread.
+    const uint8_t byte = 0;
+    ssize_t result = ::write(m_wakePipe[1], &byte, sizeof(byte));
+    (void)result;
+#endif // WIN32
+}
+
+void SerialIoThread::run()
+{
+#if !defined(WIN32)
+    uint8_t rxBuffer[4096];
+    std::vector<uint8_t> txBuffer(4096);
+    size_t txOffset = 0;
+    size_t txCount = 0;
+    std::chrono::steady_clock::time_point stopTime;
+
+    for (;;)
+    {
+        // Refill the transmit buffer from the ring.
+        if (txOffset == txCount)
+        {
+            txOffset = 0;
+            txCount = m_txRing.read(&txBuffer[0], txBuffer.size());
+            if (txCount)
+            {
+                notify(m_isWriterWaiting);
+            }
+        }
+
+        if (m_isStopped)
+        {
+            if (txCount == 0)
+            {
+                break;
+            }
+            if (stopTime == std::chrono::steady_clock::time_point())
+            {
+                stopTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(kStopTimeoutMs);
+            }
+            else if (std::chrono::steady_clock::now() > stopTime)
+            {
+                Log::warning("Warning: discarding %u bytes that could not be sent to the serial port\n",
+                             (unsigned)(txCount - txOffset + m_txRing.getReadAvailable()));
+                break;
+            }
+        }
+
+        bool isRxFull = (m_rxRing.getWriteAvailable() == 0);
+        struct pollfd fds[2];
+        fds[0].fd = m_fd;
+        fds[0].events = (isRxFull ? 0 : POLLIN) | ((txCount > txOffset) ? POLLOUT : 0);
+        fds[0].revents = 0;
+        fds[1].fd = m_wakePipe[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+
+        int result = poll(fds, 2, (isRxFull || m_isStopped) ? kRxFullPollMs : -1);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            Log::error("Error: serial I/O thread poll failed: %s\n", strerror(errno));
+            break;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            uint8_t drain[64];
+            while (::read(m_wakePipe[0], drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+
+        if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+        {
+            Log::error("Error: serial port closed or failed\n");
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            size_t space = std::min(sizeof(rxBuffer), m_rxRing.getWriteAvailable());
+            ssize_t count = ::read(m_fd, rxBuffer, space);
+            if (count < 0 && errno != EINTR && errno != EAGAIN)
+            {
+                Log::error("Error: serial port read failed: %s\n", strerror(errno));
+                break;
+            }
+            if (count > 0)
+            {
+                m_rxRing.write(rxBuffer, count);
+                notify(m_isReaderWaiting);
+            }
+        }
+
+        if (fds[0].revents & POLLOUT)
+        {
+            ssize_t count = ::write(m_fd, &txBuffer[txOffset], txCount - txOffset);
+            if (count < 0 && errno != EINTR && errno != EAGAIN)
+            {
+                Log::error("Error: serial port write failed: %s\n", strerror(errno));
+                break;
+            }
+            if (count > 0)
+            {
+                txOffset += count;
+                m_sentCount += count;
+                notify(m_isWriterWaiting);
+            }
+        }
+    }
+
+    // Wake both sides so that they see the failure, or the end of the thread.
+    if (!m_isStopped)
+    {
+        m_isFailed = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+#endif // WIN32
+}
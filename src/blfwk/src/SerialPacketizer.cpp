@@ -8,6 +8,7 @@
  */
 
 #include "blfwk/Logging.h"
+#include "blfwk/Realtime.h"
 #include "blfwk/SerialPacketizer.h"
 #include "blfwk/utils.h"
 #include "crc/crc16.h"
@@ -18,6 +19,8 @@
 #include <string.h>
 #include <unistd.h>
 #endif
+#include <algorithm>
+#include <thread>
 
 using namespace blfwk;
 
@@ -50,6 +53,20 @@ const ping_response_t k_PingResponse = {
 // See SerialPacketizer.h for documentation of this method.
 SerialPacketizer::SerialPacketizer(Peripheral *peripheral, uint32_t packetTimeoutMs)
     : Packetizer(peripheral, packetTimeoutMs)
+    , m_backToBackDelayMs(kDefaultBackToBackDelayMs)
+    , m_isAdaptiveBackToBack(true)
+    , m_isPacedWrite(false)
+    , m_isDataAfterSync(false)
+    , m_isNakReceived(false)
+    , m_learnedGapUs(0)
+    , m_learnSampleCount(0)
+    , m_dataGapUs(kDefaultBackToBackDelayMs * 1000)
+    , m_dataGapFloorUs(kBackToBackMarginUs)
+    , m_lastSyncTime(std::chrono::steady_clock::now())
+    , m_lastFrame(NULL)
+    , m_lastFrameSize(0)
+    , m_pingResponseTimeoutMs(kDefaultPingResponseTimeoutMs)
+    , m_pingMaxRetryDelayMs(0)
 {
     // Clear the initial serial context
     memset(&m_serialContext, 0, sizeof(m_serialContext));
@@ -108,15 +125,31 @@ void SerialPacketizer::host_delay(uint32_t milliseconds)
 #endif
 }
 
+// See SerialPacketizer.h for documentation of this method.
+void SerialPacketizer::prefaultBuffers()
+{
+    Realtime::prefault(&m_serialContext, sizeof(m_serialContext));
+}
+
+// See SerialPacketizer.h for documentation of this method.
+void SerialPacketizer::setBackToBackDelay(uint32_t maxDelayMs, bool isAdaptive)
+{
+    m_backToBackDelayMs = maxDelayMs;
+    m_isAdaptiveBackToBack = isAdaptive;
+    m_learnedGapUs = 0;
+    m_learnSampleCount = 0;
+    m_dataGapUs = maxDelayMs * 1000;
+    m_dataGapFloorUs = kBackToBackMarginUs;
+}
+
 // See SerialPacketizer.h for documentation of this method.
 status_t SerialPacketizer::ping(
     int retries, unsigned int delay, ping_response_t *pingResponse, int comSpeed, int *actualComSpeed)
 {
     status_t status = kStatus_NoPingResponse;
     uint8_t startByte = 0;
-    uint32_t bytesRead = 0;
-    const int initialRetries = retries;
-    static bool retryDoubledBaudrate = true;
+    uint32_t retryDelayMs = delay;
+    int attempt = 0;
 
     if (actualComSpeed != NULL)
     {
@@ -128,82 +161,88 @@ status_t SerialPacketizer::ping(
     pingPacket.packetType = kFramingPacketType_Ping;
 
     // Send ping until we receive a start byte.
-    do
+    for (;;)
     {
+        ++attempt;
+
         // Send the ping
         if (m_peripheral->write((uint8_t *)&pingPacket, sizeof(pingPacket)) == kStatus_Success)
         {
-            double timeout = 0.500;
-            double duration = 0.0;
-#if defined(WIN32)
-            clock_t start = clock();
-#else //#elif defined(LINUX) || defined(MACOSX)
-            struct timespec start;
-            clock_gettime(CLOCK_REALTIME, &start);
-#endif
-
-            // Try for half a second to get a response from the ping.
-            while (duration < timeout)
+            // Wait for the start byte of the response. Reads return as soon as it arrives, only
+            // peripherals that do not wait for data are polled.
+            std::chrono::steady_clock::time_point sendTime = std::chrono::steady_clock::now();
+            Deadline deadline(m_pingResponseTimeoutMs);
+            while (!deadline.isExpired())
             {
-                if (m_peripheral->read(&startByte, sizeof(startByte), &bytesRead,
-                                       UartPeripheral::kUartPeripheral_UnusedTimeout) == kStatus_Success)
+                status_t readStatus = read_bytes(&startByte, sizeof(startByte), deadline);
+                if (readStatus == kStatus_Success)
                 {
                     if (startByte == kFramingPacketStartByte)
                     {
                         break;
                     }
                 }
-
-                host_delay(kReadDelayMilliseconds);
-
-#if defined(WIN32)
-                // Windows: CLOCKS_PER_SEC = 1,000, Linux & MACOSX: CLOCKS_PER_SEC = 1,000,000.
-                duration = (double)(clock() - start) / CLOCKS_PER_SEC;
-#else //#elif defined(LINUX) || defined(MACOSX)
-                struct timespec current;
-                clock_gettime(CLOCK_REALTIME, &current);
-                duration =
-                    (double)(current.tv_sec - start.tv_sec) + (double)(current.tv_nsec - start.tv_nsec) / 1000000000;
-#endif
+                else if (readStatus != kStatus_Timeout)
+                {
+                    break;
+                }
+                else
+                {
+                    host_delay(std::min<uint32_t>(kReadDelayMilliseconds, deadline.getRemainingMs()));
+                }
             }
 
             // If we got our start byte, move on to read the response packet
             if (startByte == kFramingPacketStartByte)
             {
+                Log::debug("Ping response started after %d us\n",
+                           (int)std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - sendTime)
+                               .count());
                 break;
             }
         }
 
-        host_delay(delay);
+        if (attempt > retries)
+        {
+            break;
+        }
 
-    } while (retries--);
+        // Leave the line idle before the next attempt, so a target that detects the baud rate
+        // from the ping sees a clean start byte.
+        host_delay(retryDelayMs);
+        if (m_pingMaxRetryDelayMs > retryDelayMs)
+        {
+            retryDelayMs = std::min(std::max<uint32_t>(retryDelayMs * 2, 1), m_pingMaxRetryDelayMs);
+        }
+    }
 
     if (startByte == kFramingPacketStartByte)
     {
-        Log::info("Ping responded in %d attempt(s)\n", (initialRetries - retries) + 1);
+        Log::info("Ping responded in %d attempt(s)\n", attempt);
 
-        // Wait for the rest of the ping bytes
+        // Wait for the rest of the ping bytes. UART reads wait for the bytes until the deadline,
+        // the other peripherals return at once, so give the target time to send them.
         // In the case of testing low baud rates the target needs time to respond
         // 100 baud rate reply is looking for 9 more bytes = 90 bits with start/stop overhead
         // 90 bits / 100 baud = .9 seconds = 900 milliseconds. The additional 20 milliseconds is to ensure
         // that even high baud rates have some sort of delay and to give a little wiggle room for lower baud rates
-        if (comSpeed)
+        if (comSpeed && (m_peripheral->get_type() != Peripheral::kHostPeripheralType_UART))
         {
             host_delay(((1000 * 90) / comSpeed) + 20);
         }
 
         // Read response packet type.
+        Deadline deadline = getPacketDeadline();
         uint8_t packetType;
-        status = m_peripheral->read(&packetType, sizeof(packetType), &bytesRead,
-                                    UartPeripheral::kUartPeripheral_UnusedTimeout);
+        status = read_bytes(&packetType, sizeof(packetType), deadline);
         if (status == kStatus_Success)
         {
             if (packetType == kFramingPacketType_PingResponse)
             {
                 // Read response.
                 ping_response_t response;
-                status = m_peripheral->read((uint8_t *)&response, sizeof(response), &bytesRead,
-                                            UartPeripheral::kUartPeripheral_UnusedTimeout);
+                status = read_bytes((uint8_t *)&response, sizeof(response), deadline);
                 if (status == kStatus_Success)
                 {
                     // Validate reponse CRC.
@@ -254,6 +293,49 @@ status_t SerialPacketizer::ping(
     return status;
 }
 
+// See SerialPacketizer.h for documentation of this method.
+status_t SerialPacketizer::pingSpeeds(int retries,
+                                      unsigned int delay,
+                                      ping_response_t *pingResponse,
+                                      const std::vector<int> &comSpeeds,
+                                      int *actualComSpeed)
+{
+    UartPeripheral *peripheral = getPeripheral();
+    if (comSpeeds.empty() || ((comSpeeds.size() > 1) && !peripheral))
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    status_t status = kStatus_NoPingResponse;
+    for (size_t i = 0; i < comSpeeds.size(); ++i)
+    {
+        if ((comSpeeds.size() > 1) && (peripheral->getSpeed() != comSpeeds[i]))
+        {
+            if (!peripheral->setSpeed(comSpeeds[i]))
+            {
+                Log::warning("Warning: cannot set port speed to %d\n", comSpeeds[i]);
+                continue;
+            }
+        }
+
+        Log::debug("Pinging at %d baud\n", comSpeeds[i]);
+        status = ping(retries, delay, pingResponse, comSpeeds[i], actualComSpeed);
+        if (status == kStatus_Success)
+        {
+            break;
+        }
+    }
+
+    return status;
+}
+
+// See SerialPacketizer.h for documentation of this method.
+void SerialPacketizer::setPingTiming(uint32_t responseTimeoutMs, uint32_t maxRetryDelayMs)
+{
+    m_pingResponseTimeoutMs = responseTimeoutMs;
+    m_pingMaxRetryDelayMs = maxRetryDelayMs;
+}
+
 // Private Implementation
 
 // See SerialPacketizer.h for documentation on this function.
@@ -286,7 +368,7 @@ status_t SerialPacketizer::serial_packet_read(uint8_t **packet, uint32_t *packet
 
         // Receive the framing data packet.
         isPacketOk = true;
-        status_t status = read_data_packet(&framingPacket, m_serialContext.data, packetType);
+        status_t status = read_data_packet(&framingPacket, m_serialContext.data, packetType, getPacketDeadline());
         if (status != kStatus_Success)
         {
             // No packet available.
@@ -328,21 +410,12 @@ status_t SerialPacketizer::serial_packet_write(const uint8_t *packet, uint32_t b
         return kStatus_InvalidArgument;
     }
 
-    // Send ACK if needed.
-    status_t status = send_deferred_ack();
+    status_t status = begin_packet_write(packetType);
     if (status != kStatus_Success)
     {
         return status;
     }
 
-    // Back-to-back writes require delay for receiver to enter peripheral read routine.
-    if (m_serialContext.isBackToBackWrite)
-    {
-        m_serialContext.isBackToBackWrite = false;
-
-        host_delay(100);
-    }
-
     // Initialize the framing data packet.
     serial_framing_packet_t *framingPacket = &m_serialContext.framingPacket;
     framingPacket->dataPacket.header.startByte = kFramingPacketStartByte;
@@ -367,13 +440,276 @@ status_t SerialPacketizer::serial_packet_write(const uint8_t *packet, uint32_t b
 #endif // TEST_NAK
 
     // Send the framing data packet.
-    status = m_peripheral->write((uint8_t *)framingPacket, sizeof(framing_data_packet_t) + byteCount);
+    return send_framing_packet((uint8_t *)framingPacket, sizeof(framing_data_packet_t) + byteCount);
+}
+
+// See SerialPacketizer.h for documentation on this function.
+void SerialPacketizer::preparePacket(PreparedPacket &prepared,
+                                     const uint8_t *packet,
+                                     uint32_t byteCount,
+                                     packet_type_t packetType)
+{
+    prepared.data = packet;
+    prepared.byteCount = byteCount;
+    prepared.packetType = packetType;
+    prepared.frame.clear();
+    if (!packet || (byteCount > kOutgoingPacketBufferSize))
+    {
+        // Reported by writePreparedPacket().
+        return;
+    }
+
+    // Same framing as serial_packet_write(), but into the caller's buffer so that
+    // another packet can be in flight meanwhile.
+    framing_data_packet_t header;
+    header.header.startByte = kFramingPacketStartByte;
+    header.header.packetType =
+        (packetType != kPacketType_Command) ? kFramingPacketType_Data : kFramingPacketType_Command;
+    header.length = (uint16_t)byteCount;
+    header.crc16 = calculate_framing_crc16(&header, packet);
+#if defined(TEST_NAK)
+    ++header.crc16;
+#endif // TEST_NAK
+
+    prepared.frame.resize(sizeof(header) + byteCount);
+    memcpy(&prepared.frame[0], &header, sizeof(header));
+    if (byteCount)
+    {
+        memcpy(&prepared.frame[sizeof(header)], packet, byteCount);
+    }
+}
+
+// See SerialPacketizer.h for documentation on this function.
+status_t SerialPacketizer::writePreparedPacket(PreparedPacket &prepared)
+{
+    if (prepared.frame.empty())
+    {
+        return serial_packet_write(prepared.data, prepared.byteCount, prepared.packetType);
+    }
+
+    status_t status = begin_packet_write(prepared.packetType);
+    if (status != kStatus_Success)
+    {
+        return status;
+    }
+
+    return send_framing_packet(&prepared.frame[0], (uint32_t)prepared.frame.size());
+}
+
+// See SerialPacketizer.h for documentation on this function.
+status_t SerialPacketizer::begin_packet_write(packet_type_t packetType)
+{
+    // Send ACK if needed.
+    status_t status = send_deferred_ack();
+    if (status != kStatus_Success)
+    {
+        return status;
+    }
+
+    // Back-to-back writes require delay for receiver to enter peripheral read routine.
+    m_isPacedWrite = false;
+    m_isDataAfterSync = false;
+    if (m_serialContext.isBackToBackWrite)
+    {
+        m_serialContext.isBackToBackWrite = false;
+
+        wait_for_receiver_ready(packetType);
+    }
+
+    return kStatus_Success;
+}
+
+// See SerialPacketizer.h for documentation on this function.
+status_t SerialPacketizer::send_framing_packet(const uint8_t *frame, uint32_t frameSize)
+{
+    m_lastFrame = frame;
+    m_lastFrameSize = frameSize;
+
+    status_t status = m_peripheral->write(frame, frameSize);
     if (status != kStatus_Success)
     {
         return status;
     }
 
-    return wait_for_ack_packet();
+    std::chrono::steady_clock::time_point writeTime = std::chrono::steady_clock::now();
+    status = wait_for_ack_packet();
+    if (status == kStatus_Success)
+    {
+        m_latencyStats.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - writeTime)
+                .count());
+    }
+    if (m_isPacedWrite && (m_isNakReceived || (status == kStatus_Timeout)))
+    {
+        // The gap may have been too short. A NAK shows that the receiver only caught part of
+        // the packet, and wait_for_ack_packet() has sent it again. Without an ACK or a NAK the
+        // packet is not sent again, as the receiver may have taken it and only the ACK been lost.
+        update_back_to_back_delay(false);
+    }
+    else if (m_isDataAfterSync && (status == kStatus_Success))
+    {
+        update_back_to_back_delay(true);
+    }
+
+    return status;
+}
+
+//! Only command packets are preceded by probes, because the receiver accepts a
+//! ping only while it waits for a command. A ping in the data phase would abort
+//! it. Data packets follow a gap learned from earlier data packets instead, see
+//! update_back_to_back_delay().
+//!
+//! Adaptive pacing is only used with UART peripherals. The bus peripherals read
+//! the receiver with their own timing, so they keep the fixed delay.
+void SerialPacketizer::wait_for_receiver_ready(packet_type_t packetType)
+{
+    if (!m_isAdaptiveBackToBack || (m_peripheral->get_type() != Peripheral::kHostPeripheralType_UART))
+    {
+        host_delay(m_backToBackDelayMs);
+        return;
+    }
+
+    uint64_t maxDelayUs = (uint64_t)m_backToBackDelayMs * 1000;
+    if (packetType != kPacketType_Command)
+    {
+        wait_since_sync(m_dataGapUs);
+        m_isDataAfterSync = true;
+        m_isPacedWrite = (m_dataGapUs < maxDelayUs);
+        return;
+    }
+
+    if (m_learnSampleCount >= kBackToBackLearnSamples)
+    {
+        wait_since_sync(m_learnedGapUs);
+        m_isPacedWrite = true;
+        return;
+    }
+
+    // Probe until the receiver answers or the maximum delay has passed. A receiver that is
+    // not reading yet drops the probe, so each probe only waits for an answer as long as the
+    // ping and its response take on the line plus a backoff that doubles from 1 ms.
+    UartPeripheral *peripheral = getPeripheral();
+    uint32_t lineTimeMs = 0;
+    if (peripheral && (peripheral->getSpeed() > 0))
+    {
+        // Ten bits per byte.
+        uint32_t byteCount = sizeof(framing_header_t) * 2 + sizeof(ping_response_t);
+        lineTimeMs = (uint32_t)((byteCount * 10 * 1000 + peripheral->getSpeed() - 1) / peripheral->getSpeed());
+    }
+    uint32_t backoffMs = 1;
+    for (;;)
+    {
+        uint64_t probeTimeUs = get_time_since_sync_us();
+        if (probe_receiver(lineTimeMs + backoffMs))
+        {
+            m_learnedGapUs = std::max(m_learnedGapUs, (uint32_t)std::min<uint64_t>(probeTimeUs, maxDelayUs) +
+                                                          kBackToBackMarginUs);
+            if (++m_learnSampleCount == kBackToBackLearnSamples)
+            {
+                Log::debug("Learned back-to-back command gap of %d us\n", m_learnedGapUs);
+            }
+            return;
+        }
+
+        if (get_time_since_sync_us() >= maxDelayUs)
+        {
+            Log::debug("Receiver did not answer back-to-back write probes within %d ms\n", m_backToBackDelayMs);
+            return;
+        }
+
+        backoffMs = std::min<uint32_t>(backoffMs * 2, kBackToBackMaxBackoffMs);
+    }
+}
+
+// See SerialPacketizer.h for documentation on this function.
+void SerialPacketizer::wait_since_sync(uint64_t gapUs)
+{
+    uint64_t elapsedUs = get_time_since_sync_us();
+    if (elapsedUs < gapUs)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(gapUs - elapsedUs));
+    }
+}
+
+//! A late response to an earlier probe may arrive at any time afterwards. It is
+//! taken as the answer to a later probe, as it shows that the receiver is
+//! reading, and packet readers skip the ones that are left.
+bool SerialPacketizer::probe_receiver(uint32_t waitMs)
+{
+    const uint8_t ping[] = { kFramingPacketStartByte, kFramingPacketType_Ping };
+    if (m_peripheral->write(ping, sizeof(ping)) != kStatus_Success)
+    {
+        return false;
+    }
+
+    Deadline deadline(waitMs);
+    framing_header_t header;
+    for (int i = 0; i < kHostMaxStartByteReadCount; ++i)
+    {
+        if (read_bytes(&header.startByte, 1, deadline) != kStatus_Success)
+        {
+            return false;
+        }
+        if (header.startByte == kFramingPacketStartByte)
+        {
+            break;
+        }
+    }
+    if (header.startByte != kFramingPacketStartByte)
+    {
+        return false;
+    }
+
+    if ((read_bytes(&header.packetType, sizeof(header.packetType), deadline) != kStatus_Success) ||
+        (header.packetType != kFramingPacketType_PingResponse))
+    {
+        return false;
+    }
+
+    return (skip_ping_response(deadline) == kStatus_Success);
+}
+
+//! A command packet the receiver missed makes it learn the command gap again by
+//! probing. For data packets the gap is halved after every acknowledged packet,
+//! down to the shortest gap that has worked. A data packet that is NAKed or not
+//! answered sets that floor to twice the gap that was too short.
+void SerialPacketizer::update_back_to_back_delay(bool isAcked)
+{
+    uint32_t maxDelayUs = m_backToBackDelayMs * 1000;
+    if (!m_isDataAfterSync)
+    {
+        if (!isAcked)
+        {
+            m_learnedGapUs = 0;
+            m_learnSampleCount = 0;
+        }
+        return;
+    }
+
+    if (isAcked)
+    {
+        m_dataGapUs = std::min(std::max(m_dataGapUs / 2, m_dataGapFloorUs), maxDelayUs);
+    }
+    else
+    {
+        m_dataGapFloorUs = std::min(m_dataGapUs * 2, maxDelayUs);
+        m_dataGapUs = m_dataGapFloorUs;
+        Log::debug("Back-to-back data gap raised to %d us\n", m_dataGapUs);
+    }
+}
+
+// See SerialPacketizer.h for documentation on this function.
+status_t SerialPacketizer::skip_ping_response(const Deadline &deadline)
+{
+    ping_response_t response;
+    return read_bytes((uint8_t *)&response, sizeof(response), deadline);
+}
+
+// See SerialPacketizer.h for documentation on this function.
+uint64_t SerialPacketizer::get_time_since_sync_us() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_lastSyncTime)
+        .count();
 }
 
 // See SerialPacketizer.h for documentation on this function.
@@ -401,6 +737,7 @@ status_t SerialPacketizer::serial_packet_send_sync(uint8_t framingPacketType)
     m_serialContext.isBackToBackWrite = true;
 
     status_t status = m_peripheral->write((uint8_t *)&sync, sizeof(sync));
+    m_lastSyncTime = std::chrono::steady_clock::now();
     if (status != kStatus_Success)
     {
         Log::error("Error: cannot send sync packet 0x%x, status = 0x%x\r\n", framingPacketType, status);
@@ -414,11 +751,21 @@ status_t SerialPacketizer::wait_for_ack_packet()
 {
     framing_sync_packet_t sync;
     status_t status = kStatus_NoCommandResponse;
+    m_isNakReceived = false;
 
     do
     {
-        // Receive the sync packet.
-        status = read_header(&sync.header);
+        // Receive the sync packet, skipping late responses to back-to-back write probes.
+        Deadline deadline = getPacketDeadline();
+        status = read_header(&sync.header, deadline);
+        while ((status == kStatus_Success) && (sync.header.packetType == kFramingPacketType_PingResponse))
+        {
+            status = skip_ping_response(deadline);
+            if (status == kStatus_Success)
+            {
+                status = read_header(&sync.header, deadline);
+            }
+        }
         if (status != kStatus_Success)
         {
             break;
@@ -441,13 +788,13 @@ status_t SerialPacketizer::wait_for_ack_packet()
 
         if (sync.header.packetType == kFramingPacketType_Nak)
         {
+            m_isNakReceived = true;
+
 // Re-transmit the last packet.
 #if defined(TEST_NAK)
-            --g_serialContext.framingPacket.dataPacket.crc16;
+            --((framing_data_packet_t *)m_lastFrame)->crc16;
 #endif // TEST_NAK
-            status =
-                m_peripheral->write((uint8_t *)&m_serialContext.framingPacket,
-                                    sizeof(framing_data_packet_t) + m_serialContext.framingPacket.dataPacket.length);
+            status = m_peripheral->write(m_lastFrame, m_lastFrameSize);
             if (status != kStatus_Success)
             {
                 break;
@@ -467,9 +814,11 @@ status_t SerialPacketizer::serial_send_ping_response()
     // Only reply if we're in an idle state
     if (!m_serialContext.isAckNeeded || !m_serialContext.isBackToBackWrite || !m_serialContext.isAckAbortNeeded)
     {
-        const uint8_t header[] = { kFramingPacketStartByte, kFramingPacketType_PingResponse };
-        m_peripheral->write((const uint8_t *)&header, sizeof(header));
-        m_peripheral->write((uint8_t *)&k_PingResponse, sizeof(k_PingResponse));
+        // The header and the response go in one write, which bus peripherals send in one transfer.
+        uint8_t response[sizeof(framing_header_t) + sizeof(k_PingResponse)] = { kFramingPacketStartByte,
+                                                                                kFramingPacketType_PingResponse };
+        memcpy(&response[sizeof(framing_header_t)], &k_PingResponse, sizeof(k_PingResponse));
+        m_peripheral->write(response, sizeof(response));
     }
 
     return kStatus_Ping;
@@ -497,10 +846,21 @@ status_t SerialPacketizer::send_deferred_ack()
 }
 
 // See SerialPacketizer.h for documentation on this function.
-status_t SerialPacketizer::read_data_packet(framing_data_packet_t *packet, uint8_t *data, packet_type_t packetType)
+status_t SerialPacketizer::read_data_packet(framing_data_packet_t *packet,
+                                            uint8_t *data,
+                                            packet_type_t packetType,
+                                            const Deadline &deadline)
 {
-    // Read the packet header.
-    status_t status = read_header(&packet->header);
+    // Read the packet header, skipping late responses to back-to-back write probes.
+    status_t status = read_header(&packet->header, deadline);
+    while ((status == kStatus_Success) && (packet->header.packetType == kFramingPacketType_PingResponse))
+    {
+        status = skip_ping_response(deadline);
+        if (status == kStatus_Success)
+        {
+            status = read_header(&packet->header, deadline);
+        }
+    }
     if (status != kStatus_Success)
     {
         return status;
@@ -524,7 +884,7 @@ status_t SerialPacketizer::read_data_packet(framing_data_packet_t *packet, uint8
     }
 
     // Read the packet length.
-    status = read_length(packet);
+    status = read_length(packet, deadline);
     if (status != kStatus_Success)
     {
         return status;
@@ -539,7 +899,7 @@ status_t SerialPacketizer::read_data_packet(framing_data_packet_t *packet, uint8
     }
 
     // Read the crc
-    status = read_crc16(packet);
+    status = read_crc16(packet, deadline);
     if (status != kStatus_Success)
     {
         return status;
@@ -551,24 +911,33 @@ status_t SerialPacketizer::read_data_packet(framing_data_packet_t *packet, uint8
         // Clear the data area so unsent parameters default to zero.
         memset(data, 0, packet->length);
 
-        status = m_peripheral->read(data, packet->length, NULL, UartPeripheral::kUartPeripheral_UnusedTimeout);
+        status = read_bytes(data, packet->length, deadline);
     }
 
     return status;
 }
 
 // See SerialPacketizer.h for documentation on this function.
-status_t SerialPacketizer::read_start_byte(framing_header_t *header)
+status_t SerialPacketizer::read_bytes(uint8_t *buffer, uint32_t byteCount, const Deadline &deadline)
 {
-    double timeout = (double)m_packetTimeoutMs / 1000;
-    double duration = 0.0;
-    clock_t start = clock();
+    uint32_t timeoutMs = deadline.getRemainingMs();
+    if (timeoutMs == 0)
+    {
+        return kStatus_Timeout;
+    }
+
+    return m_peripheral->read(buffer, byteCount, NULL, timeoutMs);
+}
+
+// See SerialPacketizer.h for documentation on this function.
+status_t SerialPacketizer::read_start_byte(framing_header_t *header, const Deadline &deadline)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
     // Read until start byte found.
-    while (duration < timeout)
+    while (!deadline.isExpired())
     {
-        status_t status =
-            m_peripheral->read(&header->startByte, 1, NULL, UartPeripheral::kUartPeripheral_UnusedTimeout);
+        status_t status = read_bytes(&header->startByte, 1, deadline);
         if (status != kStatus_Success && status != kStatus_Timeout)
         {
             return status;
@@ -581,37 +950,36 @@ status_t SerialPacketizer::read_start_byte(framing_header_t *header)
                 return kStatus_Success;
             }
         }
-
-        // This will keep us from doing non necessary delays in case the byte received
-        // is actually the start byte, this delay and retry scenario is for cases when waiting
-        // for a response from a device that was issued a long running command like a flash-erase-region
-        // that may take several seconds to complete.
-        host_delay(kDefaultByteReadTimeoutMs);
-
-        // Windows: CLOCKS_PER_SEC = 1,000, Linux & MACOSX: CLOCKS_PER_SEC = 1,000,000.
-        duration = (double)(clock() - start) / CLOCKS_PER_SEC;
+        else
+        {
+            // Peripherals that do not wait for data return at once, so poll them until the
+            // deadline. This is for cases when waiting for a response from a device that was
+            // issued a long running command like a flash-erase-region that may take several
+            // seconds to complete.
+            host_delay(std::min<uint32_t>(kDefaultByteReadTimeoutMs, deadline.getRemainingMs()));
+        }
     }
 
-    Log::error("Error: read_start_byte() timeout after %2.3f seconds\n", duration);
+    Log::error("Error: read_start_byte() timeout after %2.3f seconds\n",
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
     return kStatus_Timeout;
 }
 
 // See SerialPacketizer.h for documentation on this function.
-status_t SerialPacketizer::read_header(framing_header_t *header)
+status_t SerialPacketizer::read_header(framing_header_t *header, const Deadline &deadline)
 {
     // Wait for start byte.
-    status_t status = read_start_byte(header);
+    status_t status = read_start_byte(header, deadline);
     if (status != kStatus_Success)
     {
         return status;
     }
 
-    return m_peripheral->read(&header->packetType, sizeof(header->packetType), NULL,
-                              UartPeripheral::kUartPeripheral_UnusedTimeout);
+    return read_bytes(&header->packetType, sizeof(header->packetType), deadline);
 }
 
 // See SerialPacketizer.h for documentation on this function.
-status_t SerialPacketizer::read_length(framing_data_packet_t *packet)
+status_t SerialPacketizer::read_length(framing_data_packet_t *packet, const Deadline &deadline)
 {
     union
     {
@@ -619,15 +987,14 @@ status_t SerialPacketizer::read_length(framing_data_packet_t *packet)
         uint16_t halfword;
     } buffer;
 
-    status_t status = m_peripheral->read((uint8_t *)&buffer.bytes, sizeof(buffer), NULL,
-                                         UartPeripheral::kUartPeripheral_UnusedTimeout);
+    status_t status = read_bytes((uint8_t *)&buffer.bytes, sizeof(buffer), deadline);
 
     packet->length = buffer.halfword;
     return status;
 }
 
 // See SerialPacketizer.h for documentation on this function.
-status_t SerialPacketizer::read_crc16(framing_data_packet_t *packet)
+status_t SerialPacketizer::read_crc16(framing_data_packet_t *packet, const Deadline &deadline)
 {
     union
     {
@@ -635,8 +1002,7 @@ status_t SerialPacketizer::read_crc16(framing_data_packet_t *packet)
         uint16_t halfword;
     } buffer;
 
-    status_t status = m_peripheral->read((uint8_t *)&buffer.bytes, sizeof(buffer), NULL,
-                                         UartPeripheral::kUartPeripheral_UnusedTimeout);
+    status_t status = read_bytes((uint8_t *)&buffer.bytes, sizeof(buffer), deadline);
 
     packet->crc16 = buffer.halfword;
     return status;
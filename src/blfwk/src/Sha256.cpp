@@ -0,0 +1,170 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/Sha256.h"
+#include <string.h>
+
+using namespace blfwk;
+
+//! Round constants, the first 32 bits of the fractional parts of the cube roots of the first 64 primes.
+static const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+//! \brief Rotates \a value right by \a count bits.
+static inline uint32_t rotateRight(uint32_t value, unsigned count)
+{
+    return (value >> count) | (value << (32 - count));
+}
+
+Sha256::Sha256()
+    : m_length(0)
+    , m_blockLength(0)
+{
+    m_state[0] = 0x6a09e667;
+    m_state[1] = 0xbb67ae85;
+    m_state[2] = 0x3c6ef372;
+    m_state[3] = 0xa54ff53a;
+    m_state[4] = 0x510e527f;
+    m_state[5] = 0x9b05688c;
+    m_state[6] = 0x1f83d9ab;
+    m_state[7] = 0x5be0cd19;
+}
+
+void Sha256::update(const void *data, size_t length)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    m_length += length;
+
+    // Complete a partial block first.
+    if (m_blockLength)
+    {
+        size_t copyBytes = sizeof(m_block) - m_blockLength;
+        if (copyBytes > length)
+        {
+            copyBytes = length;
+        }
+        memcpy(m_block + m_blockLength, bytes, copyBytes);
+        m_blockLength += copyBytes;
+        bytes += copyBytes;
+        length -= copyBytes;
+        if (m_blockLength < sizeof(m_block))
+        {
+            return;
+        }
+        processBlock(m_block);
+        m_blockLength = 0;
+    }
+
+    // Whole blocks are processed in place.
+    while (length >= sizeof(m_block))
+    {
+        processBlock(bytes);
+        bytes += sizeof(m_block);
+        length -= sizeof(m_block);
+    }
+
+    memcpy(m_block, bytes, length);
+    m_blockLength = length;
+}
+
+void Sha256::finish(uint8_t *digest)
+{
+    // Pad with a 1 bit, zeros and the message length in bits, to a whole number of blocks.
+    uint64_t bitLength = m_length * 8;
+    uint8_t padding[sizeof(m_block) + 8];
+    size_t paddingLength = ((m_blockLength < 56) ? 56 : 120) - m_blockLength;
+    memset(padding, 0, sizeof(padding));
+    padding[0] = 0x80;
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        padding[paddingLength + i] = static_cast<uint8_t>(bitLength >> (56 - i * 8));
+    }
+    update(padding, paddingLength + 8);
+
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        digest[i * 4] = static_cast<uint8_t>(m_state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+    }
+}
+
+std::string Sha256::finishHex()
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    uint8_t digest[kDigestSize];
+    finish(digest);
+
+    std::string hex;
+    for (size_t i = 0; i < kDigestSize; ++i)
+    {
+        hex += kHexDigits[digest[i] >> 4];
+        hex += kHexDigits[digest[i] & 0xf];
+    }
+    return hex;
+}
+
+void Sha256::processBlock(const uint8_t *block)
+{
+    uint32_t schedule[64];
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        schedule[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+                      ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (unsigned i = 16; i < 64; ++i)
+    {
+        uint32_t s0 = rotateRight(schedule[i - 15], 7) ^ rotateRight(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+        uint32_t s1 = rotateRight(schedule[i - 2], 17) ^ rotateRight(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+        schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+    }
+
+    uint32_t a = m_state[0];
+    uint32_t b = m_state[1];
+    uint32_t c = m_state[2];
+    uint32_t d = m_state[3];
+    uint32_t e = m_state[4];
+    uint32_t f = m_state[5];
+    uint32_t g = m_state[6];
+    uint32_t h = m_state[7];
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        uint32_t choice = (e & f) ^ (~e & g);
+        uint32_t temp1 = h + s1 + choice + kRoundConstants[i] + schedule[i];
+        uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
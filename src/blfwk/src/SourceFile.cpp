@@ -10,6 +10,7 @@
 
 #include "blfwk/ELFSourceFile.h"
 #include "blfwk/EndianUtilities.h"
+#include "blfwk/InputStream.h"
 #include "blfwk/IntelHexSourceFile.h"
 #include "blfwk/SBSourceFile.h"
 #include "blfwk/SRecordSourceFile.h"
@@ -89,6 +90,45 @@ SourceFile *SourceFile::openFile(const std::string &path)
     }
 }
 
+//! The standard input, pipes and compressed files are read sequentially, so only
+//! formats that can be parsed line by line are supported. The format is detected
+//! from the first character of the decompressed data. The caller owns the returned
+//! object.
+//!
+//! \exception std::runtime_error Thrown if the input cannot be read, or is not an
+//!     S-record or Intel Hex file.
+StreamingDataSource *SourceFile::openStream(const std::string &path)
+{
+    smart_ptr<InputStream> input(InputStream::open(path));
+
+    // Skip leading white space to find the first character of the first record.
+    std::vector<uint8_t> start(1);
+    while (input->peek(&start[0], start.size()) == start.size() && isspace(start.back()))
+    {
+        start.push_back(0);
+    }
+    uint8_t firstChar = start.back();
+
+    InputStream *stream = input.get();
+    if (firstChar == 'S')
+    {
+        input.reset();
+        return SRecordSourceFile::createStreamingDataSource(stream);
+    }
+    else if (firstChar == ':')
+    {
+        input.reset();
+        return IntelHexSourceFile::createStreamingDataSource(stream);
+    }
+    else if (firstChar == 0x7f)
+    {
+        throw std::runtime_error(
+            format_string("%s: ELF files cannot be streamed, use an uncompressed file", path.c_str()));
+    }
+
+    throw std::runtime_error(format_string("%s: only S-record and Intel Hex data can be streamed", path.c_str()));
+}
+
 SourceFile::SourceFile(const std::string &path, source_file_t filetype)
     : m_path(path)
     , m_filetype(filetype)
@@ -98,7 +138,7 @@ SourceFile::SourceFile(const std::string &path, source_file_t filetype)
     open();
     assert(m_stream);
     m_stream->seekg(0, std::ios_base::end);
-    m_size = (unsigned)m_stream->tellg();
+    m_size = (uint64_t)m_stream->tellg();
     close();
 }
 
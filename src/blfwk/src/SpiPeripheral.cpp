@@ -10,6 +10,8 @@
 #include "blfwk/SpiPeripheral.h"
 #include "blfwk/format_string.h"
 #include "blfwk/spi.h"
+#include <string.h>
+#include <algorithm>
 
 using namespace blfwk;
 
@@ -20,6 +22,8 @@ using namespace blfwk;
 // See SpiPeripheral.h for documentation of this method.
 SpiPeripheral::SpiPeripheral(const char *port, long speed, uint8_t polarity, uint8_t phase, uint8_t sequence)
     : m_fileDescriptor(-1)
+    , m_rxCount(0)
+    , m_rxOffset(0)
 {
     if (!init(port, speed, polarity, phase, sequence))
     {
@@ -107,8 +111,27 @@ status_t SpiPeripheral::read(uint8_t *buffer, uint32_t requestedBytes, uint32_t
 {
     assert(buffer);
 
-    // Read the requested number of bytes.
-    int count = spi_read(m_fileDescriptor, reinterpret_cast<char *>(buffer), requestedBytes);
+    // Take the bytes clocked in ahead by an earlier read first.
+    uint32_t count = std::min(requestedBytes, m_rxCount - m_rxOffset);
+    memcpy(buffer, &m_rxBuffer[m_rxOffset], count);
+    m_rxOffset += count;
+
+    uint32_t remaining = requestedBytes - count;
+    if (remaining >= kSpiPeripheral_ReadBurstBytes)
+    {
+        // Payloads are read in one transfer of their own size.
+        int received = spi_read(m_fileDescriptor, reinterpret_cast<char *>(buffer + count), remaining);
+        count += (received > 0) ? received : 0;
+    }
+    else if (remaining)
+    {
+        // Header fields are read as a whole header, which usually brings the next fields along.
+        int received = spi_read(m_fileDescriptor, reinterpret_cast<char *>(m_rxBuffer), sizeof(m_rxBuffer));
+        m_rxCount = (received > 0) ? received : 0;
+        m_rxOffset = std::min(remaining, m_rxCount);
+        memcpy(buffer + count, m_rxBuffer, m_rxOffset);
+        count += m_rxOffset;
+    }
     if (actualBytes)
     {
         *actualBytes = count;
@@ -121,7 +144,7 @@ status_t SpiPeripheral::read(uint8_t *buffer, uint32_t requestedBytes, uint32_t
         for (int i = 0; i < (int)count; i++)
         {
             Log::debug2("%02x", buffer[i]);
-            if (i != (count - 1))
+            if (i != ((int)count - 1))
             {
                 Log::debug2(" ");
             }
@@ -129,7 +152,7 @@ status_t SpiPeripheral::read(uint8_t *buffer, uint32_t requestedBytes, uint32_t
         Log::debug2(">\n");
     }
 
-    if (count < (int)requestedBytes)
+    if (count < requestedBytes)
     {
         // Anything less than requestedBytes is a timeout error.
         return kStatus_Timeout;
@@ -139,7 +162,11 @@ status_t SpiPeripheral::read(uint8_t *buffer, uint32_t requestedBytes, uint32_t
 }
 
 // See SpiPeripheral.h for documentation of this method.
-void SpiPeripheral::flushRX() {}
+void SpiPeripheral::flushRX()
+{
+    m_rxCount = 0;
+    m_rxOffset = 0;
+}
 
 // See SpiPeripheral.h for documentation of this method.
 status_t SpiPeripheral::write(const uint8_t *buffer, uint32_t byteCount)
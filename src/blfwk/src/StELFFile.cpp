@@ -10,6 +10,7 @@
 #include <ios>
 #include <stdexcept>
 #include <stdio.h>
+#include <string.h>
 
 #include "blfwk/StELFFile.h"
 #include "blfwk/EndianUtilities.h"
@@ -17,12 +18,35 @@
 //! \exception StELFFileException is thrown if there is a problem with the file format.
 //!
 StELFFile::StELFFile(std::istream &inStream)
-    : m_stream(inStream)
+    : m_stream(&inStream)
+    , m_mappedData(NULL)
+    , m_mappedSize(0)
     , m_elfVariant(eIllegalVariant)
+    , m_symbolTableIndex(SHN_UNDEF)
 {
     readFileHeaders();
 }
 
+//! The memory pointed to by \a inData is not copied, and must remain valid until the
+//! object is destroyed.
+//!
+//! \exception StELFFileException is thrown if there is a problem with the file format.
+//!
+StELFFile::StELFFile(const uint8_t *inData, size_t inSize)
+    : m_stream(NULL)
+    , m_mappedData(inData)
+    , m_mappedSize(inSize)
+    , m_elfVariant(eIllegalVariant)
+    , m_symbolTableIndex(SHN_UNDEF)
+{
+    if (m_mappedData == NULL)
+    {
+        throw StELFFileException("could not read file header");
+    }
+
+    readFileHeaders();
+}
+
 //! Disposes of the string table data.
 StELFFile::~StELFFile()
 {
@@ -30,25 +54,93 @@ StELFFile::~StELFFile()
     for (; it != m_sectionDataCache.end(); ++it)
     {
         SectionDataInfo &info = it->second;
-        if (info.m_data != NULL)
+        if (info.m_data != NULL && info.m_owned)
+        {
+            delete[] info.m_data;
+        }
+    }
+
+    for (it = m_segmentDataCache.begin(); it != m_segmentDataCache.end(); ++it)
+    {
+        SectionDataInfo &info = it->second;
+        if (info.m_data != NULL && info.m_owned)
         {
             delete[] info.m_data;
         }
     }
 }
 
+//! \exception StELFFileException is thrown if the requested range cannot be read.
+void StELFFile::readBytes(uint32_t inOffset, uint32_t inLength, void *outData)
+{
+    if (isMapped())
+    {
+        if ((uint64_t)inOffset + inLength > m_mappedSize)
+        {
+            throw StELFFileException("unexpected end of file");
+        }
+        memcpy(outData, m_mappedData + inOffset, inLength);
+    }
+    else
+    {
+        m_stream->seekg(inOffset, std::ios::beg);
+        m_stream->read(reinterpret_cast<char *>(outData), inLength);
+        if (m_stream->bad())
+        {
+            throw StELFFileException("could not read file");
+        }
+    }
+}
+
+//! When parsing a memory image the returned pointer points directly into the image.
+//! Otherwise the whole table is read from the stream into \a buffer at once, instead of
+//! seeking and reading once per entry.
+//!
+//! \exception StELFFileException is thrown if the table cannot be read.
+const uint8_t *StELFFile::readTable(uint32_t inOffset,
+                                    unsigned inEntrySize,
+                                    unsigned inCount,
+                                    std::vector<uint8_t> &buffer)
+{
+    uint32_t length = inEntrySize * inCount;
+
+    if (isMapped())
+    {
+        if ((uint64_t)inOffset + length > m_mappedSize)
+        {
+            throw StELFFileException("header table extends past end of file");
+        }
+        return m_mappedData + inOffset;
+    }
+
+    buffer.resize(length);
+    readBytes(inOffset, length, &buffer[0]);
+    return &buffer[0];
+}
+
 //! \exception StELFFileException is thrown if the file is not an ELF file.
 //!
 void StELFFile::readFileHeaders()
 {
-    // move read head to beginning of stream
-    m_stream.seekg(0, std::ios_base::beg);
-
     // read ELF header
-    m_stream.read(reinterpret_cast<char *>(&m_header), sizeof(m_header));
-    if (m_stream.bad())
+    if (isMapped())
     {
-        throw StELFFileException("could not read file header");
+        if (m_mappedSize < sizeof(m_header))
+        {
+            throw StELFFileException("could not read file header");
+        }
+        memcpy(&m_header, m_mappedData, sizeof(m_header));
+    }
+    else
+    {
+        // move read head to beginning of stream
+        m_stream->seekg(0, std::ios_base::beg);
+
+        m_stream->read(reinterpret_cast<char *>(&m_header), sizeof(m_header));
+        if (m_stream->bad())
+        {
+            throw StELFFileException("could not read file header");
+        }
     }
 
     // convert endianness
@@ -77,18 +169,23 @@ void StELFFile::readFileHeaders()
     {
         int i;
 
+        std::vector<uint8_t> tableBuffer;
+
         // read section headers
         if (m_header.e_shoff != 0 && m_header.e_shnum > 0)
         {
+            if (m_header.e_shentsize < sizeof(Elf32_Shdr))
+            {
+                throw StELFFileException("invalid section header size");
+            }
+
+            const uint8_t *table = readTable(m_header.e_shoff, m_header.e_shentsize, m_header.e_shnum, tableBuffer);
+            m_sectionHeaders.reserve(m_header.e_shnum);
+
             Elf32_Shdr sectionHeader;
             for (i = 0; i < m_header.e_shnum; ++i)
             {
-                m_stream.seekg(m_header.e_shoff + m_header.e_shentsize * i, std::ios::beg);
-                m_stream.read(reinterpret_cast<char *>(&sectionHeader), sizeof(sectionHeader));
-                if (m_stream.bad())
-                {
-                    throw StELFFileException("could not read section header");
-                }
+                memcpy(&sectionHeader, table + m_header.e_shentsize * i, sizeof(sectionHeader));
 
                 // convert endianness
                 sectionHeader.sh_name = ENDIAN_LITTLE_TO_HOST_U32(sectionHeader.sh_name);
@@ -109,19 +206,22 @@ void StELFFile::readFileHeaders()
         // read program headers
         if (m_header.e_phoff != 0 && m_header.e_phnum > 0)
         {
+            if (m_header.e_phentsize < sizeof(Elf32_Phdr))
+            {
+                throw StELFFileException("invalid program header size");
+            }
+
+            const uint8_t *table = readTable(m_header.e_phoff, m_header.e_phentsize, m_header.e_phnum, tableBuffer);
+            m_programHeaders.reserve(m_header.e_phnum);
+
             Elf32_Phdr programHeader;
             for (i = 0; i < m_header.e_phnum; ++i)
             {
-                m_stream.seekg(m_header.e_phoff + m_header.e_phentsize * i, std::ios::beg);
-                m_stream.read(reinterpret_cast<char *>(&programHeader), sizeof(programHeader));
-                if (m_stream.bad())
-                {
-                    throw StELFFileException("could not read program header");
-                }
+                memcpy(&programHeader, table + m_header.e_phentsize * i, sizeof(programHeader));
 
                 // convert endianness
                 programHeader.p_type = ENDIAN_LITTLE_TO_HOST_U32(programHeader.p_type);
-                programHeader.p_offset = ENDIAN_LITTLE_TO_HOST_U32(programHeader.p_type);
+                programHeader.p_offset = ENDIAN_LITTLE_TO_HOST_U32(programHeader.p_offset);
                 programHeader.p_vaddr = ENDIAN_LITTLE_TO_HOST_U32(programHeader.p_vaddr);
                 programHeader.p_paddr = ENDIAN_LITTLE_TO_HOST_U32(programHeader.p_paddr);
                 programHeader.p_filesz = ENDIAN_LITTLE_TO_HOST_U32(programHeader.p_filesz);
@@ -202,6 +302,32 @@ uint8_t *StELFFile::getSectionData(const_section_iterator inSection)
     return readSectionData(*inSection);
 }
 
+//! Unlike getSectionDataAtIndex(), the returned pointer is owned by this object and must
+//! not be freed. When parsing a memory image it points directly into the image, so no
+//! data is copied and nothing is read until the bytes are actually accessed. When parsing
+//! a stream the section is read once and then cached for the life of the object.
+//!
+//! If either the section data offset (sh_offset) or the section size (sh_size) are 0, then
+//! NULL will be returned instead.
+//!
+//! \exception StELFFileException is thrown if the section data lies outside the file.
+const uint8_t *StELFFile::getSectionDataView(unsigned inIndex)
+{
+    const Elf32_Shdr &header = getSectionAtIndex(inIndex);
+    if (header.sh_offset == 0 || header.sh_size == 0)
+        return NULL;
+
+    if (isMapped())
+    {
+        if ((uint64_t)header.sh_offset + header.sh_size > m_mappedSize)
+            throw StELFFileException("section data extends past end of file");
+
+        return m_mappedData + header.sh_offset;
+    }
+
+    return getCachedSectionData(inIndex).m_data;
+}
+
 //! \exception StELFFileException is thrown if an error occurs while reading the file.
 //! \exception std::bad_alloc is thrown if memory for the data cannot be allocated.
 uint8_t *StELFFile::readSectionData(const Elf32_Shdr &inHeader)
@@ -214,10 +340,7 @@ uint8_t *StELFFile::readSectionData(const Elf32_Shdr &inHeader)
 
     try
     {
-        m_stream.seekg(inHeader.sh_offset, std::ios::beg);
-        m_stream.read(reinterpret_cast<char *>(sectionData), inHeader.sh_size);
-        if (m_stream.bad())
-            throw StELFFileException("could not read entire section");
+        readBytes(inHeader.sh_offset, inHeader.sh_size, sectionData);
     }
     catch (StELFFileException)
     {
@@ -269,6 +392,53 @@ uint8_t *StELFFile::getSegmentData(const_segment_iterator inSegment)
     return readSegmentData(*inSegment);
 }
 
+//! The same rules as for getSectionDataView() apply. The returned pointer is owned by
+//! this object, and when parsing a stream the segment data is read once and cached.
+//!
+//! Unlike getSegmentDataAtIndex(), a segment at file offset 0 is valid here, since the
+//! first loadable segment often includes the ELF headers. NULL is returned if the segment
+//! file size (p_filesz) is 0.
+//!
+//! \exception StELFFileException is thrown if the segment data lies outside the file.
+const uint8_t *StELFFile::getSegmentDataView(unsigned inIndex)
+{
+    const Elf32_Phdr &header = getSegmentAtIndex(inIndex);
+    if (header.p_filesz == 0)
+        return NULL;
+
+    if (isMapped())
+    {
+        if ((uint64_t)header.p_offset + header.p_filesz > m_mappedSize)
+            throw StELFFileException("segment data extends past end of file");
+
+        return m_mappedData + header.p_offset;
+    }
+
+    SectionDataMap::iterator it = m_segmentDataCache.find(inIndex);
+    if (it != m_segmentDataCache.end())
+        return it->second.m_data;
+
+    SectionDataInfo info;
+    info.m_data = new uint8_t[header.p_filesz];
+    info.m_size = header.p_filesz;
+    info.m_swapped = false;
+    info.m_owned = true;
+
+    try
+    {
+        readBytes(header.p_offset, header.p_filesz, info.m_data);
+    }
+    catch (...)
+    {
+        delete[] info.m_data;
+        throw;
+    }
+
+    m_segmentDataCache[inIndex] = info;
+
+    return info.m_data;
+}
+
 //! \exception StELFFileException is thrown if an error occurs while reading the file.
 //! \exception std::bad_alloc is thrown if memory for the data cannot be allocated.
 uint8_t *StELFFile::readSegmentData(const Elf32_Phdr &inHeader)
@@ -281,10 +451,7 @@ uint8_t *StELFFile::readSegmentData(const Elf32_Phdr &inHeader)
 
     try
     {
-        m_stream.seekg(inHeader.p_offset, std::ios::beg);
-        m_stream.read(reinterpret_cast<char *>(segmentData), inHeader.p_filesz);
-        if (m_stream.bad())
-            throw StELFFileException("could not read entire segment");
+        readBytes(inHeader.p_offset, inHeader.p_filesz, segmentData);
     }
     catch (StELFFileException)
     {
@@ -340,13 +507,24 @@ StELFFile::SectionDataInfo &StELFFile::getCachedSectionData(unsigned inSectionIn
 
     // not in cache, add it
     const Elf32_Shdr &header = getSectionAtIndex(inSectionIndex);
-    uint8_t *data = getSectionDataAtIndex(inSectionIndex);
 
     SectionDataInfo info;
-    info.m_data = data;
     info.m_size = header.sh_size;
     info.m_swapped = false;
 
+    // The symbol table is byte swapped in place, so it always needs a private copy. Other
+    // sections of a memory image are used directly.
+    if (isMapped() && inSectionIndex != m_symbolTableIndex)
+    {
+        info.m_data = const_cast<uint8_t *>(getSectionDataView(inSectionIndex));
+        info.m_owned = false;
+    }
+    else
+    {
+        info.m_data = getSectionDataAtIndex(inSectionIndex);
+        info.m_owned = true;
+    }
+
     m_sectionDataCache[inSectionIndex] = info;
     return m_sectionDataCache[inSectionIndex];
 }
@@ -110,8 +110,15 @@ int StIntelHexFile::hexDigitToInt(char digit)
 //!     is not a valid hex digit.
 int StIntelHexFile::readHexByte(std::string &inString, int inIndex)
 {
-    char nibbleCharHi = inString[inIndex];
-    char nibbleCharLo = inString[inIndex + 1];
+    return readHexByte(inString.c_str(), inIndex);
+}
+
+//! \exception StIntelHexParseException is thrown if either of the nibble characters
+//!     is not a valid hex digit.
+int StIntelHexFile::readHexByte(const char *inLine, int inIndex)
+{
+    char nibbleCharHi = inLine[inIndex];
+    char nibbleCharLo = inLine[inIndex + 1];
 
     // must be hex digits
     if (!(isHexDigit(nibbleCharHi) && isHexDigit(nibbleCharLo)))
@@ -130,12 +137,36 @@ int StIntelHexFile::readHexByte(std::string &inString, int inIndex)
 //!     parsing \a inLine.
 void StIntelHexFile::parseLine(std::string &inLine)
 {
-    int checksum = 0;
     IntelHex newRecord;
+    uint8_t data[INTELHEX_MAX_DATA_LENGTH];
+    parseRecord(inLine.c_str(), (unsigned)inLine.length(), newRecord, data);
+
+    if (newRecord.m_data)
+    {
+        newRecord.m_data = new uint8_t[newRecord.m_dataCount];
+        memcpy(newRecord.m_data, data, newRecord.m_dataCount);
+    }
+
+    // now save the new Intel Hex record
+    m_records.push_back(newRecord);
+}
+
+//! The record's data bytes are written to \a outData, which must be at least
+//! #INTELHEX_MAX_DATA_LENGTH bytes. If the record has a data field, the m_data member
+//! of \a outRecord is set to \a outData, otherwise it is NULL. This method does not
+//! allocate memory and does not touch any object state, so it may be called from
+//! multiple threads at once.
+//!
+//! \exception StIntelHexParseException will be thrown if any error occurs while
+//!     parsing \a inLine.
+void StIntelHexFile::parseRecord(const char *inLine, unsigned inLength, IntelHex &outRecord, uint8_t *outData)
+{
+    int checksum = 0;
+    IntelHex &newRecord = outRecord;
     memset(&newRecord, 0, sizeof(newRecord));
 
     // must be at least a certain length
-    if (inLine.length() < INTELHEX_MIN_LENGTH)
+    if (inLength < INTELHEX_MIN_LENGTH)
     {
         throw StIntelHexParseException("invalid record length");
     }
@@ -151,7 +182,7 @@ void StIntelHexFile::parseLine(std::string &inLine)
     checksum += newRecord.m_dataCount;
 
     // verify the record length now that we know the count
-    if (inLine.length() != 11 + newRecord.m_dataCount * 2)
+    if (inLength != 11 + newRecord.m_dataCount * 2)
     {
         throw StIntelHexParseException("invalid record length");
     }
@@ -186,32 +217,20 @@ void StIntelHexFile::parseLine(std::string &inLine)
     // read data
     if (newRecord.m_dataCount)
     {
-        uint8_t *data = new uint8_t[newRecord.m_dataCount];
-        try
+        for (unsigned i = 0; i < newRecord.m_dataCount; ++i)
         {
-            for (unsigned i = 0; i < newRecord.m_dataCount; ++i)
-            {
-                int dataByte = readHexByte(inLine, INTELHEX_DATA_START_CHAR_INDEX + i * 2);
-                data[i] = dataByte;
-                checksum += dataByte;
-            }
-            newRecord.m_data = data;
-        }
-        catch (...)
-        {
-            delete[] data;
-            throw;
+            int dataByte = readHexByte(inLine, INTELHEX_DATA_START_CHAR_INDEX + i * 2);
+            outData[i] = dataByte;
+            checksum += dataByte;
         }
+        newRecord.m_data = outData;
     }
 
     // read and compare checksum byte
     checksum = (~checksum + 1) & 0xff; // low byte of one's complement of sum of other bytes
-    newRecord.m_checksum = readHexByte(inLine, (int)inLine.length() - 2);
+    newRecord.m_checksum = readHexByte(inLine, (int)inLength - 2);
     if (checksum != newRecord.m_checksum)
     {
         throw StIntelHexParseException("invalid checksum");
     }
-
-    // now save the new Intel Hex record
-    m_records.push_back(newRecord);
 }
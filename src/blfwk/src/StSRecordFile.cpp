@@ -111,8 +111,15 @@ int StSRecordFile::hexDigitToInt(char digit)
 //!     is not a valid hex digit.
 int StSRecordFile::readHexByte(std::string &inString, int inIndex)
 {
-    char nibbleCharHi = inString[inIndex];
-    char nibbleCharLo = inString[inIndex + 1];
+    return readHexByte(inString.c_str(), inIndex);
+}
+
+//! \exception StSRecordParseException is thrown if either of the nibble characters
+//!     is not a valid hex digit.
+int StSRecordFile::readHexByte(const char *inLine, int inIndex)
+{
+    char nibbleCharHi = inLine[inIndex];
+    char nibbleCharLo = inLine[inIndex + 1];
 
     // must be hex digits
     if (!(isHexDigit(nibbleCharHi) && isHexDigit(nibbleCharLo)))
@@ -131,12 +138,36 @@ int StSRecordFile::readHexByte(std::string &inString, int inIndex)
 //!     parsing \a inLine.
 void StSRecordFile::parseLine(std::string &inLine)
 {
-    int checksum = 0;
     SRecord newRecord;
+    uint8_t data[SRECORD_MAX_DATA_LENGTH];
+    parseRecord(inLine.c_str(), (unsigned)inLine.length(), newRecord, data);
+
+    if (newRecord.m_data)
+    {
+        newRecord.m_data = new uint8_t[newRecord.m_dataCount];
+        memcpy(newRecord.m_data, data, newRecord.m_dataCount);
+    }
+
+    // now save the new S-record
+    m_records.push_back(newRecord);
+}
+
+//! The record's data bytes are written to \a outData, which must be at least
+//! #SRECORD_MAX_DATA_LENGTH bytes. If the record has a data field, the m_data member
+//! of \a outRecord is set to \a outData, otherwise it is NULL. This method does not
+//! allocate memory and does not touch any object state, so it may be called from
+//! multiple threads at once.
+//!
+//! \exception StSRecordParseException will be thrown if any error occurs while
+//!     parsing \a inLine.
+void StSRecordFile::parseRecord(const char *inLine, unsigned inLength, SRecord &outRecord, uint8_t *outData)
+{
+    int checksum = 0;
+    SRecord &newRecord = outRecord;
     memset(&newRecord, 0, sizeof(newRecord));
 
     // must be at least a certain length
-    if (inLine.length() < SRECORD_MIN_LENGTH)
+    if (inLength < SRECORD_MIN_LENGTH)
     {
         throw StSRecordParseException("invalid record length");
     }
@@ -159,7 +190,7 @@ void StSRecordFile::parseLine(std::string &inLine)
     checksum += newRecord.m_count;
 
     // verify the record length now that we know the count
-    if (inLine.length() != 4 + newRecord.m_count * 2)
+    if (inLength != 4 + newRecord.m_count * 2)
     {
         throw StSRecordParseException("invalid record length");
     }
@@ -203,8 +234,14 @@ void StSRecordFile::parseLine(std::string &inLine)
             break;
     }
 
+    // the count must cover at least the address and checksum
+    if ((int)newRecord.m_count < addressLength + 1)
+    {
+        throw StSRecordParseException("invalid record length");
+    }
+
     // read address
-    int address = 0;
+    uint32_t address = 0;
     int i;
     for (i = 0; i < addressLength; ++i)
     {
@@ -219,33 +256,21 @@ void StSRecordFile::parseLine(std::string &inLine)
     {
         int dataStartCharIndex = 4 + addressLength * 2;
         int dataLength = newRecord.m_count - addressLength - 1; // total rem - addr - cksum (in bytes)
-        uint8_t *data = new uint8_t[dataLength];
-        try
+        for (i = 0; i < dataLength; ++i)
         {
-            for (i = 0; i < dataLength; ++i)
-            {
-                int dataByte = readHexByte(inLine, dataStartCharIndex + i * 2);
-                data[i] = dataByte;
-                checksum += dataByte;
-            }
-        }
-        catch (...)
-        {
-            delete[] data;
-            throw;
+            int dataByte = readHexByte(inLine, dataStartCharIndex + i * 2);
+            outData[i] = dataByte;
+            checksum += dataByte;
         }
-        newRecord.m_data = data;
+        newRecord.m_data = outData;
         newRecord.m_dataCount = dataLength;
     }
 
     // read and compare checksum byte
     checksum = (~checksum) & 0xff; // low byte of one's complement of sum of other bytes
-    newRecord.m_checksum = readHexByte(inLine, (int)inLine.length() - 2);
+    newRecord.m_checksum = readHexByte(inLine, (int)inLength - 2);
     if (checksum != newRecord.m_checksum)
     {
         throw StSRecordParseException("invalid checksum");
     }
-
-    // now save the new S-record
-    m_records.push_back(newRecord);
 }
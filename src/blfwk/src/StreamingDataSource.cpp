@@ -0,0 +1,219 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/StreamingDataSource.h"
+#include "blfwk/Realtime.h"
+#include "blfwk/format_string.h"
+#include <algorithm>
+#include <string.h>
+
+using namespace blfwk;
+
+//! Returns 0 once the parser has failed, which ends the data phase of a write early.
+unsigned StreamingDataSource::ChunkSegment::getData(unsigned offset, unsigned maxBytes, uint8_t *buffer)
+{
+    if ((offset >= m_data.size()) || m_streamingSource.hasFailed())
+    {
+        return 0;
+    }
+
+    unsigned copyBytes = std::min<unsigned>(static_cast<unsigned>(m_data.size()) - offset, maxBytes);
+    memcpy(buffer, &m_data[offset], copyBytes);
+    return copyBytes;
+}
+
+StreamingDataSource::StreamingDataSource(unsigned chunkSize, unsigned queueDepth)
+    : DataSource()
+    , m_chunkSize(chunkSize)
+    , m_queueDepth(queueDepth)
+    , m_chunk(NULL)
+    , m_isFinished(false)
+    , m_isCancelled(false)
+{
+}
+
+//! Any chunks not taken by the consumer are discarded. If the parser thread is
+//! waiting for room in the queue it is woken up and stopped.
+StreamingDataSource::~StreamingDataSource()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isCancelled = true;
+    }
+    m_condition.notify_all();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    delete m_chunk;
+    std::deque<ChunkSegment *>::iterator it = m_queue.begin();
+    for (; it != m_queue.end(); ++it)
+    {
+        delete *it;
+    }
+}
+
+//! The data source must not be destroyed before the consumer has stopped calling
+//! getNextSegment().
+void StreamingDataSource::start(parser_t parser)
+{
+    m_thread = std::thread(&StreamingDataSource::runParser, this, parser);
+}
+
+void StreamingDataSource::runParser(parser_t parser)
+{
+    Realtime::leave();
+
+    std::exception_ptr error;
+
+    try
+    {
+        parser(*this);
+
+        // Queue the last, partially filled chunk.
+        if (m_chunk)
+        {
+            flushChunk();
+        }
+    }
+    catch (Cancelled &)
+    {
+        // The consumer does not want any more data.
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = error;
+        m_isFinished = true;
+    }
+    m_condition.notify_all();
+}
+
+//! This method must only be called from the parser function. The data is copied,
+//! so \a data may be reused as soon as this method returns. Data that does not
+//! follow on directly from the previous call starts a new chunk.
+//!
+//! The call blocks while the queue is full.
+//!
+//! \exception OverlapException Thrown if the data overlaps data added before.
+void StreamingDataSource::addData(uint32_t address, const uint8_t *data, unsigned length)
+{
+    addRange(address, length);
+
+    while (length)
+    {
+        if (m_chunk && ((m_chunk->getEndAddress() != address) || (m_chunk->m_data.size() >= m_chunkSize)))
+        {
+            flushChunk();
+        }
+
+        if (!m_chunk)
+        {
+            m_chunk = new ChunkSegment(*this, address);
+            m_chunk->m_data.reserve(m_chunkSize);
+        }
+
+        unsigned copyBytes = std::min<unsigned>(length, m_chunkSize - static_cast<unsigned>(m_chunk->m_data.size()));
+        m_chunk->m_data.insert(m_chunk->m_data.end(), data, data + copyBytes);
+
+        address += copyBytes;
+        data += copyBytes;
+        length -= copyBytes;
+    }
+}
+
+//! Adjacent ranges are merged, so a file of contiguous records keeps a single entry.
+void StreamingDataSource::addRange(uint32_t address, unsigned length)
+{
+    uint64_t end = (uint64_t)address + length;
+    std::map<uint32_t, uint64_t>::iterator next = m_ranges.upper_bound(address);
+    if ((next != m_ranges.end()) && (next->first < end))
+    {
+        throw OverlapException(format_string("data at 0x%08x overlaps data earlier in the file", address));
+    }
+
+    if (next != m_ranges.begin())
+    {
+        std::map<uint32_t, uint64_t>::iterator previous = next;
+        --previous;
+        if (previous->second > address)
+        {
+            throw OverlapException(format_string("data at 0x%08x overlaps data earlier in the file", address));
+        }
+        if (previous->second == address)
+        {
+            previous->second = end;
+            return;
+        }
+    }
+
+    m_ranges[address] = end;
+}
+
+void StreamingDataSource::flushChunk()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_isCancelled || m_queue.size() < m_queueDepth; });
+    if (m_isCancelled)
+    {
+        throw Cancelled();
+    }
+
+    m_queue.push_back(m_chunk);
+    m_chunk = NULL;
+    lock.unlock();
+    m_condition.notify_all();
+}
+
+//! The caller takes ownership of the returned segment and must delete it when done.
+//!
+//! \retval NULL All data has been returned.
+//! \exception Any exception thrown by the parser function is rethrown here, after all
+//!     chunks produced before the error have been returned.
+StreamingDataSource::ChunkSegment *StreamingDataSource::getNextSegment()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_isFinished || !m_queue.empty(); });
+
+    if (!m_queue.empty())
+    {
+        ChunkSegment *segment = m_queue.front();
+        m_queue.pop_front();
+        lock.unlock();
+        m_condition.notify_all();
+        return segment;
+    }
+
+    if (m_error)
+    {
+        std::rethrow_exception(m_error);
+    }
+
+    return NULL;
+}
+
+bool StreamingDataSource::hasFailed()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error != NULL;
+}
+
+//! \exception Any exception thrown by the parser function is rethrown here.
+void StreamingDataSource::drain()
+{
+    ChunkSegment *segment;
+    while ((segment = getNextSegment()) != NULL)
+    {
+        delete segment;
+    }
+}
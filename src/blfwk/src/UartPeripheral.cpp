@@ -8,6 +8,7 @@
  */
 
 #include "blfwk/Logging.h"
+#include "blfwk/SerialIoThread.h"
 #include "blfwk/UartPeripheral.h"
 #include "blfwk/format_string.h"
 #include "blfwk/serial.h"
@@ -19,10 +20,13 @@ using namespace blfwk;
 ////////////////////////////////////////////////////////////////////////////////
 
 // See uart_peripheral.h for documentation of this method.
-UartPeripheral::UartPeripheral(const char *port, long speed)
+UartPeripheral::UartPeripheral(const char *port, long speed, uint32_t options)
     : m_fileDescriptor(-1)
+    , m_speed(speed)
+    , m_options(options)
+    , m_ioThread(NULL)
 {
-    if (!init(port, speed))
+    if (!init(port, speed, options))
     {
         throw std::runtime_error(
             format_string("Error: UartPeripheral() cannot open PC UART port(%s), speed(%d Hz).", port, speed));
@@ -30,7 +34,7 @@ UartPeripheral::UartPeripheral(const char *port, long speed)
 }
 
 // See uart_peripheral.h for documentation of this method.
-bool UartPeripheral::init(const char *port, long speed)
+bool UartPeripheral::init(const char *port, long speed, uint32_t options)
 {
     assert(port);
 
@@ -48,7 +52,25 @@ bool UartPeripheral::init(const char *port, long speed)
         return false;
     }
 
-    serial_setup(m_fileDescriptor, speed);
+    if (serial_setup(m_fileDescriptor, speed) != 0)
+    {
+        serial_close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+        return false;
+    }
+
+    if ((options & kUartOption_FlowControl) && (serial_set_flow_control(m_fileDescriptor, 1) != 0))
+    {
+        Log::error("Error: %s does not support RTS/CTS hardware flow control.\n", port_name);
+        serial_close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+        return false;
+    }
+
+    if (options & kUartOption_LowLatency)
+    {
+        setLowLatency();
+    }
 
     // Flush garbage from receive buffer before setting read timeout.
     flushRX();
@@ -57,12 +79,69 @@ bool UartPeripheral::init(const char *port, long speed)
     // SerialPacketizer.cpp
     serial_set_read_timeout(m_fileDescriptor, kUartPeripheral_DefaultReadTimeoutMs);
 
+    if (options & kUartOption_IoThread)
+    {
+        try
+        {
+            m_ioThread = new SerialIoThread(m_fileDescriptor);
+        }
+        catch (const std::exception &e)
+        {
+            Log::warning("Warning: %s, accessing %s directly.\n", e.what(), port_name);
+        }
+    }
+
+    return true;
+}
+
+// See uart_peripheral.h for documentation of this method.
+bool UartPeripheral::setSpeed(long speed)
+{
+    // serial_setup() resets the whole port configuration, so the options are applied again.
+    if (serial_setup(m_fileDescriptor, speed) != 0)
+    {
+        return false;
+    }
+    if (m_options & kUartOption_FlowControl)
+    {
+        serial_set_flow_control(m_fileDescriptor, 1);
+    }
+    m_speed = speed;
+
+    // Flush garbage received at the old speed before setting read timeout.
+    flushRX();
+    serial_set_read_timeout(m_fileDescriptor, kUartPeripheral_DefaultReadTimeoutMs);
     return true;
 }
 
+// See uart_peripheral.h for documentation of this method.
+void UartPeripheral::setLowLatency()
+{
+    if (serial_set_low_latency(m_fileDescriptor) != 0)
+    {
+        Log::warning("Warning: the serial driver of %s does not support low latency mode.\n", port_name);
+    }
+    else
+    {
+        Log::debug("Enabled low latency mode of %s.\n", port_name);
+    }
+
+    int status = serial_set_latency_timer(port_name, kUartPeripheral_LowLatencyTimerMs);
+    if (status < 0)
+    {
+        Log::warning("Warning: cannot set the latency timer of %s, check the permissions of its sysfs entry.\n",
+                     port_name);
+    }
+    else if (status == 0)
+    {
+        Log::debug("Set latency timer of %s to %d ms.\n", port_name, kUartPeripheral_LowLatencyTimerMs);
+    }
+}
+
 // See host_peripheral.h for documentation of this method.
 UartPeripheral::~UartPeripheral()
 {
+    delete m_ioThread;
     if (m_fileDescriptor != -1)
     {
         serial_close(m_fileDescriptor);
@@ -77,12 +156,40 @@ UartPeripheral::~UartPeripheral()
 status_t UartPeripheral::read(uint8_t *buffer,
                               uint32_t requestedBytes,
                               uint32_t *actualBytes,
-                              uint32_t unused_timeoutMs)
+                              uint32_t timeoutMs)
 {
     assert(buffer);
 
     // Read the requested number of bytes.
-    int count = serial_read(m_fileDescriptor, reinterpret_cast<char *>(buffer), requestedBytes);
+    int count;
+    if (m_ioThread)
+    {
+        count = m_ioThread->read(buffer, requestedBytes,
+                                 (timeoutMs != kUartPeripheral_UnusedTimeout) ?
+                                     timeoutMs :
+                                     (uint32_t)kUartPeripheral_DefaultReadTimeoutMs);
+        if (m_ioThread->isFailed() && (count < (int)requestedBytes))
+        {
+            return kStatus_Fail;
+        }
+    }
+    else if (timeoutMs != kUartPeripheral_UnusedTimeout)
+    {
+        count = serial_read_timeout(m_fileDescriptor, reinterpret_cast<char *>(buffer), requestedBytes, timeoutMs);
+        if (count < 0)
+        {
+            Log::error("Error: serial port read failed\n");
+            if (actualBytes)
+            {
+                *actualBytes = 0;
+            }
+            return kStatus_Fail;
+        }
+    }
+    else
+    {
+        count = serial_read(m_fileDescriptor, reinterpret_cast<char *>(buffer), requestedBytes);
+    }
     if (actualBytes)
     {
         *actualBytes = count;
@@ -121,6 +228,12 @@ void UartPeripheral::flushRX()
 // to empty the RX buffer has worked
 
 // This read loop never exits on the Mac, and doesn't appear to be necessary.
+    if (m_ioThread)
+    {
+        m_ioThread->flushRX();
+        return;
+    }
+
 #if (defined(WIN32) || defined(LINUX))
     // Read up to the requested number of bytes.
     char *readBuf = reinterpret_cast<char *>(m_buffer);
@@ -151,6 +264,11 @@ status_t UartPeripheral::write(const uint8_t *buffer, uint32_t byteCount)
         Log::debug2("]\n");
     }
 
+    if (m_ioThread)
+    {
+        return m_ioThread->write(buffer, byteCount) ? kStatus_Success : kStatus_Fail;
+    }
+
     if (serial_write(m_fileDescriptor, reinterpret_cast<char *>(const_cast<uint8_t *>(buffer)), byteCount) == byteCount)
         return kStatus_Success;
     else
@@ -34,8 +34,8 @@ status_t Updater::flashFirmware(const char *filename, uint32_t base_address, uin
     m_sourceFile = SourceFile::openFile(filename);
 
     // Initialize the Operation structure.
-    m_operation.tasks.push_back(updater_task_t(kUpdaterTask_Erasing, m_sourceFile->getSize()));
-    m_operation.tasks.push_back(updater_task_t(kUpdaterTask_Flashing, m_sourceFile->getSize()));
+    m_operation.tasks.push_back(updater_task_t(kUpdaterTask_Erasing, (uint32_t)m_sourceFile->getSize()));
+    m_operation.tasks.push_back(updater_task_t(kUpdaterTask_Flashing, (uint32_t)m_sourceFile->getSize()));
     m_operation.current_task = 0;
 
     if (m_sourceFile->getFileType() == SourceFile::source_file_t::kSBSourceFile)
@@ -0,0 +1,677 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/UsbFsHidDevice.h"
+#include "blfwk/HidReportDescriptor.h"
+#include "blfwk/Logging.h"
+#include "blfwk/format_string.h"
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#if defined(LINUX)
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/usbdevice_fs.h>
+#endif // LINUX
+
+using namespace blfwk;
+
+#if defined(LINUX)
+//! Longest time the event thread waits for a completion, so that it notices when it is stopped, in milliseconds.
+static const int kEventPollMs = 50;
+
+//! Time given to cancelled transfers to complete when the device is closed, in milliseconds.
+static const int kCloseTimeoutMs = 1000;
+
+//! Timeout of the request for the report descriptor, in milliseconds.
+static const unsigned int kControlTimeoutMs = 1000;
+
+//! Descriptor types and the class code of HID interfaces. See the USB specification, revision 2.0,
+//! section 9.4, and the HID specification, version 1.11, section 7.1.
+enum _usb_descriptors
+{
+    kDescriptorType_Configuration = 0x02,
+    kDescriptorType_Interface = 0x04,
+    kDescriptorType_Endpoint = 0x05,
+    kDescriptorType_Hid = 0x21,
+    kDescriptorType_Report = 0x22,
+    kInterfaceClass_Hid = 0x03,
+    kEndpointType_Interrupt = 0x03,
+    kRequest_GetDescriptor = 0x06,
+    kRequestType_StandardInterfaceIn = 0x81
+};
+
+//! sysfs directory of the USB devices.
+static const char *kSysfsUsbDevices = "/sys/bus/usb/devices";
+
+//! \brief Reads the first line of attribute \a name of sysfs directory \a dir.
+static bool readAttribute(const std::string &dir, const char *name, std::string &value)
+{
+    FILE *file = fopen((dir + "/" + name).c_str(), "r");
+    if (!file)
+    {
+        return false;
+    }
+    char line[256];
+    bool isRead = (fgets(line, sizeof(line), file) != NULL);
+    fclose(file);
+    if (isRead)
+    {
+        value = line;
+        value.erase(value.find_last_not_of("\r\n") + 1);
+    }
+    return isRead;
+}
+
+//! \brief Reads attribute \a name of sysfs directory \a dir as a number in \a base.
+static bool readNumber(const std::string &dir, const char *name, int base, uint32_t &value)
+{
+    std::string text;
+    if (!readAttribute(dir, name, text) || text.empty())
+    {
+        return false;
+    }
+    char *end = NULL;
+    value = (uint32_t)strtoul(text.c_str(), &end, base);
+    return *end == 0;
+}
+#endif // LINUX
+
+//! \brief An asynchronous transfer and its buffer.
+struct UsbFsHidDevice::transfer_t
+{
+    std::vector<uint8_t> buffer; //!< Data of the transfer.
+    size_t length;               //!< Number of bytes to send, for an output transfer.
+    bool isIn;                   //!< Whether it is an input transfer.
+    bool isPending;              //!< Whether it was submitted and has not been reaped yet.
+#if defined(LINUX)
+    struct usbdevfs_urb urb; //!< Request block. Last, as it ends in a flexible array.
+#endif                       // LINUX
+};
+
+UsbFsHidDevice::UsbFsHidDevice(uint32_t queueDepth)
+    : m_queueDepth(queueDepth)
+    , m_fd(-1)
+    , m_sysfsPath()
+    , m_interface(-1)
+    , m_isClaimed(false)
+    , m_inEndpoint(0)
+    , m_outEndpoint(0)
+    , m_inPacketSize(0)
+    , m_reportDescriptorLength(0)
+    , m_reportDescriptor()
+    , m_transfers()
+    , m_freeOut()
+    , m_completedIn()
+    , m_writeError(0)
+    , m_isFailed(false)
+    , m_isStopped(false)
+{
+}
+
+UsbFsHidDevice::~UsbFsHidDevice()
+{
+    close();
+}
+
+#if defined(LINUX)
+bool UsbFsHidDevice::open(uint16_t vid, uint16_t pid, const std::wstring &serialNumber, const std::string &path)
+{
+    close();
+    if (!findDevice(vid, pid, serialNumber, path))
+    {
+        return false;
+    }
+
+    uint32_t bus = 0;
+    uint32_t device = 0;
+    readNumber(m_sysfsPath, "busnum", 10, bus);
+    readNumber(m_sysfsPath, "devnum", 10, device);
+    std::string node = format_string("/dev/bus/usb/%03u/%03u", bus, device);
+    m_fd = ::open(node.c_str(), O_RDWR | O_CLOEXEC);
+    if (m_fd < 0)
+    {
+        Log::error("Error: usbfs: cannot open %s: %s\n", node.c_str(), strerror(errno));
+        return false;
+    }
+    if (!readEndpoints())
+    {
+        close();
+        return false;
+    }
+
+    // Take the interface from the kernel driver. Having no driver bound is fine.
+    struct usbdevfs_ioctl command;
+    command.ifno = m_interface;
+    command.ioctl_code = USBDEVFS_DISCONNECT;
+    command.data = NULL;
+    ioctl(m_fd, USBDEVFS_IOCTL, &command);
+    unsigned int interface = (unsigned int)m_interface;
+    if (ioctl(m_fd, USBDEVFS_CLAIMINTERFACE, &interface) != 0)
+    {
+        Log::error("Error: usbfs: cannot claim interface %d of %s: %s\n", m_interface, node.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+    m_isClaimed = true;
+
+    HidReportDescriptor descriptor;
+    if (!readReportDescriptor() || !descriptor.parse(m_reportDescriptor.data(), m_reportDescriptor.size()) ||
+        !descriptor.getMaxOutputReportSize())
+    {
+        Log::error("Error: usbfs: cannot read the output report sizes of %s\n", node.c_str());
+        close();
+        return false;
+    }
+
+    // An input report may span several packets, and is received whole by a transfer of its size.
+    size_t inSize = std::max((size_t)m_inPacketSize, (size_t)descriptor.getMaxInputReportSize());
+    for (size_t i = 0; i < kInTransferCount + m_queueDepth; ++i)
+    {
+        transfer_t *transfer = new transfer_t;
+        transfer->isIn = (i < kInTransferCount);
+        transfer->buffer.resize(transfer->isIn ? inSize : descriptor.getMaxOutputReportSize());
+        transfer->length = 0;
+        transfer->isPending = false;
+        m_transfers.push_back(transfer);
+        if (!transfer->isIn)
+        {
+            m_freeOut.push_back(transfer);
+        }
+    }
+
+    m_isFailed = false;
+    m_isStopped = false;
+    m_writeError = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < kInTransferCount; ++i)
+        {
+            if (!submit(m_transfers[i]))
+            {
+                Log::error("Error: usbfs: cannot submit an input transfer to %s: %s\n", node.c_str(), strerror(errno));
+                break;
+            }
+        }
+    }
+    if (m_isFailed || !m_transfers[kInTransferCount - 1]->isPending)
+    {
+        close();
+        return false;
+    }
+    m_thread = std::thread(&UsbFsHidDevice::run, this);
+
+    Log::debug("usbfs: opened %s interface %d with %u output reports in flight\n", node.c_str(), m_interface,
+               m_queueDepth);
+    return true;
+}
+
+void UsbFsHidDevice::close()
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+    if (m_thread.joinable())
+    {
+        m_isStopped = true;
+        m_thread.join();
+    }
+
+    // Cancel the transfers in flight and reap them, so that their buffers can be freed.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        discard(false);
+    }
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(kCloseTimeoutMs);
+    while (reap() && (std::chrono::steady_clock::now() < deadline))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (std::none_of(m_transfers.begin(), m_transfers.end(), [](transfer_t *t) { return t->isPending; }))
+        {
+            break;
+        }
+        struct pollfd fd;
+        fd.fd = m_fd;
+        fd.events = POLLOUT;
+        fd.revents = 0;
+        poll(&fd, 1, kEventPollMs);
+    }
+
+    // Give the interface back to the kernel driver.
+    if (m_isClaimed)
+    {
+        unsigned int interface = (unsigned int)m_interface;
+        ioctl(m_fd, USBDEVFS_RELEASEINTERFACE, &interface);
+        struct usbdevfs_ioctl command;
+        command.ifno = m_interface;
+        command.ioctl_code = USBDEVFS_CONNECT;
+        command.data = NULL;
+        ioctl(m_fd, USBDEVFS_IOCTL, &command);
+        m_isClaimed = false;
+    }
+
+    // Closing the node kills what is still in flight, before the buffers are freed.
+    ::close(m_fd);
+    m_fd = -1;
+    for (size_t i = 0; i < m_transfers.size(); ++i)
+    {
+        delete m_transfers[i];
+    }
+    m_transfers.clear();
+    m_freeOut.clear();
+    m_completedIn.clear();
+    m_interface = -1;
+}
+
+int UsbFsHidDevice::write(const uint8_t *report, size_t length, uint32_t timeoutMs)
+{
+    if (m_fd < 0)
+    {
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (m_freeOut.empty() && !m_isFailed && !m_writeError)
+    {
+        if ((m_condition.wait_until(lock, deadline) == std::cv_status::timeout) && m_freeOut.empty())
+        {
+            Log::error("Error: usbfs: the device did not accept output reports within %u ms\n", timeoutMs);
+            discard(true);
+            return -1;
+        }
+    }
+    if (m_isFailed)
+    {
+        return -1;
+    }
+    if (m_writeError)
+    {
+        // Reported when the transfer completed.
+        m_writeError = 0;
+        return -1;
+    }
+
+    transfer_t *transfer = m_freeOut.back();
+    if (length > transfer->buffer.size())
+    {
+        Log::error("Error: usbfs: output report of %u bytes is bigger than the %u bytes the device declares\n",
+                   (uint32_t)length, (uint32_t)transfer->buffer.size());
+        return -1;
+    }
+    m_freeOut.pop_back();
+    memcpy(transfer->buffer.data(), report, length);
+    transfer->length = length;
+    if (!submit(transfer))
+    {
+        Log::error("Error: usbfs: cannot submit an output report: %s\n", strerror(errno));
+        m_freeOut.push_back(transfer);
+        return -1;
+    }
+    return (int)length;
+}
+
+int UsbFsHidDevice::read(uint8_t *buffer, size_t length, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::function<bool()> isReady = [this] { return !m_completedIn.empty() || m_isFailed; };
+    if (timeoutMs < 0)
+    {
+        m_condition.wait(lock, isReady);
+    }
+    else
+    {
+        m_condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), isReady);
+    }
+    if (m_completedIn.empty())
+    {
+        return m_isFailed ? -1 : 0;
+    }
+
+    transfer_t *transfer = m_completedIn.front();
+    m_completedIn.pop_front();
+    size_t count = std::min((size_t)transfer->urb.actual_length, length);
+    memcpy(buffer, transfer->buffer.data(), count);
+    if (!submit(transfer))
+    {
+        Log::error("Error: usbfs: cannot submit an input transfer: %s\n", strerror(errno));
+        m_isFailed = true;
+    }
+    return (int)count;
+}
+
+void UsbFsHidDevice::discardWrites()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    discard(true);
+}
+
+bool UsbFsHidDevice::findDevice(uint16_t vid, uint16_t pid, const std::wstring &serialNumber, const std::string &path)
+{
+    char resolved[PATH_MAX];
+    if (!path.empty() && (path.compare(0, strlen("/dev/bus/usb/"), "/dev/bus/usb/") != 0))
+    {
+        // A hidraw node: its device is the HID device, whose parents are the interface and the USB device.
+        std::string name = realpath(path.c_str(), resolved) ? resolved : path;
+        name = name.substr(name.rfind('/') + 1);
+        if (!realpath(("/sys/class/hidraw/" + name + "/device").c_str(), resolved))
+        {
+            Log::error("Error: usbfs: %s is neither a usbfs node nor a hidraw node\n", path.c_str());
+            return false;
+        }
+        std::string interfacePath = resolved;
+        interfacePath.erase(interfacePath.rfind('/'));
+        uint32_t interface = 0;
+        if (!readNumber(interfacePath, "bInterfaceNumber", 16, interface))
+        {
+            Log::error("Error: usbfs: %s is not a USB device\n", path.c_str());
+            return false;
+        }
+        m_interface = (int)interface;
+        m_sysfsPath = interfacePath.substr(0, interfacePath.rfind('/'));
+        return true;
+    }
+
+    uint32_t bus = 0;
+    uint32_t device = 0;
+    bool isNode = !path.empty();
+    if (isNode && (sscanf(path.c_str(), "/dev/bus/usb/%u/%u", &bus, &device) != 2))
+    {
+        Log::error("Error: usbfs: %s is not a usbfs node\n", path.c_str());
+        return false;
+    }
+
+    DIR *devices = opendir(kSysfsUsbDevices);
+    if (!devices)
+    {
+        Log::error("Error: usbfs: cannot list %s: %s\n", kSysfsUsbDevices, strerror(errno));
+        return false;
+    }
+    bool isFound = false;
+    struct dirent *entry;
+    while (!isFound && ((entry = readdir(devices)) != NULL))
+    {
+        // Interfaces have a colon in their name.
+        if ((entry->d_name[0] == '.') || strchr(entry->d_name, ':'))
+        {
+            continue;
+        }
+        std::string dir = std::string(kSysfsUsbDevices) + "/" + entry->d_name;
+        if (isNode)
+        {
+            uint32_t entryBus = 0;
+            uint32_t entryDevice = 0;
+            isFound = readNumber(dir, "busnum", 10, entryBus) && readNumber(dir, "devnum", 10, entryDevice) &&
+                      (entryBus == bus) && (entryDevice == device);
+        }
+        else
+        {
+            uint32_t entryVid = 0;
+            uint32_t entryPid = 0;
+            std::string serial;
+            isFound = readNumber(dir, "idVendor", 16, entryVid) && readNumber(dir, "idProduct", 16, entryPid) &&
+                      (entryVid == vid) && (entryPid == pid) &&
+                      (serialNumber.empty() || (readAttribute(dir, "serial", serial) &&
+                                                (std::wstring(serial.begin(), serial.end()) == serialNumber)));
+        }
+        if (isFound)
+        {
+            m_sysfsPath = realpath(dir.c_str(), resolved) ? resolved : dir;
+        }
+    }
+    closedir(devices);
+
+    if (!isFound)
+    {
+        if (isNode)
+        {
+            Log::error("Error: usbfs: no USB device is at %s\n", path.c_str());
+        }
+        else
+        {
+            Log::error("Error: usbfs: no USB device with vid=0x%04x, pid=0x%04x\n", vid, pid);
+        }
+    }
+    return isFound;
+}
+
+bool UsbFsHidDevice::readEndpoints()
+{
+    // The node reads as the device descriptor followed by all configuration descriptors.
+    std::vector<uint8_t> descriptors;
+    uint8_t chunk[1024];
+    ssize_t count;
+    while ((count = ::read(m_fd, chunk, sizeof(chunk))) > 0)
+    {
+        descriptors.insert(descriptors.end(), chunk, chunk + count);
+    }
+    uint32_t activeConfiguration = 0;
+    readNumber(m_sysfsPath, "bConfigurationValue", 10, activeConfiguration);
+
+    uint32_t configuration = 0;
+    bool isHidInterface = false;
+    int interface = -1;
+    for (size_t i = 0; (i + 2 <= descriptors.size()) && (descriptors[i] >= 2); i += descriptors[i])
+    {
+        const uint8_t *descriptor = &descriptors[i];
+        uint8_t length = descriptor[0];
+        if (i + length > descriptors.size())
+        {
+            break;
+        }
+        switch (descriptor[1])
+        {
+            case kDescriptorType_Configuration:
+                configuration = (length >= 6) ? descriptor[5] : 0;
+                isHidInterface = false;
+                break;
+            case kDescriptorType_Interface:
+                // Alternate settings of the interface found are skipped, as are the interfaces after it.
+                isHidInterface = (length >= 9) && (configuration == activeConfiguration) && (interface < 0) &&
+                                 (descriptor[3] == 0) && (descriptor[5] == kInterfaceClass_Hid) &&
+                                 ((m_interface < 0) || (descriptor[2] == m_interface));
+                if (isHidInterface)
+                {
+                    interface = descriptor[2];
+                }
+                break;
+            case kDescriptorType_Hid:
+                if (isHidInterface && (length >= 9) && (descriptor[6] == kDescriptorType_Report))
+                {
+                    m_reportDescriptorLength = descriptor[7] | (descriptor[8] << 8);
+                }
+                break;
+            case kDescriptorType_Endpoint:
+                if (isHidInterface && (length >= 7) && ((descriptor[3] & 0x3) == kEndpointType_Interrupt))
+                {
+                    if (descriptor[2] & 0x80)
+                    {
+                        m_inEndpoint = descriptor[2];
+                        m_inPacketSize = (descriptor[4] | (descriptor[5] << 8)) & 0x7ff;
+                    }
+                    else
+                    {
+                        m_outEndpoint = descriptor[2];
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (interface < 0)
+    {
+        Log::error("Error: usbfs: the device has no HID interface\n");
+        return false;
+    }
+    m_interface = interface;
+    if (!m_inEndpoint || !m_outEndpoint || !m_reportDescriptorLength)
+    {
+        // Without an interrupt OUT endpoint output reports go over the control pipe, one at a time.
+        Log::error("Error: usbfs: HID interface %d has no interrupt IN and OUT endpoints, use hidapi\n", interface);
+        return false;
+    }
+    return true;
+}
+
+bool UsbFsHidDevice::readReportDescriptor()
+{
+    m_reportDescriptor.resize(m_reportDescriptorLength);
+    struct usbdevfs_ctrltransfer request;
+    request.bRequestType = kRequestType_StandardInterfaceIn;
+    request.bRequest = kRequest_GetDescriptor;
+    request.wValue = kDescriptorType_Report << 8;
+    request.wIndex = (uint16_t)m_interface;
+    request.wLength = (uint16_t)m_reportDescriptorLength;
+    request.timeout = kControlTimeoutMs;
+    request.data = m_reportDescriptor.data();
+    int count = ioctl(m_fd, USBDEVFS_CONTROL, &request);
+    if (count < 0)
+    {
+        Log::debug("usbfs: cannot read the report descriptor: %s\n", strerror(errno));
+        m_reportDescriptor.clear();
+        return false;
+    }
+    m_reportDescriptor.resize(count);
+    return true;
+}
+
+bool UsbFsHidDevice::submit(transfer_t *transfer)
+{
+    memset(&transfer->urb, 0, sizeof(transfer->urb));
+    transfer->urb.type = USBDEVFS_URB_TYPE_INTERRUPT;
+    transfer->urb.endpoint = transfer->isIn ? m_inEndpoint : m_outEndpoint;
+    transfer->urb.buffer = transfer->buffer.data();
+    transfer->urb.buffer_length = (int)(transfer->isIn ? transfer->buffer.size() : transfer->length);
+    transfer->urb.usercontext = transfer;
+    if (ioctl(m_fd, USBDEVFS_SUBMITURB, &transfer->urb) != 0)
+    {
+        if (errno == ENODEV)
+        {
+            m_isFailed = true;
+        }
+        return false;
+    }
+    transfer->isPending = true;
+    return true;
+}
+
+void UsbFsHidDevice::discard(bool isOutOnly)
+{
+    for (size_t i = 0; i < m_transfers.size(); ++i)
+    {
+        transfer_t *transfer = m_transfers[i];
+        if (transfer->isPending && (!isOutOnly || !transfer->isIn))
+        {
+            // Fails harmlessly if the transfer has completed meanwhile.
+            ioctl(m_fd, USBDEVFS_DISCARDURB, &transfer->urb);
+        }
+    }
+}
+
+void UsbFsHidDevice::run()
+{
+    while (!m_isStopped)
+    {
+        // The node polls writable when a transfer has completed.
+        struct pollfd fd;
+        fd.fd = m_fd;
+        fd.events = POLLOUT;
+        fd.revents = 0;
+        poll(&fd, 1, kEventPollMs);
+        if (!reap() || (fd.revents & (POLLERR | POLLHUP)))
+        {
+            Log::debug("usbfs: the device has gone\n");
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isFailed = true;
+            m_condition.notify_all();
+            break;
+        }
+    }
+}
+
+bool UsbFsHidDevice::reap()
+{
+    for (;;)
+    {
+        struct usbdevfs_urb *urb = NULL;
+        if (ioctl(m_fd, USBDEVFS_REAPURBNDELAY, &urb) != 0)
+        {
+            return errno != ENODEV;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        transfer_t *transfer = (transfer_t *)urb->usercontext;
+        transfer->isPending = false;
+        bool isCancelled = (urb->status == -ENOENT) || (urb->status == -ECONNRESET);
+        if (transfer->isIn)
+        {
+            if (urb->status == 0)
+            {
+                m_completedIn.push_back(transfer);
+            }
+            else if ((urb->status == -ENODEV) || (urb->status == -ESHUTDOWN))
+            {
+                m_isFailed = true;
+            }
+            else if (!isCancelled)
+            {
+                // Errors of the bus are retried, as hidraw does.
+                Log::debug("usbfs: input transfer failed: %s\n", strerror(-urb->status));
+                submit(transfer);
+            }
+        }
+        else
+        {
+            if ((urb->status != 0) && !isCancelled)
+            {
+                Log::error("Error: usbfs: output report failed: %s\n", strerror(-urb->status));
+                m_writeError = urb->status;
+            }
+            m_freeOut.push_back(transfer);
+        }
+        m_condition.notify_all();
+    }
+}
+#else
+bool UsbFsHidDevice::open(uint16_t vid, uint16_t pid, const std::wstring &serialNumber, const std::string &path)
+{
+    Log::error("Error: usbfs is only available on Linux\n");
+    return false;
+}
+
+void UsbFsHidDevice::close()
+{
+}
+
+int UsbFsHidDevice::write(const uint8_t *report, size_t length, uint32_t timeoutMs)
+{
+    return -1;
+}
+
+int UsbFsHidDevice::read(uint8_t *buffer, size_t length, int timeoutMs)
+{
+    return -1;
+}
+
+void UsbFsHidDevice::discardWrites()
+{
+}
+#endif // LINUX
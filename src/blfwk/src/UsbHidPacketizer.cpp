@@ -8,11 +8,13 @@
 
 #include "blfwk/UsbHidPacketizer.h"
 #include "blfwk/Logging.h"
+#include "blfwk/Realtime.h"
 #include "blfwk/smart_ptr.h"
 #include "blfwk/utils.h"
 #ifdef LINUX
 #include <string.h>
 #endif
+#include <algorithm>
 
 using namespace blfwk;
 
@@ -23,10 +25,24 @@ using namespace blfwk;
 // See usb_hid_packetizer.h for documentation of this method.
 UsbHidPacketizer::UsbHidPacketizer(UsbHidPeripheral *peripheral, uint32_t packetTimeoutMs)
     : Packetizer(peripheral, packetTimeoutMs)
+    , m_isCommandWritten(false)
+    , m_maxPacketSize(kMaxHostPacketSize)
 {
-    m_continuousReadCount = 0;
     memset(&m_report, 0, sizeof(m_report));
     memset(&m_abortReport, 0, sizeof(m_abortReport));
+
+    // A data packet must fit in a data report of either direction. Without a descriptor,
+    // leave the packet size to the target.
+    const HidReportDescriptor &descriptor = peripheral->getReportDescriptor();
+    uint32_t reportSizes[] = { descriptor.getOutputReportSize(kBootloaderReportID_DataOut),
+                               descriptor.getInputReportSize(kBootloaderReportID_DataIn) };
+    for (uint32_t reportSize : reportSizes)
+    {
+        if (reportSize > sizeof(bl_hid_header_t))
+        {
+            m_maxPacketSize = std::min(m_maxPacketSize, (uint32_t)(reportSize - sizeof(bl_hid_header_t)));
+        }
+    }
 }
 
 // See usb_hid_packetizer.h for documentation of this method.
@@ -64,6 +80,8 @@ status_t UsbHidPacketizer::writePacket(const uint8_t *packet, uint32_t byteCount
         // Check if the target has sent an abort report.
         if (pollForAbortPacket())
         {
+            // Reports still in flight belong to the aborted data phase.
+            getPeripheral()->discardWrites();
             Log::info("usb hid detected receiver data abort\n");
             return kStatus_AbortDataPhase;
         }
@@ -81,9 +99,11 @@ status_t UsbHidPacketizer::writePacket(const uint8_t *packet, uint32_t byteCount
         memcpy(m_report.packet, packet, byteCount);
     }
 
-    m_continuousReadCount = 0;
-
-    return getPeripheral()->write((uint8_t *)&m_report, sizeof(bl_hid_header_t) + byteCount, m_packetTimeoutMs);
+    status_t status =
+        getPeripheral()->write((uint8_t *)&m_report, sizeof(bl_hid_header_t) + byteCount, m_packetTimeoutMs);
+    m_isCommandWritten = (status == kStatus_Success) && (packetType == kPacketType_Command);
+    m_commandWriteTime = std::chrono::steady_clock::now();
+    return status;
 }
 
 // See usb_hid_packetizer.h for documentation of this method.
@@ -110,53 +130,48 @@ status_t UsbHidPacketizer::readPacket(uint8_t **packet, uint32_t *packetLength,
             return kStatus_Fail;
     };
 
-    // Read report.
+    // Read report. Reports are read by ID, so data reports left over from an aborted data
+    // phase are discarded rather than taken for the response of the command.
     uint32_t actualBytes = 0;
     uint16_t lengthInPacket = 0;
     uint32_t retryCnt = 0;
+    Deadline deadline = getPacketDeadline();
     do
     {
-        status_t retVal =
-            m_peripheral->read((unsigned char *)&m_report, sizeof(m_report), &actualBytes, m_packetTimeoutMs);
-        if (retVal != kStatus_Success)
+        // Retries share the time left for the packet.
+        uint32_t timeoutMs = deadline.getRemainingMs();
+        if (timeoutMs == 0)
         {
-            return retVal;
-        }
-
-        if (!retryCnt)
-        {
-            m_continuousReadCount++;
+            return kStatus_Timeout;
         }
-
-        // Check the report ID.
-        if (m_report.header.reportID != reportID)
+        status_t retVal = getPeripheral()->readReport(reportID, (packetType == kPacketType_Command),
+                                                      (uint8_t *)&m_report, sizeof(m_report), &actualBytes, timeoutMs);
+        if (retVal != kStatus_Success)
         {
-            Log::error("usbhid: received unexpected report=%x\n", m_report.header.reportID);
-            return kStatus_Fail;
+            return retVal;
         }
 
         // Extract the packet length encoded as bytes 1 and 2 of the report. The packet length
         // is transferred in little endian byte order.
         lengthInPacket = m_report.header.packetLengthLsb | (m_report.header.packetLengthMsb << 8);
 
-        // See if we received the data abort packet,
-        // if the data abort packet was received, try to read pending generic response packet.
+        // See if we received the data abort packet.
         if (lengthInPacket == 0)
         {
             Log::info("usbhid: received data phase abort\n");
 
-            // If continuous read occurs, that means this is a read-memory command,
-            // host tool shouldn't wait for pending packet because there are no pending packets.
-            if (m_continuousReadCount >= kContinuousReadMargin)
+            // The abort of a data phase sent by the target is returned to the caller. When
+            // reading a command response, the response follows the abort, so keep reading.
+            if (packetType == kPacketType_Data)
             {
                 break;
             }
             retryCnt++;
         }
-        else if (lengthInPacket > getMaxPacketSize())
+        else if (lengthInPacket > sizeof(m_report.packet))
         {
             Log::error("Data packet size(%d) is bigger than max supported size(%d).", lengthInPacket,
-                       getMaxPacketSize());
+                       sizeof(m_report.packet));
             return kStatus_Fail;
         }
     } while (actualBytes && !lengthInPacket && retryCnt < kPollPacketMaxRetryCnt);
@@ -170,6 +185,15 @@ status_t UsbHidPacketizer::readPacket(uint8_t **packet, uint32_t *packetLength,
         return kStatus_Fail;
     }
 
+    // The response to a command is its round trip.
+    if (m_isCommandWritten && (packetType == kPacketType_Command))
+    {
+        m_latencyStats.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                                 m_commandWriteTime)
+                               .count());
+    }
+    m_isCommandWritten = false;
+
     // Return results.
     *packet = m_report.packet;
     *packetLength = lengthInPacket;
@@ -177,6 +201,13 @@ status_t UsbHidPacketizer::readPacket(uint8_t **packet, uint32_t *packetLength,
     return kStatus_Success;
 }
 
+// See usb_hid_packetizer.h for documentation of this method.
+void UsbHidPacketizer::prefaultBuffers()
+{
+    Realtime::prefault(&m_report, sizeof(m_report));
+    Realtime::prefault(&m_abortReport, sizeof(m_abortReport));
+}
+
 // See usb_hid_packetizer.h for documentation of this method.
 void UsbHidPacketizer::flushInput()
 {
@@ -197,26 +228,24 @@ void UsbHidPacketizer::abortPacket()
 
 bool UsbHidPacketizer::pollForAbortPacket()
 {
-    // Just check to see if there is data to be read from hid device.
-    // No reason to wait (milliseconds = 0), because we aren't really expecting anything.
-    uint32_t actualBytes = 0;
-    m_peripheral->read((unsigned char *)&m_abortReport, sizeof(m_abortReport), &actualBytes, kPollAbortTimeoutMs);
-    if (actualBytes == 0)
+    // The target sends nothing during a data phase from the host unless it aborts it. The reader
+    // thread flags every report as it arrives, so checking costs no wait and no system call.
+    if (!getPeripheral()->isReportPending())
     {
         // No abort packet
         return false;
     }
-    else
-    {
-        // Got an abort packet
-        return true;
-    }
+
+    // Got an abort packet
+    uint32_t actualBytes = 0;
+    m_peripheral->read((unsigned char *)&m_abortReport, sizeof(m_abortReport), &actualBytes, 0);
+    return true;
 }
 
 // See usb_hid_packetizer.h for documentation of this method.
 uint32_t UsbHidPacketizer::getMaxPacketSize()
 {
-    return kMaxHostPacketSize;
+    return m_maxPacketSize;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -8,6 +8,8 @@
  */
 
 #include "blfwk/UsbHidPeripheral.h"
+#include "blfwk/UsbFsHidDevice.h"
+#include "blfwk/UsbHidReaderThread.h"
 #include "blfwk/format_string.h"
 #include "blfwk/smart_ptr.h"
 #include "blfwk/Logging.h"
@@ -25,6 +27,10 @@ UsbHidPeripheral::UsbHidPeripheral()
     : m_vendor_id(kDefault_Vid)
     , m_product_id(kDefault_Pid)
     , m_path("")
+    , m_queueDepth(0)
+    , m_device(NULL)
+    , m_usbfs(NULL)
+    , m_reader(NULL)
 {
     if (!init())
     {
@@ -38,10 +44,15 @@ UsbHidPeripheral::UsbHidPeripheral()
 UsbHidPeripheral::UsbHidPeripheral(unsigned short vendor_id,
                                    unsigned short product_id,
                                    const char *serial_number,
-                                   const char *path)
+                                   const char *path,
+                                   uint32_t queueDepth)
     : m_vendor_id(vendor_id)
     , m_product_id(product_id)
     , m_path(path)
+    , m_queueDepth(queueDepth)
+    , m_device(NULL)
+    , m_usbfs(NULL)
+    , m_reader(NULL)
 {
     // Convert to a wchar_t*
     std::string s(serial_number);
@@ -66,6 +77,24 @@ UsbHidPeripheral::UsbHidPeripheral(unsigned short vendor_id,
 // See UsbHidPeripheral.h for documentation of this method.
 bool UsbHidPeripheral::init()
 {
+    if (m_queueDepth)
+    {
+        m_usbfs = new UsbFsHidDevice(m_queueDepth);
+        if (!m_usbfs->open(m_vendor_id, m_product_id, m_serial_number, m_path))
+        {
+            delete m_usbfs;
+            m_usbfs = NULL;
+            return false;
+        }
+        m_descriptor.parse(m_usbfs->getReportDescriptor().data(), m_usbfs->getReportDescriptor().size());
+        uint32_t reportSize = m_descriptor.getMaxInputReportSize();
+        UsbFsHidDevice *usbfs = m_usbfs;
+        m_reader = new UsbHidReaderThread(
+            [usbfs](uint8_t *report, size_t size, int timeoutMs) { return usbfs->read(report, size, timeoutMs); },
+            reportSize ? reportSize : sizeof(bl_hid_report_t));
+        return true;
+    }
+
     // Open the device using the VID, PID,
     // and optionally the Serial number.
     if (m_path.empty())
@@ -106,12 +135,54 @@ bool UsbHidPeripheral::init()
         return false;
     }
 
+    // Size the slots of the reader to the largest report the device sends.
+    readReportDescriptor();
+    uint32_t reportSize = m_descriptor.getMaxInputReportSize();
+    hid_device *device = m_device;
+    m_reader = new UsbHidReaderThread([device](uint8_t *report, size_t size, int timeoutMs)
+                                      { return hid_read_timeout(device, report, size, timeoutMs); },
+                                      reportSize ? reportSize : sizeof(bl_hid_report_t));
     return true;
 }
 
+// See UsbHidPeripheral.h for documentation of this method.
+void UsbHidPeripheral::readReportDescriptor()
+{
+#if defined(LINUX)
+    // hidapi does not hand out the descriptor, so read it from the hidraw node that hid_open() picks.
+    std::string path = m_path;
+    if (path.empty())
+    {
+        struct hid_device_info *devices = hid_enumerate(m_vendor_id, m_product_id);
+        for (struct hid_device_info *device = devices; device; device = device->next)
+        {
+            if (m_serial_number.empty() ||
+                (device->serial_number && (m_serial_number == device->serial_number)))
+            {
+                path = device->path ? device->path : "";
+                break;
+            }
+        }
+        hid_free_enumeration(devices);
+    }
+
+    if (m_descriptor.read(path))
+    {
+        Log::debug("usbhid: report sizes command out=%u data out=%u command in=%u data in=%u\n",
+                   m_descriptor.getOutputReportSize(kBootloaderReportID_CommandOut),
+                   m_descriptor.getOutputReportSize(kBootloaderReportID_DataOut),
+                   m_descriptor.getInputReportSize(kBootloaderReportID_CommandIn),
+                   m_descriptor.getInputReportSize(kBootloaderReportID_DataIn));
+    }
+#endif // LINUX
+}
+
 // See UsbHidPeripheral.h for documentation of this method.
 UsbHidPeripheral::~UsbHidPeripheral()
 {
+    // Stop the reader before the device it reads is closed.
+    delete m_reader;
+    delete m_usbfs;
     if (m_device)
     {
         hid_close(m_device);
@@ -125,8 +196,43 @@ status_t UsbHidPeripheral::read(uint8_t *buffer, uint32_t requestedBytes, uint32
 {
     assert(buffer);
 
-    // Read the requested number of bytes.
-    int count = hid_read_timeout(m_device, buffer, requestedBytes, timeout);
+    // Read the next report, whatever its ID.
+    int count = m_reader->read(UsbHidReaderThread::kAnyReportId, false, buffer, requestedBytes, timeout);
+    return completeRead(buffer, count, actualBytes);
+}
+
+// See UsbHidPeripheral.h for documentation of this method.
+status_t UsbHidPeripheral::readReport(uint8_t reportId,
+                                      bool isDiscardingOthers,
+                                      uint8_t *buffer,
+                                      uint32_t requestedBytes,
+                                      uint32_t *actualBytes,
+                                      uint32_t timeoutMs)
+{
+    assert(buffer);
+
+    int count = m_reader->read(reportId, isDiscardingOthers, buffer, requestedBytes, timeoutMs);
+    return completeRead(buffer, count, actualBytes);
+}
+
+// See UsbHidPeripheral.h for documentation of this method.
+bool UsbHidPeripheral::isReportPending() const
+{
+    return m_reader->isReportPending();
+}
+
+// See UsbHidPeripheral.h for documentation of this method.
+void UsbHidPeripheral::discardWrites()
+{
+    if (m_usbfs)
+    {
+        m_usbfs->discardWrites();
+    }
+}
+
+// See UsbHidPeripheral.h for documentation of this method.
+status_t UsbHidPeripheral::completeRead(const uint8_t *buffer, int count, uint32_t *actualBytes)
+{
     if (actualBytes)
     {
         *actualBytes = count;
@@ -184,6 +290,12 @@ status_t UsbHidPeripheral::write(const uint8_t *buffer, uint32_t byteCount, uint
         Log::debug2("]\n");
     }
 
+    if (m_usbfs)
+    {
+        // Failures are logged by the backend.
+        return (m_usbfs->write(buffer, byteCount, timeoutMS) < 0) ? kStatus_Fail : kStatus_Success;
+    }
+
     int count = hid_write_timeout(m_device, buffer, byteCount, timeoutMS);
     if (count < 0)
     {
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "blfwk/UsbHidReaderThread.h"
+#include "blfwk/Logging.h"
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+using namespace blfwk;
+
+//! Longest time the thread blocks in a read, so that it notices when it is stopped, in milliseconds.
+static const int kReadPollMs = 50;
+
+UsbHidReaderThread::UsbHidReaderThread(const read_function_t &readReport, size_t reportSize, size_t reportCount)
+    : m_readReport(readReport)
+    , m_reportSize(reportSize)
+    , m_reports(reportSize * reportCount)
+    , m_slots(reportCount)
+    , m_head(0)
+    , m_count(0)
+    , m_isStopped(false)
+    , m_isFailed(false)
+    , m_unreadCount(0)
+{
+    m_thread = std::thread(&UsbHidReaderThread::run, this);
+}
+
+UsbHidReaderThread::~UsbHidReaderThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopped = true;
+        m_condition.notify_all();
+    }
+    m_thread.join();
+}
+
+int UsbHidReaderThread::read(int reportId, bool isDiscardingOthers, uint8_t *buffer, uint32_t size, uint32_t timeoutMs)
+{
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        int length = take(reportId, isDiscardingOthers, buffer, size);
+        if (length >= 0)
+        {
+            return length;
+        }
+        if (m_isFailed)
+        {
+            return -1;
+        }
+        if (m_condition.wait_until(lock, deadline) == std::cv_status::timeout)
+        {
+            length = take(reportId, isDiscardingOthers, buffer, size);
+            return (length >= 0) ? length : (m_isFailed ? -1 : 0);
+        }
+    }
+}
+
+void UsbHidReaderThread::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        m_slots[(m_head + i) % m_slots.size()].isRead = true;
+    }
+    m_unreadCount = 0;
+    advanceHead();
+}
+
+int UsbHidReaderThread::take(int reportId, bool isDiscardingOthers, uint8_t *buffer, uint32_t size)
+{
+    int length = -1;
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        size_t index = (m_head + i) % m_slots.size();
+        slot_t &slot = m_slots[index];
+        if (slot.isRead)
+        {
+            continue;
+        }
+        const uint8_t *report = &m_reports[index * m_reportSize];
+        if ((reportId == kAnyReportId) || (report[0] == reportId))
+        {
+            length = (int)std::min(slot.length, size);
+            memcpy(buffer, report, length);
+            slot.isRead = true;
+            --m_unreadCount;
+            break;
+        }
+        if (isDiscardingOthers)
+        {
+            Log::debug("usbhid: discarding report=%x received before report=%x\n", report[0], reportId);
+            slot.isRead = true;
+            --m_unreadCount;
+        }
+    }
+    advanceHead();
+    return length;
+}
+
+void UsbHidReaderThread::advanceHead()
+{
+    bool isFreed = false;
+    while (m_count && m_slots[m_head].isRead)
+    {
+        m_head = (m_head + 1) % m_slots.size();
+        --m_count;
+        isFreed = true;
+    }
+    if (isFreed)
+    {
+        m_condition.notify_all();
+    }
+}
+
+void UsbHidReaderThread::run()
+{
+    for (;;)
+    {
+        // Wait for a free slot. Only this thread adds reports, so the slot stays free.
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_isStopped || (m_count < m_slots.size()); });
+            if (m_isStopped)
+            {
+                break;
+            }
+            index = (m_head + m_count) % m_slots.size();
+        }
+
+        uint8_t *report = &m_reports[index * m_reportSize];
+        int count = m_readReport(report, m_reportSize, kReadPollMs);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (count < 0)
+        {
+            m_isFailed = true;
+            m_condition.notify_all();
+            break;
+        }
+        m_slots[index].length = (uint32_t)count;
+        m_slots[index].isRead = false;
+        ++m_count;
+        ++m_unreadCount;
+        m_condition.notify_all();
+    }
+}
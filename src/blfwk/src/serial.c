@@ -29,10 +29,73 @@
 
 #include "blfwk/serial.h"
 
+#if !defined(WIN32)
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#endif // WIN32
+
 #ifdef LINUX
 #include <termios.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+// The termios2 interface sets arbitrary baud rates. Its header <asm/termbits.h> cannot be
+// included together with <termios.h>, so the kernel structure is declared here. TCGETS2
+// and TCSETS2 are only defined on architectures that use this layout.
+#if defined(TCGETS2) && defined(TCSETS2)
+#define SERIAL_HAVE_TERMIOS2 1
+#define SERIAL_KERNEL_NCCS 19
+
+#ifndef BOTHER
+#define BOTHER 0010000
 #endif
 
+struct termios2
+{
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[SERIAL_KERNEL_NCCS];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+#endif // TCGETS2 && TCSETS2
+#endif // LINUX
+
+#if defined(LINUX)
+// Sets a baud rate that has no Bxxxx constant, after the rest of the port
+// configuration has been applied with tcsetattr().
+static int serial_set_custom_speed(int fd, speed_t speed)
+{
+#if defined(SERIAL_HAVE_TERMIOS2)
+    struct termios2 tty2;
+
+    if (ioctl(fd, TCGETS2, &tty2) < 0)
+    {
+        return -1;
+    }
+
+    tty2.c_cflag &= ~CBAUD;
+    tty2.c_cflag |= BOTHER;
+    tty2.c_ispeed = speed;
+    tty2.c_ospeed = speed;
+
+    if (ioctl(fd, TCSETS2, &tty2) < 0)
+    {
+        return -1;
+    }
+
+    return 0;
+#else
+    return -1;
+#endif // SERIAL_HAVE_TERMIOS2
+}
+#endif // LINUX
+
 int serial_setup(int fd, speed_t speed)
 {
 #if defined(WIN32)
@@ -69,6 +132,9 @@ int serial_setup(int fd, speed_t speed)
 
 #elif defined(LINUX) || defined(MACOSX)
     struct termios tty;
+#if defined(LINUX)
+    speed_t customSpeed = 0;
+#endif // LINUX
 
     memset(&tty, 0x00, sizeof(tty));
     cfmakeraw(&tty);
@@ -79,8 +145,7 @@ int serial_setup(int fd, speed_t speed)
     tty.c_lflag = 0;
 
 #if defined(LINUX)
-    // Non standard baud rates depend on the specific system.
-    // Only supports standard baud rates.
+    // Standard baud rates have a Bxxxx constant, any other rate is set with the BOTHER flag.
     switch (speed)
     {
         case 9600:
@@ -138,8 +203,9 @@ int serial_setup(int fd, speed_t speed)
             speed = B4000000;
             break;
         default:
-            printf("Warning: unsupported standard baud rate(%d), set to default(57600)\n", speed);
-            speed = B57600;
+            // Not a standard baud rate. Set it through termios2 once the port is configured.
+            customSpeed = speed;
+            speed = B38400;
             break;
     }
     cfsetospeed(&tty, speed);
@@ -162,6 +228,14 @@ int serial_setup(int fd, speed_t speed)
         return -1;
     }
 
+#if defined(LINUX)
+    if (customSpeed && (serial_set_custom_speed(fd, customSpeed) < 0))
+    {
+        fprintf(stderr, "Could not set non-standard baud rate(%u).\n", (unsigned)customSpeed);
+        return -1;
+    }
+#endif // LINUX
+
 #if defined(MACOSX)
     if (ioctl(fd, IOSSIOSPEED, &speed) == -1)
     {
@@ -183,6 +257,126 @@ int serial_setup(int fd, speed_t speed)
     return 0;
 }
 
+int serial_set_flow_control(int fd, int enable)
+{
+#if defined(WIN32)
+    DCB dcb = { 0 };
+    HANDLE hCom = (HANDLE)fd;
+
+    dcb.DCBlength = sizeof(dcb);
+    if (!GetCommState(hCom, &dcb))
+    {
+        return -1;
+    }
+
+    // The port stops sending while CTS is deasserted, and deasserts RTS when its receive buffer fills up.
+    dcb.fOutxCtsFlow = enable ? TRUE : FALSE;
+    dcb.fRtsControl = enable ? RTS_CONTROL_HANDSHAKE : RTS_CONTROL_ENABLE;
+
+    if (!SetCommState(hCom, &dcb))
+    {
+        return -1;
+    }
+
+#elif defined(LINUX) || defined(MACOSX)
+    struct termios tty;
+
+    if (tcgetattr(fd, &tty) < 0)
+    {
+        return -1;
+    }
+
+    // The port stops sending while CTS is deasserted, and deasserts RTS when its receive buffer fills up.
+    if (enable)
+    {
+        tty.c_cflag |= CRTSCTS;
+    }
+    else
+    {
+        tty.c_cflag &= ~CRTSCTS;
+    }
+
+    if (tcsetattr(fd, TCSANOW, &tty) < 0)
+    {
+        return -1;
+    }
+
+    // Not every driver supports hardware flow control, so check that the setting was kept.
+    if (tcgetattr(fd, &tty) < 0 || (!(tty.c_cflag & CRTSCTS) != !enable))
+    {
+        return -1;
+    }
+#endif // WIN32
+
+    return 0;
+}
+
+int serial_set_low_latency(int fd)
+{
+#if defined(LINUX)
+    struct serial_struct serial;
+
+    // Tells the driver to push received characters to the reader immediately instead of
+    // batching them, and on drivers that support it also lowers the adapter latency timer.
+    if (ioctl(fd, TIOCGSERIAL, &serial) < 0)
+    {
+        return -1;
+    }
+
+    serial.flags |= ASYNC_LOW_LATENCY;
+
+    if (ioctl(fd, TIOCSSERIAL, &serial) < 0)
+    {
+        return -1;
+    }
+
+    return 0;
+#else
+    return -1;
+#endif // LINUX
+}
+
+int serial_set_latency_timer(const char *port, unsigned int latencyMs)
+{
+#if defined(LINUX)
+    char device[PATH_MAX];
+    char path[PATH_MAX + 64];
+    const char *name;
+    FILE *file;
+    int result;
+
+    // Resolve links such as /dev/serial/by-id/... to the tty device name.
+    if (!realpath(port, device))
+    {
+        return -1;
+    }
+    name = strrchr(device, '/');
+    name = name ? name + 1 : device;
+
+    // FTDI adapters expose their latency timer, 16 ms by default, in sysfs.
+    snprintf(path, sizeof(path), "/sys/class/tty/%s/device/latency_timer", name);
+    if (access(path, F_OK) != 0)
+    {
+        return 1;
+    }
+
+    file = fopen(path, "w");
+    if (!file)
+    {
+        return -1;
+    }
+    result = fprintf(file, "%u\n", latencyMs);
+    if (fclose(file) != 0)
+    {
+        result = -1;
+    }
+
+    return (result < 0) ? -1 : 0;
+#else
+    return 1;
+#endif // LINUX
+}
+
 int serial_set_read_timeout(int fd, uint32_t timeoutMs)
 {
 #if defined(WIN32)
@@ -336,6 +530,74 @@ int serial_read(int fd, char *buf, int size)
 #endif
 }
 
+#if !defined(WIN32)
+// Milliseconds on the monotonic clock, which is not affected by changes of the wall clock.
+static uint64_t serial_get_monotonic_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+#endif // WIN32
+
+int serial_read_timeout(int fd, char *buf, int size, uint32_t timeoutMs)
+{
+#ifdef WIN32
+    // ReadFile() applies the timeouts set with serial_set_read_timeout().
+    (void)timeoutMs;
+    return serial_read(fd, buf, size);
+#else
+    uint64_t deadline = serial_get_monotonic_ms() + timeoutMs;
+    int len = 0;
+
+    while (len < size)
+    {
+        uint64_t now = serial_get_monotonic_ms();
+        if (now >= deadline)
+        {
+            break;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        uint64_t waitMs = deadline - now;
+        int ret = poll(&pfd, 1, (waitMs > INT_MAX) ? INT_MAX : (int)waitMs);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (ret == 0)
+        {
+            break;
+        }
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+        {
+            return -1;
+        }
+
+        ret = read(fd, buf + len, size - len);
+        if (ret < 0)
+        {
+            if ((errno == EINTR) || (errno == EAGAIN))
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        len += ret;
+    }
+
+    return len;
+#endif
+}
+
 int serial_open(char *port)
 {
     int fd;
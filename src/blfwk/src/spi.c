@@ -7,6 +7,7 @@
  */
 
 #include "spi.h"
+#include <string.h>
 
 /*******************************************************************************
  * Definitions
@@ -14,12 +15,29 @@
 
 #define DEFAULT_BITS_PER_WORD (8)
 
+//! Path of the spidev buffer size parameter, the most bytes one message may move in each direction.
+#define SPIDEV_BUFSIZ_PATH "/sys/module/spidev/parameters/bufsiz"
+
+//! Default spidev buffer size, used when the parameter cannot be read.
+#define DEFAULT_SPIDEV_BUFSIZ (4096)
+
+//! spidev rounds the length of each transfer up to the kmalloc alignment when it checks the buffer
+//! size. 128 bytes is the largest alignment of the supported architectures.
+#define SPIDEV_TRANSFER_ALIGN (128)
+
+//! Most transfers submitted in one message.
+#define MAX_MESSAGE_TRANSFERS (32)
+
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 
+//! Speed and word size set by spi_setup(), applied to every transfer.
 static struct spi_ioc_transfer spi_data;
 
+//! Most bytes one message may move in each direction, read by spi_open().
+static uint32_t spi_bufsiz = DEFAULT_SPIDEV_BUFSIZ;
+
 /*******************************************************************************
  * Codes
  ******************************************************************************/
@@ -66,29 +84,124 @@ int spi_set_timeout(int fd, uint32_t milliseconds)
     return 0;
 }
 
-// See spi.h for documentation of this method.
-int spi_write(int fd, char *buf, int size)
+//! @brief Returns the room a transfer of @a len bytes takes in the spidev buffer.
+static uint32_t spi_aligned_length(uint32_t len)
 {
-    if (fd < 0)
+    return (len + SPIDEV_TRANSFER_ALIGN - 1) & ~(uint32_t)(SPIDEV_TRANSFER_ALIGN - 1);
+}
+
+//! @brief Submits @a count transfers as one message.
+//!
+//! @a is_last tells whether the last transfer ends the batch. If it does not, its chip select
+//! change is inverted, because on the last transfer of a message cs_change asks to keep the
+//! device selected, while between transfers it asks to deselect it.
+static int spi_submit(int fd, struct spi_ioc_transfer *transfers, int count, bool is_last)
+{
+    struct spi_ioc_transfer *last = &transfers[count - 1];
+    uint8_t cs_change = last->cs_change;
+    int ret;
+
+    if (!is_last)
+    {
+        last->cs_change = !cs_change;
+    }
+    ret = ioctl(fd, SPI_IOC_MESSAGE(count), transfers);
+    last->cs_change = cs_change;
+
+    return ret;
+}
+
+//! @brief Submits @a count transfers with as few messages as possible.
+//!
+//! Transfers are grouped into messages that fit the spidev buffer, and transfers larger than the
+//! buffer are split, asking the controller to keep the device selected between the parts.
+//! Transfers with no speed or word size use the ones given to spi_setup().
+//!
+//! @return The number of bytes transferred, or a negative value on error.
+static int spi_transfer_batch(int fd, const struct spi_ioc_transfer *transfers, int count)
+{
+    struct spi_ioc_transfer message[MAX_MESSAGE_TRANSFERS];
+    uint32_t room = spi_bufsiz;
+    int pending = 0;
+    int total = 0;
+    int i;
+
+    if ((fd < 0) || (transfers == NULL) || (count < 0))
     {
         return -1;
     }
 
-    /*
-     * Do not convert a pointer type to __u64 directly. It will lead an issue for 32bit archtectures
-     */
-    spi_data.tx_buf = (intptr_t)buf;
-    spi_data.rx_buf = (intptr_t)NULL;
-    spi_data.len = size;
-    spi_data.cs_change = 0;
+    for (i = 0; i < count; i++)
+    {
+        uint32_t offset = 0;
 
-    return ioctl(fd, SPI_IOC_MESSAGE(1), &spi_data);
+        // Transfers larger than the spidev buffer are split, keeping the device selected between the parts.
+        do
+        {
+            uint32_t len = transfers[i].len - offset;
+            struct spi_ioc_transfer *transfer;
+
+            if (pending && ((pending == MAX_MESSAGE_TRANSFERS) || (spi_aligned_length(len) > room)))
+            {
+                int ret = spi_submit(fd, message, pending, false);
+                if (ret < 0)
+                {
+                    return ret;
+                }
+                total += ret;
+                pending = 0;
+                room = spi_bufsiz;
+            }
+
+            transfer = &message[pending++];
+            *transfer = transfers[i];
+            if (spi_aligned_length(len) > room)
+            {
+                len = room & ~(uint32_t)(SPIDEV_TRANSFER_ALIGN - 1);
+                transfer->cs_change = 0;
+            }
+            transfer->len = len;
+            if (transfer->tx_buf)
+            {
+                transfer->tx_buf += offset;
+            }
+            if (transfer->rx_buf)
+            {
+                transfer->rx_buf += offset;
+            }
+            if (!transfer->speed_hz)
+            {
+                transfer->speed_hz = spi_data.speed_hz;
+            }
+            if (!transfer->bits_per_word)
+            {
+                transfer->bits_per_word = spi_data.bits_per_word;
+            }
+            room -= spi_aligned_length(len);
+            offset += len;
+        } while (offset < transfers[i].len);
+    }
+
+    if (pending)
+    {
+        int ret = spi_submit(fd, message, pending, true);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        total += ret;
+    }
+
+    return total;
 }
 
-// See spi.h for documentation of this method.
-int spi_read(int fd, char *buf, int size)
+//! @brief Writes and reads @a size bytes at the same time. Either buffer may be NULL, in which
+//! case zeros are sent or the received bytes are dropped.
+static int spi_transfer(int fd, const char *tx_buf, char *rx_buf, int size)
 {
-    if (fd < 0)
+    struct spi_ioc_transfer transfer;
+
+    if (size < 0)
     {
         return -1;
     }
@@ -96,18 +209,32 @@ int spi_read(int fd, char *buf, int size)
     /*
      * Do not convert a pointer type to __u64 directly. It will lead an issue for 32bit archtectures
      */
-    spi_data.tx_buf = (intptr_t)NULL;
-    spi_data.rx_buf = (intptr_t)buf;
-    spi_data.len = size;
-    spi_data.cs_change = 0;
+    memset(&transfer, 0, sizeof(transfer));
+    transfer.tx_buf = (intptr_t)tx_buf;
+    transfer.rx_buf = (intptr_t)rx_buf;
+    transfer.len = size;
+
+    return spi_transfer_batch(fd, &transfer, 1);
+}
+
+// See spi.h for documentation of this method.
+int spi_write(int fd, char *buf, int size)
+{
+    return spi_transfer(fd, buf, NULL, size);
+}
 
-    return ioctl(fd, SPI_IOC_MESSAGE(1), &spi_data);
+// See spi.h for documentation of this method.
+int spi_read(int fd, char *buf, int size)
+{
+    return spi_transfer(fd, NULL, buf, size);
 }
 
 // See spi.h for documentation of this method.
 int spi_open(char *port)
 {
     int fd = -1;
+    FILE *bufsiz = NULL;
+    unsigned int value = 0;
 
     if (port == NULL)
     {
@@ -118,6 +245,19 @@ int spi_open(char *port)
     if (fd < 0)
     {
         fprintf(stderr, "Failed to open SPI port(%s).\n", port);
+        return fd;
+    }
+
+    // Messages are split to fit the buffer of the spidev driver, which is a module parameter.
+    bufsiz = fopen(SPIDEV_BUFSIZ_PATH, "r");
+    spi_bufsiz = DEFAULT_SPIDEV_BUFSIZ;
+    if (bufsiz)
+    {
+        if ((fscanf(bufsiz, "%u", &value) == 1) && (value >= SPIDEV_TRANSFER_ALIGN))
+        {
+            spi_bufsiz = value;
+        }
+        fclose(bufsiz);
     }
 
     return fd;
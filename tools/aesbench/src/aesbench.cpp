@@ -0,0 +1,311 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "blfwk/AESHardware.h"
+#include "blfwk/Logging.h"
+#include "blfwk/options.h"
+#include "blfwk/rijndael.h"
+#include "blfwk/utils.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// Variables
+////////////////////////////////////////////////////////////////////////////////
+
+//! @brief The tool's name.
+const char k_toolName[] = "aesbench";
+
+//! @brief Current version number for the tool.
+const char k_version[] = "1.0.0";
+
+//! @brief Copyright string.
+const char k_copyright[] = "Copyright 2026 NXP\nAll rights reserved.";
+
+//! @brief Command line option definitions.
+static const char *k_optionsDefinition[] = { "?|help", "v|version", "s:size <bytes>", NULL };
+
+//! @brief Usage text.
+const char k_optionUsage[] =
+    "\nChecks that the AES-128 CTR backend that uses the AES instructions of the\n\
+processor, AES-NI on x86 or the ARMv8 Cryptography Extension on AArch64, gives\n\
+the same output as the software implementation, then measures the throughput\n\
+of both. Exits with status 1 if the outputs differ.\n\
+\n\
+Options:\n\
+  -?/--help                    Show this help\n\
+  -v/--version                 Display tool version\n\
+  -s/--size <bytes>            Amount of data encrypted by each backend when\n\
+                               measuring the throughput (default=16MB)\n";
+
+//! @brief Default amount of data of the throughput measurement.
+static const uint32_t kDefaultSize = 16 * 1024 * 1024;
+
+//! @brief Size of an AES block.
+static const size_t kBlockSize = 16;
+
+//! @brief Counter steps checked. RijndaelCTR increments the counter by the block size.
+static const unsigned kCounterSteps[] = { 1, kBlockSize };
+
+//! @brief Numbers of blocks checked, around multiples of the blocks the hardware processes at a time.
+static const size_t kBlockCounts[] = { 1, 2, 7, 8, 9, 15, 16, 17, 33, 1000 };
+
+/*!
+ * \brief Class that encapsulates the aesbench tool.
+ *
+ * The software implementation encrypts each counter block with Rijndael in ECB
+ * mode, which is what RijndaelCTR does on processors without AES instructions.
+ */
+class AesBench
+{
+public:
+    //! @brief Constructor. Creates the singleton logger instance.
+    AesBench(int argc, char *argv[])
+        : m_argc(argc)
+        , m_argv(argv)
+        , m_logger(NULL)
+        , m_size(kDefaultSize)
+        , m_random()
+    {
+        m_logger = new StdoutLogger();
+        m_logger->setFilterLevel(Logger::kInfo);
+        Log::setLogger(m_logger);
+    }
+
+    //! @brief Destructor.
+    virtual ~AesBench() {}
+
+    //! @brief Run the application.
+    int run();
+
+protected:
+    //! @brief Process command line options.
+    int processOptions();
+
+    //! @brief Encrypts @a blocks blocks of @a data in CTR mode with the software implementation.
+    static void processCtrSoftware(
+        const uint8_t *key, uint8_t *counter, unsigned counterStep, const uint8_t *data, size_t blocks, uint8_t *dest);
+
+    //! @brief Adds @a step to the 128-bit big-endian @a counter.
+    static void incrementCounter(uint8_t *counter, unsigned step);
+
+    //! @brief Compares the output of both backends on random data.
+    //!
+    //! @return False if they differ.
+    bool checkOutput();
+
+    //! @brief Measures and logs the throughput of both backends.
+    void measureThroughput();
+
+protected:
+    int m_argc;             //!< Number of command line arguments.
+    char **m_argv;          //!< Command line arguments.
+    StdoutLogger *m_logger; //!< Singleton logger instance.
+    uint32_t m_size;        //!< Amount of data of the throughput measurement.
+    std::mt19937 m_random;  //!< Source of the keys, counters and data checked.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Code
+////////////////////////////////////////////////////////////////////////////////
+
+//! @retval -1 The tool should run.
+//! @retval 0 The tool should exit with success, after showing the help or version.
+//! @retval 1 The options are not valid.
+int AesBench::processOptions()
+{
+    Options options(*m_argv, k_optionsDefinition);
+    OptArgvIter iter(--m_argc, ++m_argv);
+
+    // Process command line options.
+    int optchar;
+    const char *optarg;
+    while ((optchar = options(iter, optarg)))
+    {
+        switch (optchar)
+        {
+            case '?':
+                options.usage(std::cout, "");
+                printf(k_optionUsage);
+                return 0;
+
+            case 'v':
+                printf("%s %s\n%s\n", k_toolName, k_version, k_copyright);
+                return 0;
+
+            case 's':
+                if (!utils::stringtoui(optarg, m_size) || (m_size < kBlockSize))
+                {
+                    Log::error("Error: %s is not valid for option -s/--size.\n", optarg);
+                    options.usage(std::cout, "");
+                    return 1;
+                }
+                break;
+
+            // All other cases are errors.
+            default:
+                return 1;
+        }
+    }
+
+    return -1;
+}
+
+void AesBench::incrementCounter(uint8_t *counter, unsigned step)
+{
+    unsigned carry = step;
+    for (int i = kBlockSize - 1; (i >= 0) && carry; --i)
+    {
+        carry += counter[i];
+        counter[i] = static_cast<uint8_t>(carry);
+        carry >>= 8;
+    }
+}
+
+void AesBench::processCtrSoftware(
+    const uint8_t *key, uint8_t *counter, unsigned counterStep, const uint8_t *data, size_t blocks, uint8_t *dest)
+{
+    Rijndael cipher;
+    cipher.init(Rijndael::ECB, Rijndael::Encrypt, key, Rijndael::Key16Bytes);
+
+    uint8_t keyStream[kBlockSize];
+    for (size_t block = 0; block < blocks; ++block)
+    {
+        cipher.blockEncrypt(counter, kBlockSize * 8, keyStream);
+        for (size_t i = 0; i < kBlockSize; ++i)
+        {
+            dest[block * kBlockSize + i] = data[block * kBlockSize + i] ^ keyStream[i];
+        }
+        incrementCounter(counter, counterStep);
+    }
+}
+
+//! Counters start just below a carry out of the low 64 bits, so that the carry into
+//! the high half is checked too. Each case is also checked in place.
+bool AesBench::checkOutput()
+{
+    bool isMatching = true;
+    unsigned caseCount = 0;
+
+    for (size_t stepIndex = 0; stepIndex < sizeof(kCounterSteps) / sizeof(kCounterSteps[0]); ++stepIndex)
+    {
+        for (size_t countIndex = 0; countIndex < sizeof(kBlockCounts) / sizeof(kBlockCounts[0]); ++countIndex)
+        {
+            unsigned step = kCounterSteps[stepIndex];
+            size_t blocks = kBlockCounts[countIndex];
+
+            uint8_t key[kBlockSize];
+            uint8_t counter[kBlockSize];
+            std::vector<uint8_t> data(blocks * kBlockSize);
+            for (size_t i = 0; i < kBlockSize; ++i)
+            {
+                key[i] = static_cast<uint8_t>(m_random());
+                counter[i] = (i < 8) ? static_cast<uint8_t>(m_random()) : 0xff;
+            }
+            counter[kBlockSize - 1] = static_cast<uint8_t>(0x100 - step * 3);
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                data[i] = static_cast<uint8_t>(m_random());
+            }
+
+            uint8_t softwareCounter[kBlockSize];
+            uint8_t hardwareCounter[kBlockSize];
+            std::vector<uint8_t> softwareOutput(data.size());
+            std::vector<uint8_t> hardwareOutput(data.size());
+            memcpy(softwareCounter, counter, kBlockSize);
+            memcpy(hardwareCounter, counter, kBlockSize);
+            processCtrSoftware(key, softwareCounter, step, &data[0], blocks, &softwareOutput[0]);
+            AESHardware::processCtr(key, hardwareCounter, step, &data[0], blocks, &hardwareOutput[0]);
+
+            std::vector<uint8_t> inPlace(data);
+            memcpy(hardwareCounter, counter, kBlockSize);
+            AESHardware::processCtr(key, hardwareCounter, step, &inPlace[0], blocks, &inPlace[0]);
+
+            if ((hardwareOutput != softwareOutput) || (inPlace != softwareOutput) ||
+                (memcmp(hardwareCounter, softwareCounter, kBlockSize) != 0))
+            {
+                Log::error("Error: output differs for %u blocks with counter step %u\n", (unsigned)blocks, step);
+                isMatching = false;
+            }
+            ++caseCount;
+        }
+    }
+
+    Log::info("%s: %u cases %s\n", AESHardware::getName(), caseCount,
+              isMatching ? "match the software implementation" : "checked, some differ");
+    return isMatching;
+}
+
+void AesBench::measureThroughput()
+{
+    uint8_t key[kBlockSize];
+    uint8_t counter[kBlockSize];
+    memset(key, 0x2b, sizeof(key));
+    size_t blocks = m_size / kBlockSize;
+    std::vector<uint8_t> data(blocks * kBlockSize);
+
+    for (int backend = 0; backend < 2; ++backend)
+    {
+        bool isHardware = (backend == 0);
+        if (isHardware && !AESHardware::isAvailable())
+        {
+            continue;
+        }
+
+        memset(counter, 0, sizeof(counter));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (isHardware)
+        {
+            AESHardware::processCtr(key, counter, kBlockSize, &data[0], blocks, &data[0]);
+        }
+        else
+        {
+            processCtrSoftware(key, counter, kBlockSize, &data[0], blocks, &data[0]);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Log::info("%-24s %8.1f MB/s\n", isHardware ? AESHardware::getName() : "software",
+                  (data.size() / (1024.0 * 1024.0)) / seconds);
+    }
+}
+
+int AesBench::run()
+{
+    int result = processOptions();
+    if (result != -1)
+    {
+        return result;
+    }
+
+    if (!AESHardware::isAvailable())
+    {
+        Log::info("No AES instructions, or they failed the test vector. Measuring the software implementation only.\n");
+    }
+    else if (!checkOutput())
+    {
+        return 1;
+    }
+
+    measureThroughput();
+    return 0;
+}
+
+//! @brief Application entry point.
+int main(int argc, char *argv[])
+{
+    return AesBench(argc, argv).run();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EOF
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,914 @@
+/*
+ * Copyright 2026 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <linux/uhid.h>
+
+#include "blfwk/LatencyStats.h"
+#include "blfwk/Logging.h"
+#include "blfwk/UsbHidPeripheral.h"
+#include "blfwk/options.h"
+#include "blfwk/utils.h"
+#include "bootloader/bl_peripheral.h"
+#include "bootloader_common.h"
+#include "bootloader_hid_report_ids.h"
+#include "memory/memory.h"
+#include "property/property.h"
+
+using namespace blfwk;
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// Variables
+////////////////////////////////////////////////////////////////////////////////
+
+//! @brief The tool's name.
+const char k_toolName[] = "blhidsim";
+
+//! @brief Current version number for the tool.
+const char k_version[] = "1.0.0";
+
+//! @brief Copyright string.
+const char k_copyright[] = "Copyright 2026 NXP\nAll rights reserved.";
+
+//! @brief Command line option definitions.
+static const char *k_optionsDefinition[] = { "?|help",
+                                             "v|version",
+                                             "u:usb [<vid>,]<pid>",
+                                             "m:memory [<start>,]<size>",
+                                             "P:packet <size>",
+                                             "i:interval <us>",
+                                             "V|verbose",
+                                             "d|debug",
+                                             NULL };
+
+//! @brief Usage text.
+const char k_optionUsage[] =
+    "\nCreates a virtual USB HID bootloader through /dev/uhid, so blhost can run\n\
+HID transfers without a target, and reports the timing of the host.\n\
+Runs until interrupted with Ctrl+C. Only available on Linux, and needs\n\
+read and write access to /dev/uhid.\n\
+\n\
+Options:\n\
+  -?/--help                    Show this help\n\
+  -v/--version                 Display tool version\n\
+  -u/--usb [<vid>,]<pid>       USB vid/pid of the device\n\
+                                 (default=0x15a2,0x0073)\n\
+  -m/--memory [<start>,]<size> Address and size in bytes of the memory of\n\
+                               the device, erased to 0xff and reported as\n\
+                               flash (default=0,0x100000)\n\
+  -P/--packet <size>           Largest packet of a report in bytes, 56 for a\n\
+                               full speed target and up to 1016 for a high\n\
+                               speed one (default=56)\n\
+  -i/--interval <us>           Least time between two input reports, as the\n\
+                               polling interval of the interrupt IN endpoint\n\
+                               (default=125). The kernel drops input reports\n\
+                               that the host does not read in time, so\n\
+                               keep it above the time blhost takes to read one\n\
+  -V/--verbose                 Print the timing of each command\n\
+  -d/--debug                   Print every report\n\
+\n\
+Host timing:\n\
+  turnaround                   Time from the end of a response of the device\n\
+                               to the next report of the host\n\
+  data gap                     Time between two data reports of the host\n\
+  throughput                   Bytes of the data phases over their duration,\n\
+                               from the command to the last data report\n";
+
+//! @brief Largest packet of a full speed report.
+static const uint32_t kDefaultPacketSize = 56;
+
+//! @brief Largest packet of a high speed report, which may not exceed 1024 bytes with its header.
+static const uint32_t kMaxPacketSize = 1016;
+
+//! @brief Default memory size in bytes.
+static const uint32_t kDefaultMemorySize = 0x100000;
+
+//! @brief Size of a flash sector, the unit of erases.
+static const uint32_t kSectorSize = 0x1000;
+
+//! @brief Default time between two input reports, one high speed microframe.
+static const uint32_t kDefaultIntervalUs = 125;
+
+//! @brief Time the device stays away after a reset, in milliseconds.
+static const uint32_t kResetDelayMs = 200;
+
+//! @brief Bootloader version reported by the device, 'K' 3.0.0.
+static const uint32_t kBootloaderVersion = 0x4b030000;
+
+//! @brief Set by the SIGINT handler to stop the device.
+static volatile sig_atomic_t s_isStopped = 0;
+
+/*!
+ * \brief Class that encapsulates the blhidsim tool.
+ *
+ * The device answers the commands of the bootloader that read and write memory and
+ * query properties, and acknowledges reset, execute and call. Other commands get an
+ * unknown command response. Writes go to a memory buffer, so data written can be
+ * read back, and resets make the device disconnect and come back, as a target does.
+ *
+ * Reports are timed as they arrive, which shows how long blhost takes to answer the
+ * device and how fast it sends data, independently of the speed of a real target.
+ */
+class BlHidSim
+{
+public:
+    //! @brief Constructor. Creates the singleton logger instance.
+    BlHidSim(int argc, char *argv[])
+        : m_argc(argc)
+        , m_argv(argv)
+        , m_logger(NULL)
+        , m_fd(-1)
+        , m_vid(UsbHidPeripheral::kDefault_Vid)
+        , m_pid(UsbHidPeripheral::kDefault_Pid)
+        , m_memoryStart(0)
+        , m_memory()
+        , m_packetSize(kDefaultPacketSize)
+        , m_intervalUs(kDefaultIntervalUs)
+        , m_isVerbose(false)
+        , m_lastInput()
+        , m_lastResponse()
+        , m_isResponseSent(false)
+        , m_commandTag(0)
+        , m_commandStart()
+        , m_lastData()
+        , m_dataAddress(0)
+        , m_dataRemaining(0)
+        , m_dataCount(0)
+        , m_turnaround()
+        , m_dataGaps()
+        , m_bytesOut(0)
+        , m_timeOutUs(0)
+        , m_bytesIn(0)
+        , m_timeInUs(0)
+    {
+        m_logger = new StdoutLogger();
+        m_logger->setFilterLevel(Logger::kInfo);
+        Log::setLogger(m_logger);
+    }
+
+    //! @brief Destructor.
+    virtual ~BlHidSim() {}
+
+    //! @brief Run the application.
+    int run();
+
+protected:
+    typedef std::chrono::steady_clock::time_point time_point_t;
+
+    //! @brief Process command line options.
+    int processOptions();
+
+    //! @brief Handler for the SIGINT signal.
+    static void ctrlPlusCHandler(int msg);
+
+    //! @brief Returns the time from @a start to @a end in microseconds.
+    static uint64_t getElapsedUs(const time_point_t &start, const time_point_t &end);
+
+    //! @brief Creates the uhid device.
+    bool createDevice();
+
+    //! @brief Destroys the uhid device, which disconnects it from the host.
+    void destroyDevice();
+
+    //! @brief Builds the report descriptor, with the four bootloader reports sized for the packet size.
+    std::vector<uint8_t> buildReportDescriptor() const;
+
+    //! @brief Handles one event of the uhid device.
+    //!
+    //! @return False if the device failed.
+    bool handleEvent();
+
+    //! @brief Handles output report @a report of @a length bytes, including the report ID.
+    void handleReport(const uint8_t *report, size_t length);
+
+    //! @brief Handles command packet @a packet of @a length bytes.
+    void handleCommand(const uint8_t *packet, uint32_t length);
+
+    //! @brief Handles data packet @a packet of @a length bytes of a write-memory data phase.
+    void handleData(const uint8_t *packet, uint32_t length);
+
+    //! @brief Answers get-property with the value of property @a tag.
+    void getProperty(uint32_t tag);
+
+    //! @brief Answers read-memory by sending @a byteCount bytes from @a address.
+    void readMemory(uint32_t address, uint32_t byteCount);
+
+    //! @brief Returns true if @a byteCount bytes from @a address lie in the memory.
+    bool isValidRange(uint32_t address, uint32_t byteCount) const;
+
+    //! @brief Sends a generic response to command @a commandTag with @a status.
+    void sendGenericResponse(uint32_t status, uint8_t commandTag);
+
+    //! @brief Sends command packet @a tag with @a flags and @a count parameters @a params.
+    void sendResponse(uint8_t tag, uint8_t flags, const uint32_t *params, uint8_t count);
+
+    //! @brief Sends packet @a packet of @a length bytes in input report @a reportId.
+    //!
+    //! Input reports are spaced by at least the interval given on the command line.
+    bool sendReport(uint8_t reportId, const uint8_t *packet, uint32_t length);
+
+    //! @brief Accounts for a data phase of @a byteCount bytes that ended at @a end.
+    void endDataPhase(uint32_t byteCount, bool isOut, const time_point_t &end);
+
+    //! @brief Logs the timing of the host.
+    void logStatistics() const;
+
+protected:
+    int m_argc;                    //!< Number of command line arguments.
+    char **m_argv;                 //!< Command line arguments.
+    StdoutLogger *m_logger;        //!< Singleton logger instance.
+    int m_fd;                      //!< The /dev/uhid file, or -1 when the device does not exist.
+    uint16_t m_vid;                //!< USB VID of the device.
+    uint16_t m_pid;                //!< USB PID of the device.
+    uint32_t m_memoryStart;        //!< Address of the memory of the device.
+    std::vector<uint8_t> m_memory; //!< Memory of the device.
+    uint32_t m_packetSize;         //!< Largest packet of a report.
+    uint32_t m_intervalUs;         //!< Least time between two input reports.
+    bool m_isVerbose;              //!< If true the timing of each command is logged.
+    time_point_t m_lastInput;      //!< Time the last input report was sent.
+    time_point_t m_lastResponse;   //!< Time the last response was sent.
+    bool m_isResponseSent;         //!< Whether a response was sent since the last report of the host.
+    uint8_t m_commandTag;          //!< Command of the current data phase, or 0 if there is none.
+    time_point_t m_commandStart;   //!< Time the current command was received.
+    time_point_t m_lastData;       //!< Time the last data report of the host was received.
+    uint32_t m_dataAddress;        //!< Address the next data packet of the host is written to.
+    uint32_t m_dataRemaining;      //!< Bytes of the current data phase not received yet.
+    uint32_t m_dataCount;          //!< Bytes of the current data phase.
+    LatencyStats m_turnaround;     //!< Times from the end of a response to the next report of the host.
+    LatencyStats m_dataGaps;       //!< Times between two data reports of the host.
+    uint64_t m_bytesOut;           //!< Bytes of the data phases from the host.
+    uint64_t m_timeOutUs;          //!< Duration of the data phases from the host.
+    uint64_t m_bytesIn;            //!< Bytes of the data phases to the host.
+    uint64_t m_timeInUs;           //!< Duration of the data phases to the host.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Code
+////////////////////////////////////////////////////////////////////////////////
+
+void BlHidSim::ctrlPlusCHandler(int msg)
+{
+    if (msg == SIGINT)
+    {
+        s_isStopped = 1;
+    }
+}
+
+uint64_t BlHidSim::getElapsedUs(const time_point_t &start, const time_point_t &end)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+int BlHidSim::processOptions()
+{
+    Options options(*m_argv, k_optionsDefinition);
+    OptArgvIter iter(--m_argc, ++m_argv);
+
+    // Process command line options.
+    int optchar;
+    const char *optarg;
+    while ((optchar = options(iter, optarg)))
+    {
+        switch (optchar)
+        {
+            case '?':
+                options.usage(std::cout, "");
+                printf(k_optionUsage);
+                return 0;
+
+            case 'v':
+                printf("%s %s\n%s\n", k_toolName, k_version, k_copyright);
+                return 0;
+
+            case 'u':
+            {
+                string_vector_t params = utils::string_split(optarg, ',');
+                uint32_t vid = m_vid;
+                uint32_t pid = 0;
+                if ((params.size() > 2) ||
+                    ((params.size() == 2) && (!utils::stringtoui(params[0].c_str(), vid) || (vid > 0xffff))) ||
+                    !utils::stringtoui(params.back().c_str(), pid) || (pid > 0xffff))
+                {
+                    Log::error("Error: %s is not valid for option -u/--usb.\n", optarg);
+                    options.usage(std::cout, "");
+                    return 0;
+                }
+                m_vid = (uint16_t)vid;
+                m_pid = (uint16_t)pid;
+                break;
+            }
+
+            case 'm':
+            {
+                string_vector_t params = utils::string_split(optarg, ',');
+                uint32_t start = 0;
+                uint32_t size = 0;
+                if ((params.size() > 2) || ((params.size() == 2) && !utils::stringtoui(params[0].c_str(), start)) ||
+                    !utils::stringtoui(params.back().c_str(), size) || (size == 0) ||
+                    ((uint64_t)start + size > 0x100000000ull))
+                {
+                    Log::error("Error: %s is not valid for option -m/--memory.\n", optarg);
+                    options.usage(std::cout, "");
+                    return 0;
+                }
+                m_memoryStart = start;
+                m_memory.resize(size);
+                break;
+            }
+
+            case 'P':
+                if (!utils::stringtoui(optarg, m_packetSize) || (m_packetSize < kMinPacketBufferSize) ||
+                    (m_packetSize > kMaxPacketSize))
+                {
+                    Log::error("Error: %s is not valid for option -P/--packet, which takes %u to %u.\n", optarg,
+                               (uint32_t)kMinPacketBufferSize, kMaxPacketSize);
+                    options.usage(std::cout, "");
+                    return 0;
+                }
+                break;
+
+            case 'i':
+                if (!utils::stringtoui(optarg, m_intervalUs))
+                {
+                    Log::error("Error: %s is not valid for option -i/--interval.\n", optarg);
+                    options.usage(std::cout, "");
+                    return 0;
+                }
+                break;
+
+            case 'V':
+                m_isVerbose = true;
+                break;
+
+            case 'd':
+                m_isVerbose = true;
+                Log::getLogger()->setFilterLevel(Logger::kDebug);
+                break;
+
+            // All other cases are errors.
+            default:
+                return 1;
+        }
+    }
+
+    if (m_memory.empty())
+    {
+        m_memory.resize(kDefaultMemorySize);
+    }
+    return -1;
+}
+
+std::vector<uint8_t> BlHidSim::buildReportDescriptor() const
+{
+    // Vendor defined reports of one byte fields, each holding the header and a packet.
+    uint32_t reportCount = (uint32_t)(sizeof(bl_hid_header_t) - 1) + m_packetSize;
+    std::vector<uint8_t> descriptor = {
+        0x06, 0x00, 0xff, // Usage Page (Vendor Defined 0xff00)
+        0x09, 0x01,       // Usage (1)
+        0xa1, 0x01,       // Collection (Application)
+    };
+    static const uint8_t kReportIds[] = { kBootloaderReportID_CommandOut, kBootloaderReportID_DataOut,
+                                          kBootloaderReportID_CommandIn, kBootloaderReportID_DataIn };
+    for (size_t i = 0; i < sizeof(kReportIds); ++i)
+    {
+        bool isOutput = (kReportIds[i] == kBootloaderReportID_CommandOut) ||
+                        (kReportIds[i] == kBootloaderReportID_DataOut);
+        uint8_t items[] = {
+            0x85, kReportIds[i],                                                // Report ID
+            0x09, 0x01,                                                         // Usage (1)
+            0x15, 0x00,                                                         // Logical Minimum (0)
+            0x26, 0xff, 0x00,                                                   // Logical Maximum (255)
+            0x75, 0x08,                                                         // Report Size (8)
+            0x96, (uint8_t)(reportCount & 0xff), (uint8_t)(reportCount >> 8),   // Report Count
+            (uint8_t)(isOutput ? 0x91 : 0x81), 0x02                             // Output or Input (Data, Var, Abs)
+        };
+        descriptor.insert(descriptor.end(), items, items + sizeof(items));
+    }
+    descriptor.push_back(0xc0); // End Collection
+    return descriptor;
+}
+
+bool BlHidSim::createDevice()
+{
+    m_fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+    if (m_fd < 0)
+    {
+        Log::error("Error: cannot open /dev/uhid: %s\n", strerror(errno));
+        return false;
+    }
+
+    std::vector<uint8_t> descriptor = buildReportDescriptor();
+    struct uhid_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = UHID_CREATE2;
+    snprintf((char *)event.u.create2.name, sizeof(event.u.create2.name), "NXP Virtual Bootloader");
+    snprintf((char *)event.u.create2.phys, sizeof(event.u.create2.phys), "%s/%d", k_toolName, (int)getpid());
+    snprintf((char *)event.u.create2.uniq, sizeof(event.u.create2.uniq), "BLHIDSIM");
+    event.u.create2.rd_size = (uint16_t)descriptor.size();
+    event.u.create2.bus = BUS_USB;
+    event.u.create2.vendor = m_vid;
+    event.u.create2.product = m_pid;
+    memcpy(event.u.create2.rd_data, descriptor.data(), descriptor.size());
+    if (write(m_fd, &event, sizeof(event)) != (ssize_t)sizeof(event))
+    {
+        Log::error("Error: cannot create the uhid device: %s\n", strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void BlHidSim::destroyDevice()
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+
+    struct uhid_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = UHID_DESTROY;
+    if (write(m_fd, &event, sizeof(event)) != (ssize_t)sizeof(event))
+    {
+        Log::debug("Cannot destroy the uhid device: %s\n", strerror(errno));
+    }
+    close(m_fd);
+    m_fd = -1;
+    m_isResponseSent = false;
+    m_commandTag = 0;
+}
+
+bool BlHidSim::handleEvent()
+{
+    struct uhid_event event;
+    ssize_t length = read(m_fd, &event, sizeof(event));
+    if (length < 0)
+    {
+        if ((errno == EINTR) || (errno == EAGAIN))
+        {
+            return true;
+        }
+        Log::error("Error: cannot read the uhid device: %s\n", strerror(errno));
+        return false;
+    }
+
+    switch (event.type)
+    {
+        case UHID_OPEN:
+            Log::debug("Host opened the device\n");
+            m_isResponseSent = false;
+            break;
+        case UHID_CLOSE:
+            Log::debug("Host closed the device\n");
+            m_isResponseSent = false;
+            m_commandTag = 0;
+            break;
+        case UHID_OUTPUT:
+            handleReport(event.u.output.data, event.u.output.size);
+            break;
+        case UHID_GET_REPORT:
+        {
+            // The bootloader only exchanges interrupt reports.
+            uint32_t id = event.u.get_report.id;
+            memset(&event, 0, sizeof(event));
+            event.type = UHID_GET_REPORT_REPLY;
+            event.u.get_report_reply.id = id;
+            event.u.get_report_reply.err = EIO;
+            if (write(m_fd, &event, sizeof(event)) != (ssize_t)sizeof(event))
+            {
+                Log::debug("Cannot answer a get report request: %s\n", strerror(errno));
+            }
+            break;
+        }
+        case UHID_SET_REPORT:
+        {
+            // Output reports sent over the control endpoint carry packets as well.
+            uint32_t id = event.u.set_report.id;
+            bool isOutput = (event.u.set_report.rtype == UHID_OUTPUT_REPORT);
+            if (isOutput)
+            {
+                handleReport(event.u.set_report.data, event.u.set_report.size);
+            }
+            memset(&event, 0, sizeof(event));
+            event.type = UHID_SET_REPORT_REPLY;
+            event.u.set_report_reply.id = id;
+            event.u.set_report_reply.err = isOutput ? 0 : EIO;
+            if (write(m_fd, &event, sizeof(event)) != (ssize_t)sizeof(event))
+            {
+                Log::debug("Cannot answer a set report request: %s\n", strerror(errno));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return true;
+}
+
+void BlHidSim::handleReport(const uint8_t *report, size_t length)
+{
+    time_point_t now = std::chrono::steady_clock::now();
+    if (m_isResponseSent)
+    {
+        m_turnaround.add(getElapsedUs(m_lastResponse, now));
+        m_isResponseSent = false;
+    }
+
+    if (length < sizeof(bl_hid_header_t))
+    {
+        Log::debug("Ignoring a report of %u bytes\n", (uint32_t)length);
+        return;
+    }
+    const bl_hid_header_t *header = (const bl_hid_header_t *)report;
+    uint32_t packetLength = header->packetLengthLsb | (header->packetLengthMsb << 8);
+    if (packetLength > length - sizeof(bl_hid_header_t))
+    {
+        Log::debug("Ignoring report %u with a packet of %u bytes in %u bytes\n", header->reportID, packetLength,
+                   (uint32_t)length);
+        return;
+    }
+    Log::debug("Report %u, packet of %u bytes\n", header->reportID, packetLength);
+
+    const uint8_t *packet = report + sizeof(bl_hid_header_t);
+    if (header->reportID == kBootloaderReportID_DataOut)
+    {
+        if (m_commandTag != kCommandTag_WriteMemory)
+        {
+            Log::debug("Ignoring a data packet outside of a data phase\n");
+            return;
+        }
+        if (m_dataCount != m_dataRemaining)
+        {
+            m_dataGaps.add(getElapsedUs(m_lastData, now));
+        }
+        m_lastData = now;
+        handleData(packet, packetLength);
+    }
+    else if (header->reportID == kBootloaderReportID_CommandOut)
+    {
+        if (m_commandTag)
+        {
+            // The host aborts a data phase with an empty command packet, or gave up on it.
+            Log::info("Host aborted the data phase of command 0x%02x after %u of %u bytes\n", m_commandTag,
+                      m_dataCount - m_dataRemaining, m_dataCount);
+            m_commandTag = 0;
+        }
+        if (packetLength)
+        {
+            m_commandStart = now;
+            handleCommand(packet, packetLength);
+        }
+    }
+    else
+    {
+        Log::debug("Ignoring report %u\n", header->reportID);
+    }
+}
+
+void BlHidSim::handleCommand(const uint8_t *packet, uint32_t length)
+{
+    uint32_t params[(kMinPacketBufferSize - sizeof(command_packet_t)) / sizeof(uint32_t)] = { 0 };
+    if (length < sizeof(command_packet_t))
+    {
+        Log::debug("Ignoring a command packet of %u bytes\n", length);
+        return;
+    }
+    const command_packet_t *command = (const command_packet_t *)packet;
+    uint32_t count = (length - sizeof(command_packet_t)) / sizeof(uint32_t);
+    count = (count < command->parameterCount) ? count : command->parameterCount;
+    count = (count < sizeof(params) / sizeof(params[0])) ? count : sizeof(params) / sizeof(params[0]);
+    memcpy(params, packet + sizeof(command_packet_t), count * sizeof(uint32_t));
+    Log::debug("Command 0x%02x with %u parameters\n", command->commandTag, count);
+
+    uint32_t status = kStatus_Success;
+    switch (command->commandTag)
+    {
+        case kCommandTag_GetProperty:
+            getProperty(params[0]);
+            return;
+
+        case kCommandTag_ReadMemory:
+            readMemory(params[0], params[1]);
+            return;
+
+        case kCommandTag_WriteMemory:
+            if (!isValidRange(params[0], params[1]))
+            {
+                status = kStatusMemoryRangeInvalid;
+                break;
+            }
+            // Without data there is no data phase, so this response is the only one.
+            sendGenericResponse(kStatus_Success, command->commandTag);
+            if (params[1])
+            {
+                m_commandTag = command->commandTag;
+                m_dataAddress = params[0];
+                m_dataRemaining = params[1];
+                m_dataCount = params[1];
+            }
+            return;
+
+        case kCommandTag_FillMemory:
+            if (!isValidRange(params[0], params[1]))
+            {
+                status = kStatusMemoryRangeInvalid;
+                break;
+            }
+            for (uint32_t i = 0; i < params[1]; ++i)
+            {
+                m_memory[params[0] - m_memoryStart + i] = (uint8_t)(params[2] >> (8 * (i % sizeof(uint32_t))));
+            }
+            break;
+
+        case kCommandTag_FlashEraseAll:
+        case kCommandTag_FlashEraseAllUnsecure:
+            memset(m_memory.data(), 0xff, m_memory.size());
+            break;
+
+        case kCommandTag_FlashEraseRegion:
+            if (!isValidRange(params[0], params[1]) || ((params[0] - m_memoryStart) % kSectorSize) ||
+                (params[1] % kSectorSize))
+            {
+                status = kStatusMemoryRangeInvalid;
+                break;
+            }
+            memset(&m_memory[params[0] - m_memoryStart], 0xff, params[1]);
+            break;
+
+        case kCommandTag_Reset:
+            sendGenericResponse(kStatus_Success, command->commandTag);
+            Log::info("Reset, reconnecting in %u ms\n", kResetDelayMs);
+            destroyDevice();
+            std::this_thread::sleep_for(std::chrono::milliseconds(kResetDelayMs));
+            createDevice();
+            return;
+
+        case kCommandTag_Execute:
+        case kCommandTag_Call:
+            Log::info("%s 0x%08x acknowledged\n", (command->commandTag == kCommandTag_Execute) ? "Execute" : "Call",
+                      params[0]);
+            break;
+
+        default:
+            status = kStatus_UnknownCommand;
+            break;
+    }
+    sendGenericResponse(status, command->commandTag);
+}
+
+void BlHidSim::handleData(const uint8_t *packet, uint32_t length)
+{
+    // Bytes beyond the announced count are dropped, as the bootloader does.
+    uint32_t count = (length < m_dataRemaining) ? length : m_dataRemaining;
+    memcpy(&m_memory[m_dataAddress - m_memoryStart], packet, count);
+    m_dataAddress += count;
+    m_dataRemaining -= count;
+    if (m_dataRemaining)
+    {
+        return;
+    }
+
+    uint8_t commandTag = m_commandTag;
+    m_commandTag = 0;
+    endDataPhase(m_dataCount, true, m_lastData);
+    sendGenericResponse(kStatus_Success, commandTag);
+}
+
+void BlHidSim::getProperty(uint32_t tag)
+{
+    uint32_t values[2] = { kStatus_Success, 0 };
+    switch (tag)
+    {
+        case kPropertyTag_BootloaderVersion:
+        case kPropertyTag_TargetVersion:
+            values[1] = kBootloaderVersion;
+            break;
+        case kPropertyTag_AvailablePeripherals:
+            values[1] = kPeripheralType_USB_HID;
+            break;
+        case kPropertyTag_FlashStartAddress:
+        case kPropertyTag_RAMStartAddress:
+            values[1] = m_memoryStart;
+            break;
+        case kPropertyTag_FlashSizeInBytes:
+        case kPropertyTag_RAMSizeInBytes:
+            values[1] = (uint32_t)m_memory.size();
+            break;
+        case kPropertyTag_FlashSectorSize:
+            values[1] = kSectorSize;
+            break;
+        case kPropertyTag_FlashBlockCount:
+            values[1] = 1;
+            break;
+        case kPropertyTag_AvailableCommands:
+            values[1] = (1u << (kCommandTag_FlashEraseAll - 1)) | (1u << (kCommandTag_FlashEraseRegion - 1)) |
+                        (1u << (kCommandTag_ReadMemory - 1)) | (1u << (kCommandTag_WriteMemory - 1)) |
+                        (1u << (kCommandTag_FillMemory - 1)) | (1u << (kCommandTag_GetProperty - 1)) |
+                        (1u << (kCommandTag_Execute - 1)) | (1u << (kCommandTag_Call - 1)) |
+                        (1u << (kCommandTag_Reset - 1)) | (1u << (kCommandTag_FlashEraseAllUnsecure - 1));
+            break;
+        case kPropertyTag_MaxPacketSize:
+            values[1] = m_packetSize;
+            break;
+        case kPropertyTag_FlashPageSize:
+            values[1] = sizeof(uint32_t);
+            break;
+        case kPropertyTag_VerifyWrites:
+            values[1] = 0;
+            break;
+        default:
+            values[0] = kStatus_UnknownProperty;
+            break;
+    }
+    sendResponse(kCommandTag_GetPropertyResponse, kCommandFlag_None, values,
+                 (values[0] == kStatus_Success) ? 2 : 1);
+}
+
+void BlHidSim::readMemory(uint32_t address, uint32_t byteCount)
+{
+    if (!isValidRange(address, byteCount))
+    {
+        sendGenericResponse(kStatusMemoryRangeInvalid, kCommandTag_ReadMemory);
+        return;
+    }
+
+    uint32_t values[2] = { kStatus_Success, byteCount };
+    sendResponse(kCommandTag_ReadMemoryResponse, kCommandFlag_HasDataPhase, values, 2);
+    for (uint32_t offset = 0; offset < byteCount; offset += m_packetSize)
+    {
+        uint32_t count = (byteCount - offset < m_packetSize) ? byteCount - offset : m_packetSize;
+        if (!sendReport(kBootloaderReportID_DataIn, &m_memory[address - m_memoryStart + offset], count))
+        {
+            return;
+        }
+    }
+    endDataPhase(byteCount, false, m_lastInput);
+    sendGenericResponse(kStatus_Success, kCommandTag_ReadMemory);
+}
+
+bool BlHidSim::isValidRange(uint32_t address, uint32_t byteCount) const
+{
+    return (address >= m_memoryStart) && ((uint64_t)address + byteCount <= (uint64_t)m_memoryStart + m_memory.size());
+}
+
+void BlHidSim::sendGenericResponse(uint32_t status, uint8_t commandTag)
+{
+    uint32_t values[2] = { status, commandTag };
+    sendResponse(kCommandTag_GenericResponse, kCommandFlag_None, values, 2);
+}
+
+void BlHidSim::sendResponse(uint8_t tag, uint8_t flags, const uint32_t *params, uint8_t count)
+{
+    uint8_t packet[kMinPacketBufferSize];
+    command_packet_t *header = (command_packet_t *)packet;
+    header->commandTag = tag;
+    header->flags = flags;
+    header->reserved = 0;
+    header->parameterCount = count;
+    memcpy(packet + sizeof(command_packet_t), params, count * sizeof(uint32_t));
+    if (sendReport(kBootloaderReportID_CommandIn, packet, sizeof(command_packet_t) + count * sizeof(uint32_t)))
+    {
+        m_lastResponse = m_lastInput;
+        m_isResponseSent = true;
+    }
+}
+
+bool BlHidSim::sendReport(uint8_t reportId, const uint8_t *packet, uint32_t length)
+{
+    struct uhid_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = UHID_INPUT2;
+    event.u.input2.size = (uint16_t)(sizeof(bl_hid_header_t) + m_packetSize);
+    bl_hid_header_t *header = (bl_hid_header_t *)event.u.input2.data;
+    header->reportID = reportId;
+    header->packetLengthLsb = (uint8_t)(length & 0xff);
+    header->packetLengthMsb = (uint8_t)(length >> 8);
+    memcpy(event.u.input2.data + sizeof(bl_hid_header_t), packet, length);
+
+    // An interrupt endpoint is polled once per interval, which gives the host time to read each report.
+    time_point_t next = m_lastInput + std::chrono::microseconds(m_intervalUs);
+    if (std::chrono::steady_clock::now() < next)
+    {
+        std::this_thread::sleep_until(next);
+    }
+    if (write(m_fd, &event, sizeof(event)) != (ssize_t)sizeof(event))
+    {
+        Log::error("Error: cannot send report %u: %s\n", reportId, strerror(errno));
+        return false;
+    }
+    m_lastInput = std::chrono::steady_clock::now();
+    Log::debug("Sent report %u, packet of %u bytes\n", reportId, length);
+    return true;
+}
+
+void BlHidSim::endDataPhase(uint32_t byteCount, bool isOut, const time_point_t &end)
+{
+    uint64_t us = getElapsedUs(m_commandStart, end);
+    if (isOut)
+    {
+        m_bytesOut += byteCount;
+        m_timeOutUs += us;
+    }
+    else
+    {
+        m_bytesIn += byteCount;
+        m_timeInUs += us;
+    }
+    if (m_isVerbose)
+    {
+        Log::info("%s %u bytes in %u us, %.1f KiB/s\n", isOut ? "Received" : "Sent", byteCount, (uint32_t)us,
+                  us ? (byteCount * 1000000.0 / 1024) / us : 0.0);
+    }
+}
+
+void BlHidSim::logStatistics() const
+{
+    Log::info("\n");
+    m_turnaround.log(Logger::kInfo, "Host turnaround");
+    m_dataGaps.log(Logger::kInfo, "Host data gap");
+    Log::info("Host to device throughput: %llu bytes in %llu us, %.1f KiB/s\n", (unsigned long long)m_bytesOut,
+              (unsigned long long)m_timeOutUs, m_timeOutUs ? (m_bytesOut * 1000000.0 / 1024) / m_timeOutUs : 0.0);
+    Log::info("Device to host throughput: %llu bytes in %llu us, %.1f KiB/s\n", (unsigned long long)m_bytesIn,
+              (unsigned long long)m_timeInUs, m_timeInUs ? (m_bytesIn * 1000000.0 / 1024) / m_timeInUs : 0.0);
+}
+
+int BlHidSim::run()
+{
+    int result = processOptions();
+    if (result != -1)
+    {
+        return result;
+    }
+    memset(m_memory.data(), 0xff, m_memory.size());
+
+    // Without SA_RESTART, the signal interrupts poll() so the device is stopped at once.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = ctrlPlusCHandler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+
+    if (!createDevice())
+    {
+        return 1;
+    }
+    Log::info("Virtual bootloader 0x%04x,0x%04x with %u byte packets and memory 0x%08x-0x%08x\n", m_vid, m_pid,
+              m_packetSize, m_memoryStart, (uint32_t)(m_memoryStart + m_memory.size() - 1));
+
+    result = 0;
+    while (!s_isStopped && (m_fd >= 0))
+    {
+        struct pollfd fd;
+        fd.fd = m_fd;
+        fd.events = POLLIN;
+        fd.revents = 0;
+        if (poll(&fd, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            Log::error("Error: cannot poll the uhid device: %s\n", strerror(errno));
+            result = 1;
+            break;
+        }
+        if (!handleEvent())
+        {
+            result = 1;
+            break;
+        }
+    }
+    if (m_fd < 0)
+    {
+        result = 1;
+    }
+
+    destroyDevice();
+    logStatistics();
+    return result;
+}
+
+//! @brief Application entry point.
+int main(int argc, char *argv[])
+{
+    return BlHidSim(argc, argv).run();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EOF
+////////////////////////////////////////////////////////////////////////////////
@@ -6,9 +6,13 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 #include "blfwk/Bootloader.h"
+#include "blfwk/DeviceMonitor.h"
+#include "blfwk/Realtime.h"
 #include "blfwk/SerialPacketizer.h"
 #include "blfwk/UsbHidPacketizer.h"
 #include "blfwk/options.h"
@@ -41,7 +45,7 @@ Copyright 2016-2021 NXP\nAll rights reserved.";
 //! @brief Command line option definitions.
 static const char *k_optionsDefinition[] = { "?|help",
                                              "v|version",
-                                             "p:port <name>[,<speed>]",
+                                             "p:port <name>[,<speed>[:<speed>...][,lowlatency][,rtscts][,iothread]]",
                                              "i:i2c <name>[,<address>,<speed>]",
                                              "s:spi <name>[,<speed>,<polarity>,<phase>,lsb|msb]",
                                              "b:buspal spi[,<speed>,<polarity>,<phase>,lsb|msb] | "
@@ -49,11 +53,17 @@ static const char *k_optionsDefinition[] = { "?|help",
                                              "l:lpcusbsio spi[,<port>,<pin>,<speed>,<polarity>,<phase>] | "
                                              "i2c[,<address>,<speed>]",
                                              "u?usb [[[<vid>,]<pid>] | [<path>]]",
+                                             "q:queue <depth>",
                                              "V|verbose",
                                              "d|debug",
                                              "j|json",
                                              "n|noping",
-                                             "t:timeout <ms>",
+                                             "t:timeout <ms>[,<command ms>][,fixed]",
+                                             "c:cache <dir>",
+                                             "w:write-delay <ms>[,fixed]",
+                                             "r?realtime [<cpu>][,<priority>]",
+                                             "W:wait <ms>",
+                                             "P:ping-retry <retries>[,<timeout ms>[,<max delay ms>]]",
                                              NULL };
 
 //! @brief Usage text.
@@ -61,10 +71,23 @@ const char k_optionUsage[] =
     "\nOptions:\n\
   -?/--help                    Show this help\n\
   -v/--version                 Display tool version\n\
-  -p/--port <name>[,<speed>]   Connect to target over UART. Specify COM port\n\
+  -p/--port <name>[,<speed>[:<speed>...][,lowlatency][,rtscts][,iothread]]\n\
+                               Connect to target over UART. Specify COM port\n\
                                and optionally baud rate\n\
                                  (default=57600)\n\
                                  If -b, then port is BusPal port\n\
+                               Several baud rates separated by colons are\n\
+                               pinged in turn until the target answers\n\
+                               On Linux any rate supported by the adapter may\n\
+                               be used, and lowlatency enables the low latency\n\
+                               mode of the driver and sets the latency timer\n\
+                               of FTDI adapters to 1 ms\n\
+                               rtscts enables RTS/CTS hardware flow control,\n\
+                               which needs both lines wired to the target\n\
+                               iothread moves port I/O to a dedicated thread,\n\
+                               so received bytes are buffered while blhost is\n\
+                               busy (not supported on Windows)\n\
+                               (ex. -p /dev/ttyUSB0,3000000,lowlatency,rtscts)\n\
   -i/--i2c <name>[,<address>,<speed>] Connect to target over I2C. Only valid for\n\
                                ARM Linux blhost\n\
                                  name(I2C port), address(7-bit hex), speed(KHz)\n\
@@ -115,12 +138,63 @@ const char k_optionUsage[] =
                                vid/pid (default=0x15a2,0x0073) or device path.\n\
                                If -l, then port is LPC USB Serial I/O port\n\
                                (default=0x1fc9,0x0009), and <path> is ignored.\n\
+  -q/--queue <depth>           Access the USB HID device through usbfs instead\n\
+                               of hidapi, with up to <depth> (1-64) output\n\
+                               reports in flight. Only valid for Linux blhost.\n\
+                               The kernel HID driver is detached from the\n\
+                               device while blhost runs, and <path> may be its\n\
+                               /dev/bus/usb or its hidraw node\n\
   -V/--verbose                 Print extra detailed log information\n\
   -d/--debug                   Print really detailed log information\n\
   -j/--json                    Print output in JSON format to aid automation.\n\
   -n/--noping                  Skip the initial ping of a serial target\n\
-  -t/--timeout <ms>            Set packet timeout in milliseconds\n\
-                                 (default=5000)\n";
+  -t/--timeout <ms>[,<command ms>][,fixed]\n\
+                               Set packet timeout in milliseconds\n\
+                                 (default=5000)\n\
+                               and optionally the time each command may take\n\
+                               in total (default=no limit). The packet timeout\n\
+                               of erase, write and configure commands is\n\
+                               extended by the time the target is expected to\n\
+                               take, unless fixed is given\n\
+  -c/--cache <dir>             Cache parsed flash-image files in the existing\n\
+                               directory <dir>, so that unchanged files are\n\
+                               not parsed again. Files of 16MB or more are\n\
+                               then loaded into memory instead of being\n\
+                               written while they are parsed\n\
+  -w/--write-delay <ms>[,fixed]\n\
+                               Maximum delay before a packet that follows an\n\
+                               ACK to a UART target (default=100). The target\n\
+                               is probed so packets are sent as soon as it is\n\
+                               ready. With fixed, always wait the full delay\n\
+  -r/--realtime [<cpu>][,<priority>]\n\
+                               Run the I/O threads with real-time scheduling:\n\
+                               pin them to <cpu>, use SCHED_FIFO <priority>\n\
+                               (default=50) and lock the packet buffers. Needs\n\
+                               root or the CAP_SYS_NICE and CAP_IPC_LOCK\n\
+                               capabilities, missing steps are skipped. Prints\n\
+                               the distribution of the packet round trip times\n\
+  -W/--wait <ms>               Wait up to <ms> milliseconds for a USB HID\n\
+                               device or a serial port to appear before\n\
+                               connecting, and after reset or execute, for\n\
+                               the target to re-enumerate. Device events are\n\
+                               followed, so waits last as long as the\n\
+                               enumeration. After a reset a serial target\n\
+                               is pinged until it answers. On Windows ports\n\
+                               are always reported ready, so only this ping\n\
+                               waits for a serial target there\n\
+  -P/--ping-retry <retries>[,<timeout ms>[,<max delay ms>]]\n\
+                               Retry the initial ping of a UART target up to\n\
+                               <retries> times, waiting up to <timeout ms>\n\
+                               for each response (default=500). The line is\n\
+                               left idle between attempts for a delay that\n\
+                               doubles from 1 ms up to <max delay ms>\n\
+                               (default=0, no delay)\n";
+
+//! @brief Largest number of USB HID output reports in flight.
+static const uint32_t kMaxUsbQueueDepth = 64;
+
+//! @brief Time a target is given to disconnect after a reset or an execute, in milliseconds.
+static const uint32_t kDisconnectTimeoutMs = 1000;
 
 //! @brief Trailer usage text that gets appended after the options descriptions.
 static const char *usageTrailer = "-- command <args...>";
@@ -223,10 +297,17 @@ const char k_commandUsage[] =
                                e.g. data.bin 8 (writes first 8 bytes from file)\n\
                                e.g. \"{{11 22 33 44}}\" (w/quotes)\n\
                                e.g. {{11223344}} (no spaces)\n\
+                               <file> may be - for stdin, a pipe, or a gzip\n\
+                               or zstd compressed file. Give byte_count for\n\
+                               these to send while reading, otherwise the\n\
+                               whole input is read first to find its size\n\
   fill-memory <addr> <byte_count> <pattern> [word | short | byte]\n\
                                Fill memory with pattern; size is\n\
                                word (default), short or byte\n\
-  receive-sb-file <file>       Receive SB file\n\
+  receive-sb-file <file> [auto | abort | noabort]\n\
+                               Receive SB file. Poll for an abort from the\n\
+                               target only if the file may abort (auto,\n\
+                               default), always (abort) or never (noabort)\n\
   execute <addr> <arg> <stackpointer>\n\
                                Execute at address with arg and stack pointer\n\
   call <addr> <arg>            Call address with arg\n\
@@ -299,13 +380,19 @@ const char k_commandUsage[] =
   fuse-read <index> <byte_count> [<file>]\n\
                                Read fuse according to index and write to file\n\
                                or stdout if no file specified\n\
-  flash-image <file> [erase] [memory_id]\n\
+  flash-image <file> [erase] [memory_id] [sections|segments]\n\
                                Write a formated image <file> to memory with ID\n\
                                <memory_id>. Supported file types: SRecord\n\
                                (.srec and .s19) and HEX (.hex). Flash is erased\n\
                                before writing if [erase]=erase. The erase unit\n\
                                size depends on the target and the minimum erase\n\
                                unit size is 1K.\n\
+                               ELF files are written section by section by\n\
+                               default. With [segments] they are written per\n\
+                               PT_LOAD program header at the load address,\n\
+                               with the bss part of each segment zero filled.\n\
+                               SRecord and HEX <file> may also be - for stdin,\n\
+                               a pipe, or a gzip or zstd compressed file.\n\
   list-memory                  List all on-chip Flash and RAM regions, and off-chip\n\
                                memories, supported by current device.\n\
                                Only the configured off-chip memory will be list.\n\
@@ -338,6 +425,8 @@ public:
         , m_cmdv()
         , m_comPort("COM1")
         , m_comSpeed(57600)
+        , m_comSpeeds()
+        , m_comPortOptions(UartPeripheral::kUartOption_None)
         , m_useBusPal(false)
         , m_useLpcUsbSio(false)
         , m_busPalConfig()
@@ -354,8 +443,21 @@ public:
 #endif
         , m_usbVid(UsbHidPeripheral::kDefault_Vid)
         , m_usbPid(UsbHidPeripheral::kDefault_Pid)
-        , m_packetTimeoutMs(5000)
+        , m_usbQueueDepth(0)
         , m_ping(true)
+        , m_packetTimeoutMs(5000)
+        , m_commandTimeoutMs(0)
+        , m_isTimeoutFixed(false)
+        , m_imageCacheDirectory()
+        , m_writeDelayMs(SerialPacketizer::kDefaultBackToBackDelayMs)
+        , m_isWriteDelayFixed(false)
+        , m_isRealtime(false)
+        , m_realtimeCpu(Realtime::kAnyCpu)
+        , m_realtimePriority(Realtime::kDefaultPriority)
+        , m_waitMs(0)
+        , m_pingRetries(0)
+        , m_pingTimeoutMs(SerialPacketizer::kDefaultPingResponseTimeoutMs)
+        , m_pingMaxRetryDelayMs(0)
     {
         // create logger instance
         m_logger = new StdoutLogger();
@@ -386,6 +488,13 @@ protected:
     static void ctrlPlusCHandler(int msg);
 #endif
     static void displayProgress(int percentage, int segmentIndex, int segmentCount);
+    //! @brief Returns true if the device of @a config is there and may be opened, setting @a deviceNode to its node.
+    static bool findDevice(const Peripheral::PeripheralConfigData &config, std::string &deviceNode);
+    //! @brief Waits for the target to re-enumerate after a reset, or after an execute if @a isReset is false.
+    void waitForReconnect(DeviceMonitor &monitor, const Peripheral::PeripheralConfigData &config,
+                          const std::string &deviceNode, bool isReset);
+    //! @brief Returns true if the bootloader of the serial target of @a config answers a ping.
+    bool pingTarget(const Peripheral::PeripheralConfigData &config);
 
 protected:
     int m_argc;                        //!< Number of command line arguments.
@@ -393,6 +502,8 @@ protected:
     string_vector_t m_cmdv;            //!< Command line argument vector.
     string m_comPort;                  //!< COM port to use.
     int m_comSpeed;                    //!< COM port speed.
+    std::vector<int> m_comSpeeds;      //!< COM port speeds to ping in turn, if more than one is given.
+    uint32_t m_comPortOptions;         //!< UartPeripheral options bit mask.
     bool m_useBusPal;                  //!< True if using BusPal peripheral.
     string_vector_t m_busPalConfig;    //!< Bus pal peripheral-specific argument vector.
     bool m_useLpcUsbSio;               //!< True if using LPCUSB Serial I/O peripheral.
@@ -410,9 +521,22 @@ protected:
     uint16_t m_usbVid;              //!< USB VID of the target HID device
     uint16_t m_usbPid;              //!< USB PID of the target HID device
     string m_usbPath;               //!< USB PATH of the target HID device
+    uint32_t m_usbQueueDepth;       //!< Output reports in flight with the usbfs backend, or 0 to use hidapi.
     bool m_ping;                    //!< If true will not send the initial ping to a serial device
     uint32_t m_packetTimeoutMs;     //!< Packet timeout in milliseconds.
+    uint32_t m_commandTimeoutMs;    //!< Command timeout in milliseconds, or 0 for no limit.
+    bool m_isTimeoutFixed;          //!< If true memory commands use the packet timeout of other commands.
     ping_response_t m_pingResponse; //!< Response to initial ping
+    string m_imageCacheDirectory;   //!< Directory of the parsed image cache, or empty if not used.
+    uint32_t m_writeDelayMs;        //!< Maximum delay before a back-to-back serial write.
+    bool m_isWriteDelayFixed;       //!< If true always wait m_writeDelayMs before a back-to-back write.
+    bool m_isRealtime;              //!< If true run with real-time scheduling.
+    int m_realtimeCpu;              //!< CPU to pin blhost to in real-time mode, or Realtime::kAnyCpu.
+    int m_realtimePriority;         //!< SCHED_FIFO priority in real-time mode.
+    uint32_t m_waitMs;              //!< Time to wait for the device to appear, or 0 to not wait.
+    uint32_t m_pingRetries;         //!< Number of retries of the initial ping of a UART target.
+    uint32_t m_pingTimeoutMs;       //!< Time to wait for the response to each ping.
+    uint32_t m_pingMaxRetryDelayMs; //!< Longest delay between ping attempts, or 0 for none.
     StdoutLogger *m_logger;         //!< Singleton logger instance.
 };
 
@@ -519,16 +643,43 @@ int BlHost::processOptions()
                 {
                     string_vector_t params = utils::string_split(optarg, ',');
                     m_comPort = params[0];
-                    if (params.size() == 2)
+                    if ((params.size() >= 2) && !params[1].empty())
                     {
-                        int speed = atoi(params[1].c_str());
-                        if (speed <= 0)
+                        string_vector_t speeds = utils::string_split(params[1], ':');
+                        m_comSpeeds.clear();
+                        for (size_t i = 0; i < speeds.size(); ++i)
+                        {
+                            int speed = atoi(speeds[i].c_str());
+                            if (speed <= 0)
+                            {
+                                Log::error("Error: You must specify a valid baud rate with the -p/--port option.\n");
+                                options.usage(std::cout, usageTrailer);
+                                return 0;
+                            }
+                            m_comSpeeds.push_back(speed);
+                        }
+                        m_comSpeed = m_comSpeeds[0];
+                    }
+                    for (size_t i = 2; i < params.size(); ++i)
+                    {
+                        if (params[i] == "lowlatency")
+                        {
+                            m_comPortOptions |= UartPeripheral::kUartOption_LowLatency;
+                        }
+                        else if (params[i] == "rtscts")
+                        {
+                            m_comPortOptions |= UartPeripheral::kUartOption_FlowControl;
+                        }
+                        else if (params[i] == "iothread")
+                        {
+                            m_comPortOptions |= UartPeripheral::kUartOption_IoThread;
+                        }
+                        else
                         {
-                            Log::error("Error: You must specify a valid baud rate with the -p/--port option.\n");
+                            Log::error("Error: Unknown -p/--port option '%s'.\n", params[i].c_str());
                             options.usage(std::cout, usageTrailer);
                             return 0;
                         }
-                        m_comSpeed = speed;
                     }
                 }
                 else
@@ -834,10 +985,20 @@ int BlHost::processOptions()
             case 't':
                 if (optarg)
                 {
+                    string_vector_t params = utils::string_split(optarg, ',');
                     uint32_t timeout = 0;
-                    if (utils::stringtoui(optarg, timeout))
+                    uint32_t commandTimeout = 0;
+                    bool isFixed = (params.size() >= 2) && (params.back() == "fixed");
+                    if (isFixed)
+                    {
+                        params.pop_back();
+                    }
+                    if ((params.size() >= 1) && (params.size() <= 2) && utils::stringtoui(params[0], timeout) &&
+                        ((params.size() == 1) || utils::stringtoui(params[1], commandTimeout)))
                     {
                         m_packetTimeoutMs = timeout;
+                        m_commandTimeoutMs = commandTimeout;
+                        m_isTimeoutFixed = isFixed;
                     }
                     else
                     {
@@ -848,6 +1009,88 @@ int BlHost::processOptions()
                 }
                 break;
 
+            case 'c':
+                m_imageCacheDirectory = optarg;
+                break;
+
+            case 'w':
+            {
+                string_vector_t params = utils::string_split(optarg, ',');
+                uint32_t delay = 0;
+                if (params.empty() || (params.size() > 2) || !utils::stringtoui(params[0], delay) ||
+                    ((params.size() == 2) && (params[1] != "fixed")))
+                {
+                    Log::error("Error: %s is not valid for option -w/--write-delay.\n", optarg);
+                    options.usage(std::cout, usageTrailer);
+                    return 0;
+                }
+                m_writeDelayMs = delay;
+                m_isWriteDelayFixed = (params.size() == 2);
+                break;
+            }
+
+            case 'r':
+            {
+                m_isRealtime = true;
+                if (optarg)
+                {
+                    string_vector_t params = utils::string_split(optarg, ',');
+                    uint32_t cpu = 0;
+                    uint32_t priority = 0;
+                    bool hasCpu = !params.empty() && !params[0].empty();
+                    if ((params.size() > 2) || (hasCpu && !utils::stringtoui(params[0], cpu)) ||
+                        ((params.size() == 2) &&
+                         (!utils::stringtoui(params[1], priority) || (priority < 1) || (priority > 99))))
+                    {
+                        Log::error("Error: %s is not valid for option -r/--realtime.\n", optarg);
+                        options.usage(std::cout, usageTrailer);
+                        return 0;
+                    }
+                    if (hasCpu)
+                    {
+                        m_realtimeCpu = (int)cpu;
+                    }
+                    if (params.size() == 2)
+                    {
+                        m_realtimePriority = (int)priority;
+                    }
+                }
+                break;
+            }
+
+            case 'q':
+                if (!utils::stringtoui(optarg, m_usbQueueDepth) || (m_usbQueueDepth < 1) ||
+                    (m_usbQueueDepth > kMaxUsbQueueDepth))
+                {
+                    Log::error("Error: %s is not valid for option -q/--queue.\n", optarg);
+                    options.usage(std::cout, usageTrailer);
+                    return 0;
+                }
+                break;
+
+            case 'W':
+                if (!utils::stringtoui(optarg, m_waitMs))
+                {
+                    Log::error("Error: %s is not valid for option -W/--wait.\n", optarg);
+                    options.usage(std::cout, usageTrailer);
+                    return 0;
+                }
+                break;
+
+            case 'P':
+            {
+                string_vector_t params = utils::string_split(optarg, ',');
+                if (params.empty() || (params.size() > 3) || !utils::stringtoui(params[0], m_pingRetries) ||
+                    ((params.size() >= 2) && !utils::stringtoui(params[1], m_pingTimeoutMs)) ||
+                    ((params.size() == 3) && !utils::stringtoui(params[2], m_pingMaxRetryDelayMs)))
+                {
+                    Log::error("Error: %s is not valid for option -P/--ping-retry.\n", optarg);
+                    options.usage(std::cout, usageTrailer);
+                    return 0;
+                }
+                break;
+            }
+
             // All other cases are errors.
             default:
                 return 1;
@@ -888,6 +1131,7 @@ int BlHost::run()
     Command *configCmd = NULL;
     Progress *progress = NULL;
     Bootloader *bl = NULL;
+    DeviceMonitor *monitor = NULL;
     // Read command line options.
     int optionsResult;
     if ((optionsResult = processOptions()) != -1)
@@ -915,6 +1159,12 @@ int BlHost::run()
 
             progress = new Progress(displayProgress, NULL);
             cmd->registerProgress(progress);
+
+            FlashImage *flashImage = dynamic_cast<FlashImage *>(cmd);
+            if (flashImage)
+            {
+                flashImage->setImageCacheDirectory(m_imageCacheDirectory);
+            }
         }
 
         config.ping = m_ping;
@@ -925,6 +1175,7 @@ int BlHost::run()
             config.usbHidVid = m_usbVid;
             config.usbHidPid = m_usbPid;
             config.usbPath = m_usbPath;
+            config.usbHidQueueDepth = m_usbQueueDepth;
             config.packetTimeoutMs = m_packetTimeoutMs;
             if (m_useBusPal)
             {
@@ -999,7 +1250,13 @@ int BlHost::run()
             config.peripheralType = Peripheral::kHostPeripheralType_UART;
             config.comPortName = m_comPort.c_str();
             config.comPortSpeed = m_comSpeed;
+            config.comPortOptions = m_comPortOptions;
             config.packetTimeoutMs = m_packetTimeoutMs;
+            if (!m_useBusPal && ((m_comSpeeds.size() > 1) || m_pingRetries))
+            {
+                // The speeds are pinged once the port is open, with the ping timing set.
+                config.ping = false;
+            }
             if (m_useBusPal)
             {
                 config.peripheralType = Peripheral::kHostPeripheralType_BUSPAL_UART;
@@ -1012,8 +1269,57 @@ int BlHost::run()
             }
         }
 
+        // Switch to real-time scheduling before the peripheral starts its I/O threads, so that they inherit it.
+        // Helper threads started later leave it.
+        if (m_isRealtime)
+        {
+            Realtime::enable(m_realtimeCpu, m_realtimePriority);
+        }
+
+        // Wait for the device, with the monitor listening from now on so that a reset is followed.
+        std::string deviceNode;
+        if (m_waitMs && ((config.peripheralType == Peripheral::kHostPeripheralType_USB_HID) ||
+                         (config.peripheralType == Peripheral::kHostPeripheralType_UART) ||
+                         (config.peripheralType == Peripheral::kHostPeripheralType_BUSPAL_UART)))
+        {
+            monitor = new DeviceMonitor();
+            if (!monitor->waitUntil([&] { return findDevice(config, deviceNode); }, Deadline(m_waitMs)))
+            {
+                throw std::runtime_error(format_string("Error: the target did not appear within %u ms\n", m_waitMs));
+            }
+        }
+
         // Init the Bootloader object.
         bl = new Bootloader(config);
+        bl->setCommandTimeout(m_commandTimeoutMs);
+        bl->setAdaptiveTimeouts(!m_isTimeoutFixed);
+        if (m_isRealtime)
+        {
+            bl->getPacketizer()->prefaultBuffers();
+        }
+
+        SerialPacketizer *serialPacketizer = dynamic_cast<SerialPacketizer *>(bl->getPacketizer());
+        if (serialPacketizer)
+        {
+            serialPacketizer->setBackToBackDelay(m_writeDelayMs, !m_isWriteDelayFixed);
+            serialPacketizer->setPingTiming(m_pingTimeoutMs, m_pingMaxRetryDelayMs);
+        }
+
+        if (m_ping && !config.ping && (config.peripheralType == Peripheral::kHostPeripheralType_UART))
+        {
+            // Find the speed the target answers at.
+            int actualComSpeed = m_comSpeed;
+            try
+            {
+                bl->ping(m_pingRetries, 0, m_comSpeeds.empty() ? std::vector<int>(1, m_comSpeed) : m_comSpeeds,
+                         &actualComSpeed);
+            }
+            catch (const std::exception &e)
+            {
+                throw std::runtime_error(format_string("Error: Initial ping failure: %s", e.what()));
+            }
+            Log::info("Target answered at %d baud\n", actualComSpeed);
+        }
 
         if (configCmd)
         {
@@ -1059,6 +1365,15 @@ int BlHost::run()
                     result = kStatus_NoResponse;
                 }
             }
+
+            if (monitor && (dynamic_cast<Reset *>(cmd) || dynamic_cast<Execute *>(cmd)) &&
+                (cmd->getResponseValues()->size() > 0) && (cmd->getResponseValues()->at(0) == kStatus_Success))
+            {
+                // Release the device, so that its node can go away.
+                delete bl;
+                bl = NULL;
+                waitForReconnect(*monitor, config, deviceNode, dynamic_cast<Reset *>(cmd) != NULL);
+            }
         }
     }
     catch (exception &e)
@@ -1077,16 +1392,102 @@ int BlHost::run()
     }
     if (bl)
     {
+        if (bl->getPacketizer() && bl->getPacketizer()->getLatencyStats().getCount())
+        {
+            bl->getPacketizer()->getLatencyStats().log(m_isRealtime ? Logger::kInfo : Logger::kDebug,
+                                                       "Packet round trip");
+        }
         delete bl;
     }
     if (progress)
     {
         delete progress;
     }
+    if (monitor)
+    {
+        delete monitor;
+    }
 
     return result;
 }
 
+bool BlHost::findDevice(const Peripheral::PeripheralConfigData &config, std::string &deviceNode)
+{
+    if ((config.peripheralType == Peripheral::kHostPeripheralType_USB_HID) && config.usbPath.empty())
+    {
+        return DeviceMonitor::findUsbHid(config.usbHidVid, config.usbHidPid, config.usbHidSerialNumber, deviceNode);
+    }
+
+    // A link in /dev/serial/by-id follows the adapter to whichever node it comes back as.
+    deviceNode = DeviceMonitor::resolveNode(
+        (config.peripheralType == Peripheral::kHostPeripheralType_USB_HID) ? config.usbPath : config.comPortName);
+    return DeviceMonitor::isNodeReady(deviceNode);
+}
+
+void BlHost::waitForReconnect(DeviceMonitor &monitor,
+                              const Peripheral::PeripheralConfigData &config,
+                              const std::string &deviceNode,
+                              bool isReset)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string node;
+
+    if (config.peripheralType != Peripheral::kHostPeripheralType_USB_HID)
+    {
+        // A target behind a USB to UART bridge resets without the port going away, so its
+        // bootloader is pinged until it answers again. After an execute the application runs,
+        // which need not answer at all.
+        if (!isReset || !m_ping)
+        {
+            Log::debug("Not waiting for a serial target to come back\n");
+            return;
+        }
+        if (!monitor.waitUntil([&] { return findDevice(config, node) && pingTarget(config); }, Deadline(m_waitMs)))
+        {
+            throw std::runtime_error(format_string("Error: the target did not answer within %u ms\n", m_waitMs));
+        }
+        Log::info("Target answered on %s after %u ms\n", node.c_str(),
+                  (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                                  start)
+                      .count());
+        return;
+    }
+
+    // A USB HID target is the USB device itself, so it goes away when it resets.
+    if (!monitor.waitUntil([&] { return monitor.isRemoved(deviceNode) || !findDevice(config, node); },
+                           Deadline(std::min(m_waitMs, kDisconnectTimeoutMs))))
+    {
+        Log::debug("Target did not disconnect\n");
+        return;
+    }
+    if (!monitor.waitUntil([&] { return findDevice(config, node); }, Deadline(m_waitMs)))
+    {
+        throw std::runtime_error(format_string("Error: the target did not reconnect within %u ms\n", m_waitMs));
+    }
+    Log::info("Target reconnected as %s after %u ms\n", node.c_str(),
+              (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                  .count());
+}
+
+bool BlHost::pingTarget(const Peripheral::PeripheralConfigData &config)
+{
+    Peripheral::PeripheralConfigData probeConfig(config);
+    probeConfig.ping = false;
+    try
+    {
+        Bootloader target(probeConfig);
+        SerialPacketizer *packetizer = dynamic_cast<SerialPacketizer *>(target.getPacketizer());
+        std::vector<int> speeds((m_useBusPal || m_comSpeeds.empty()) ? std::vector<int>(1, config.comPortSpeed)
+                                                                      : m_comSpeeds);
+        return packetizer && (packetizer->pingSpeeds(0, 0, NULL, speeds, NULL) == kStatus_Success);
+    }
+    catch (const std::exception &e)
+    {
+        Log::debug("Target does not answer yet: %s", e.what());
+        return false;
+    }
+}
+
 //! @brief Application entry point.
 int main(int argc, char *argv[], char *envp[])
 {